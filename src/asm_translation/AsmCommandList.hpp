@@ -3,6 +3,7 @@
 #define VL_MATH_PG_ASM_COMMAND_LIST
 
 #include <map>
+#include <string>
 #include <utility>
 
 namespace VlMathPG_Asm_Command_List
@@ -26,6 +27,59 @@ namespace VlMathPG_Asm_Command_List
 		OperImplPair("binl_&&", "and"),
 		OperImplPair("binl_||", "or")
 	};
+
+	// Whole arrays: c = a op b;
+	std::map<std::string, std::string> OPERATOR_TO_VECTOR_ASM
+	{
+		OperImplPair("binl_*", "vmul"),
+		OperImplPair("binl_/", "vdiv"),
+		OperImplPair("binl_+", "vadd"),
+		OperImplPair("binl_-", "vsub")
+	};
+
+	// Calls with arrays for all the arguments: command and the number of arrays
+	std::map<std::string, std::pair<std::string, size_t>> REDUCTION_TO_VECTOR_ASM
+	{
+		{"sum", {"vsum", 1}},
+		{"dot", {"vdot", 2}},
+		{"min", {"vmin", 1}},
+		{"max", {"vmax", 1}}
+	};
+
+	// Built-in functions, the programme's own functions of the same names come first:
+	// command (the same for both machines) and the number of arguments
+	std::map<std::string, std::pair<std::string, size_t>> MATH_FUNCTION_TO_ASM
+	{
+		{"sqrt",  {"sqrt",  1}},
+		{"sin",   {"sin",   1}},
+		{"cos",   {"cos",   1}},
+		{"exp",   {"exp",   1}},
+		{"log",   {"log",   1}},
+		{"pow",   {"pow",   2}},
+		{"abs",   {"abs",   1}},
+		{"floor", {"floor", 1}},
+		{"min",   {"min",   2}},
+		{"max",   {"max",   2}}
+	};
+
+	// Register machine, empty means the operand is the result
+	std::map<std::string, std::string> OPERATOR_TO_REG_ASM
+	{
+		OperImplPair("unpr_+", ""),
+		OperImplPair("unpr_-", "neg"),
+		OperImplPair("binl_*", "mul"),
+		OperImplPair("binl_/", "div"),
+		OperImplPair("binl_+", "add"),
+		OperImplPair("binl_-", "sub"),
+		OperImplPair("binf_<",  "is_l"),
+		OperImplPair("binf_<=", "is_le"),
+		OperImplPair("binf_>",  "is_m"),
+		OperImplPair("binf_>=", "is_me"),
+		OperImplPair("binf_==", "is_e"),
+		OperImplPair("binf_!=", "is_ne"),
+		OperImplPair("binl_&&", "and"),
+		OperImplPair("binl_||", "or")
+	};
 }
 
 #endif  // VL_MATH_PG_ASM_COMMAND_LIST
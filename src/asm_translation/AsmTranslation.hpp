@@ -3,8 +3,11 @@
 #define VL_MATH_PG_ASM_TRANSLATION
 
 #include <list>
+#include <map>
 #include <tuple>
 #include <random>
+#include <algorithm>
+#include <charconv>
 
 #include "../ast/AST.hpp"
 #include "AsmCommandList.hpp"
@@ -14,27 +17,37 @@ namespace VlMathPG_AST
 	enum VarType : unsigned char
 	{
 		VARIABLE,
-		NEW_SCOPE
+		NEW_SCOPE,
+		FRAME_ARRAY, // Length and the elements in the frame (ALLOCM, PUSHMI, POPMI)
+		HEAP_ARRAY   // Handle of NEWARR in the frame (LOADA, STOREA)
 	};
 
+	// Arrays of a constant size up to that live in the frame
+	const unsigned short MAX_FRAME_ARRAY = 256;
+
 	class AsmTranslator
 	{
-	private:
+	protected:
 		using VarData = std::tuple<VarType, std::string, unsigned short, CodePos>;
 		std::list<VarData> variables_;
 		unsigned short nextAdress_;
 		std::string curFunc_;
+		std::map<std::string, size_t> functions_; // Of the programme, to their parameter counts
 		
-		unsigned short nextLabel_;
+		unsigned int nextLabel_;
 		std::string randomPrefix_;
 
+		CodePos curPos_; // Of the last .line directive
+
 	public:
 		AsmTranslator() :
 			variables_    ({}),
 			nextAdress_   (0),
 			curFunc_      (""),
+			functions_    (),
 			nextLabel_    (0),
-			randomPrefix_ ("__")
+			randomPrefix_ ("__"),
+			curPos_       ({nullptr, 0, 0})
 		{
 			static const char* alphanum = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
 
@@ -48,7 +61,8 @@ namespace VlMathPG_AST
 		}
 
 		// Functions:
-		AsmTranslator& addVar(std::string var, CodePos varPos)
+		// Takes size slots
+		AsmTranslator& addVar(std::string var, CodePos varPos, VarType varType = VARIABLE, unsigned short size = 1)
 		{
 			for (const auto& [type, name, address, pos] : variables_)
 			{
@@ -60,9 +74,9 @@ namespace VlMathPG_AST
 				}
 			}
 
-			variables_.push_front(VarData(VARIABLE, var, nextAdress_, varPos));
+			variables_.push_front(VarData(varType, var, nextAdress_, varPos));
 
-			nextAdress_++;
+			nextAdress_ += size;
 
 			return *this;
 		}
@@ -79,10 +93,11 @@ namespace VlMathPG_AST
 			while (variables_.size() != 0)
 			{
 				VarType type = std::get<0>(variables_.front());
+				unsigned short address = std::get<2>(variables_.front());
 				variables_.pop_front();
 
 				if (type == NEW_SCOPE) break;
-				nextAdress_--;
+				nextAdress_ = address;
 			}
 
 			return *this;
@@ -92,13 +107,63 @@ namespace VlMathPG_AST
 		{
 			for (const auto& [type, name, address, pos] : variables_)
 			{
-				if (var == name) return address;
+				if (var != name) continue;
+				if (type == VARIABLE) return address;
+
+				throw Exception(ArgMsg("[%s %04zu %03hu] Array used as a value: %s",
+					varPos.file, varPos.line, varPos.col, var.c_str()));
 			}
 
 			throw Exception(ArgMsg("[%s %04zu %03hu] Variable not found: %s",
 				varPos.file, varPos.line, varPos.col, var.c_str()));
 		}
 
+		// Address of the array and its kind
+		unsigned short getArray(std::string var, CodePos varPos, VarType& arrType) const
+		{
+			for (const auto& [type, name, address, pos] : variables_)
+			{
+				if (var != name) continue;
+				if (type == FRAME_ARRAY || type == HEAP_ARRAY)
+				{
+					arrType = type;
+					return address;
+				}
+
+				throw Exception(ArgMsg("[%s %04zu %03hu] Not an array: %s",
+					varPos.file, varPos.line, varPos.col, var.c_str()));
+			}
+
+			throw Exception(ArgMsg("[%s %04zu %03hu] Array not found: %s",
+				varPos.file, varPos.line, varPos.col, var.c_str()));
+		}
+
+		bool isArray(std::string var) const
+		{
+			for (const auto& [type, name, address, pos] : variables_)
+			{
+				if (var == name) return type == FRAME_ARRAY || type == HEAP_ARRAY;
+			}
+
+			return false;
+		}
+
+		AsmTranslator& addFunc(std::string name, size_t paramCount)
+		{
+			functions_[name] = paramCount;
+			return *this;
+		}
+
+		// Built-in function the call of name is, unless the programme has one of the same name and parameters
+		bool isMathFunction(const std::string& name, size_t argCount) const
+		{
+			auto function = VlMathPG_Asm_Command_List::MATH_FUNCTION_TO_ASM.find(name);
+			auto own      = functions_.find(name);
+
+			return function != VlMathPG_Asm_Command_List::MATH_FUNCTION_TO_ASM.end() &&
+			       function->second.second == argCount && (own == functions_.end() || own->second != argCount);
+		}
+
 		AsmTranslator& enterFunc(std::string name)
 		{
 			curFunc_ = name;
@@ -120,46 +185,190 @@ namespace VlMathPG_AST
 		{
 			return randomPrefix_ + std::to_string(nextLabel_++);
 		}
+
+		// Source position of the commands that follow, for the debug section (see DebugInfo.hpp).
+		// Written when it changes only.
+		AsmTranslator& markPos(std::strstream& stream, CodePos pos)
+		{
+			if (pos.file == nullptr || (pos.line == curPos_.line && pos.col == curPos_.col && curPos_.file != nullptr)) return *this;
+
+			curPos_ = pos;
+			stream << ".line " << pos.line + 1 << " " << pos.col + 1 << std::endl;
+
+			return *this;
+		}
+
+		// Shortest text that reads back to the same double, without an exponent, so that
+		// the assemblers of the integer builds take integral literals as they are
+		static std::string literal(double value)
+		{
+			char buffer[400];
+			std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed);
+
+			return std::string(buffer, result.ptr);
+		}
 	};
 
 	using namespace VlMathPG_AST;
 
+	// Name of the array the expression is, empty for other expressions
+	std::string arrayName(const std::shared_ptr<Node>& node, const AsmTranslator& translator)
+	{
+		auto var = std::dynamic_pointer_cast<VariableNode>(node);
+
+		return (var != nullptr && translator.isArray(var->name))? var->name : "";
+	}
+
+	// Arrays of the vector commands are REFM references to the frame or the handles of the heap
+	void pushArrayRefs(std::strstream& stream, AsmTranslator& translator, const std::vector<std::string>& arrays, CodePos pos)
+	{
+		for (const std::string& array : arrays)
+		{
+			VarType type = VARIABLE;
+			unsigned short address = translator.getArray(array, pos, type);
+
+			stream << (type == FRAME_ARRAY? "refm " : "pushm ") << address << std::endl;
+		}
+	}
+
+	// Arrays of sum(a), dot(a, b), min(a) and max(a), which are vector commands; empty for other calls
+	std::vector<std::string> reducedArrays(const CallNode& call, const AsmTranslator& translator)
+	{
+		auto reduction = VlMathPG_Asm_Command_List::REDUCTION_TO_VECTOR_ASM.find(call.name);
+		if (reduction == VlMathPG_Asm_Command_List::REDUCTION_TO_VECTOR_ASM.end() ||
+		    reduction->second.second != call.args.size()) return {};
+
+		std::vector<std::string> arrays{};
+		for (auto arg : call.args) arrays.push_back(arrayName(arg, translator));
+
+		if (std::find(arrays.begin(), arrays.end(), "") != arrays.end()) return {};
+
+		return arrays;
+	}
+
+	// Built-in functions and reductions are commands, not calls
+	bool isBuiltinCall(const CallNode& call, const AsmTranslator& translator)
+	{
+		return translator.isMathFunction(call.name, call.args.size()) || !reducedArrays(call, translator).empty();
+	}
+
+	// c = a op b; is one vector command, so is c = a * b + d; (or d + a * b, rounded once)
+	void translateVectorAssign(std::strstream& stream, AsmTranslator& translator, const std::string& name,
+	                           const std::shared_ptr<Node>& val, CodePos pos)
+	{
+		using VlMathPG_Asm_Command_List::OPERATOR_TO_VECTOR_ASM;
+
+		std::vector<std::string> arrays{name};
+		std::string command{};
+
+		auto op = std::dynamic_pointer_cast<OperationNode>(val);
+		if (op != nullptr && op->args.size() == 2 && OPERATOR_TO_VECTOR_ASM.count(op->name.name) != 0)
+		{
+			std::string left  = arrayName(op->args[0], translator);
+			std::string right = arrayName(op->args[1], translator);
+
+			if (!left.empty() && !right.empty())
+			{
+				arrays.insert(arrays.end(), {left, right});
+				command = OPERATOR_TO_VECTOR_ASM.at(op->name.name);
+			}
+			else if (std::string(op->name.name) == "binl_+" && left.empty() != right.empty())
+			{
+				auto product = std::dynamic_pointer_cast<OperationNode>(op->args[left.empty()? 0 : 1]);
+
+				if (product != nullptr && product->args.size() == 2 && std::string(product->name.name) == "binl_*")
+				{
+					std::string a = arrayName(product->args[0], translator);
+					std::string b = arrayName(product->args[1], translator);
+
+					if (!a.empty() && !b.empty())
+					{
+						arrays.insert(arrays.end(), {a, b, left.empty()? right : left});
+						command = "vfma";
+					}
+				}
+			}
+		}
+
+		if (command.empty())
+		{
+			throw Exception(ArgMsg("[%s %04zu %03hu] Unsupported array expression: %s",
+				pos.file, pos.line, pos.col, name.c_str()));
+		}
+
+		translator.markPos(stream, pos);
+		pushArrayRefs(stream, translator, arrays, pos);
+		stream << command << std::endl << std::endl;
+	}
+
 	void OperationNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
 		for (auto& arg : args) arg->translate(stream, translator);
 
+		translator.markPos(stream, getPos());
+
 		stream << VlMathPG_Asm_Command_List::OPERATOR_TO_ASM.at(name.name) << std::endl;
 	}
 
 	void DataNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
-		stream << "push " << data << std::endl;
+		translator.markPos(stream, getPos());
+
+		stream << "push " << AsmTranslator::literal(data) << std::endl;
 	}
 
 	void VariableNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
 		unsigned short address = translator.getAddress(name, getPos());
 
+		translator.markPos(stream, getPos());
 		stream << "pushm " << address << std::endl;
 	}
 
 	void CallNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
+		std::vector<std::string> arrays = reducedArrays(*this, translator);
+		if (!arrays.empty())
+		{
+			translator.markPos(stream, getPos());
+			pushArrayRefs(stream, translator, arrays, getPos());
+			stream << VlMathPG_Asm_Command_List::REDUCTION_TO_VECTOR_ASM.at(name).first << std::endl;
+			return;
+		}
+
+		if (translator.isMathFunction(name, args.size()))
+		{
+			for (auto arg : args) arg->translate(stream, translator);
+
+			translator.markPos(stream, getPos());
+			stream << VlMathPG_Asm_Command_List::MATH_FUNCTION_TO_ASM.at(name).first << std::endl;
+			return;
+		}
+
+		// Arguments are evaluated in the frame of the caller, BP moves to the first of them afterwards
+		translator.markPos(stream, getPos());
 		stream << "pushr BP" << std::endl;
-		stream << "pushr SP" << std::endl;
-		stream << "popr BP" << std::endl;
 
 		for (auto arg : args) arg->translate(stream, translator);
 
+		translator.markPos(stream, getPos());
+		stream << "pushr SP" << std::endl;
+		stream << "push " << args.size() << std::endl;
+		stream << "sub" << std::endl;
+		stream << "popr BP" << std::endl;
+
 		stream << "call " << name << std::endl;
 	}
 
 	void AssignNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
+		if (translator.isArray(name)) return translateVectorAssign(stream, translator, name, val, getPos());
+
 		val->translate(stream, translator);
 
 		unsigned short address = translator.getAddress(name, getPos());
 
+		translator.markPos(stream, getPos());
 		stream << "popm " << address << std::endl << std::endl;
 	}
 
@@ -169,18 +378,65 @@ namespace VlMathPG_AST
 
 		translator.addVar(name, getPos());
 
+		translator.markPos(stream, getPos());
 		stream << "popm " << translator.getAddress(name, getPos()) << std::endl << std::endl;
 	}
 
+	// A constant size up to MAX_FRAME_ARRAY puts the array to the frame, a larger or computed one to the heap
+	void DefArrayNode::translate(std::strstream& stream, AsmTranslator& translator) const
+	{
+		size->translate(stream, translator);
+
+		auto constant = std::dynamic_pointer_cast<DataNode>(size);
+		bool inFrame = constant != nullptr && constant->data >= 0 && constant->data <= MAX_FRAME_ARRAY &&
+		               constant->data == static_cast<unsigned short>(constant->data);
+
+		if (inFrame) translator.addVar(name, getPos(), FRAME_ARRAY, static_cast<unsigned short>(constant->data) + 1);
+		else         translator.addVar(name, getPos(), HEAP_ARRAY);
+
+		VarType type = VARIABLE;
+		unsigned short address = translator.getArray(name, getPos(), type);
+
+		translator.markPos(stream, getPos());
+		stream << (inFrame? "allocm " : "newarr ") << address << std::endl << std::endl;
+	}
+
+	void IndexNode::translate(std::strstream& stream, AsmTranslator& translator) const
+	{
+		index->translate(stream, translator);
+
+		VarType type = VARIABLE;
+		unsigned short address = translator.getArray(name, getPos(), type);
+
+		translator.markPos(stream, getPos());
+		stream << (type == FRAME_ARRAY? "pushmi " : "loada ") << address << std::endl;
+	}
+
+	void AssignIndexNode::translate(std::strstream& stream, AsmTranslator& translator) const
+	{
+		index->translate(stream, translator);
+		val->translate(stream, translator);
+
+		VarType type = VARIABLE;
+		unsigned short address = translator.getArray(name, getPos(), type);
+
+		translator.markPos(stream, getPos());
+		stream << (type == FRAME_ARRAY? "popmi " : "storea ") << address << std::endl << std::endl;
+	}
+
 	void IfNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
+		translator.markPos(stream, getPos());
+
 		if (cond != nullptr) cond->translate(stream, translator);
 		else stream << "push -1" << std::endl;
 
+		translator.markPos(stream, getPos());
 		stream << "push 0" << std::endl;
 
 		std::string   ifTag = translator.generateLabel();
 		std::string elseTag = translator.generateLabel();
+		std::string  endTag = translator.generateLabel();
 			
 		stream << "ja " <<   ifTag << std::endl;
 		stream << "jmp " << elseTag << std::endl << std::endl;
@@ -189,7 +445,7 @@ namespace VlMathPG_AST
 		
 		stream << ifTag << ":" << std::endl;
 		if (ifTrue != nullptr) ifTrue->translate(stream, translator);
-		stream << std::endl;
+		stream << "jmp " << endTag << std::endl << std::endl;
 		
 		translator.clearScope();
 
@@ -197,7 +453,7 @@ namespace VlMathPG_AST
 
 		stream << elseTag << ":" << std::endl;
 		if (ifFalse != nullptr) ifFalse->translate(stream, translator);
-		stream << std::endl;
+		stream << endTag << ":" << std::endl << std::endl;
 
 		translator.clearScope();
 	}
@@ -208,10 +464,12 @@ namespace VlMathPG_AST
 		std::string endBodyTag = translator.generateLabel();
 
 		stream << condTag << ":" << std::endl;
+		translator.markPos(stream, getPos());
 
 		if (cond != nullptr) cond->translate(stream, translator);
 		else stream << "push -1" << std::endl;
 
+		translator.markPos(stream, getPos());
 		stream << "push 0" << std::endl;
 		stream << "jb " << endBodyTag << std::endl << std::endl;
 
@@ -219,6 +477,7 @@ namespace VlMathPG_AST
 		if (body != nullptr) body->translate(stream, translator);
 		translator.clearScope();
 
+		translator.markPos(stream, getPos());
 		stream << "jmp " << condTag << std::endl;
 
 		stream << endBodyTag << ":" << std::endl << std::endl;
@@ -228,15 +487,31 @@ namespace VlMathPG_AST
 	{
 		toPrint->translate(stream, translator);
 
+		translator.markPos(stream, getPos());
 		stream << "print" << std::endl;
 	}
 
 	void ReturnNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
+		// return f(...) outside of main reuses the frame: the arguments replace the ones of the
+		// current call and f returns straight to its caller, so tail recursion runs in constant stack
+		auto tailCall = std::dynamic_pointer_cast<CallNode>(toReturn);
+		if (tailCall != nullptr && translator.getCurFunc() != "main" && !isBuiltinCall(*tailCall, translator))
+		{
+			for (auto arg : tailCall->args) arg->translate(stream, translator);
+
+			translator.markPos(stream, getPos());
+			stream << "tailcall " << tailCall->args.size() << std::endl;
+			stream << "jmp " << tailCall->name << std::endl;
+			return;
+		}
+
 		std::string cycleTag = translator.generateLabel();
 		std::string leaveCycleTag  = translator.generateLabel();
 
 		toReturn->translate(stream, translator);
+
+		translator.markPos(stream, getPos());
 		stream << "popr RT" << std::endl;
 
 		if (translator.getCurFunc() == "main")
@@ -260,6 +535,9 @@ namespace VlMathPG_AST
 	{
 		translator.newScope(getPos()).enterFunc(name);
 
+		stream << ".func " << name << std::endl;
+		translator.markPos(stream, getPos());
+
 		if (name == "main") stream << "beg" << std::endl;
 
 		stream << name << ":" << std::endl;
@@ -280,6 +558,17 @@ namespace VlMathPG_AST
 
 	void ProgramNode::translate(std::strstream& stream, AsmTranslator& translator) const
 	{
+		for (auto f : funcs)
+		{
+			auto def = std::dynamic_pointer_cast<DefFuncNode>(f);
+			translator.addFunc(def->name, def->params.size());
+		}
+
+		if (!funcs.empty() && funcs.front()->getPos().file != nullptr)
+		{
+			stream << ".source " << funcs.front()->getPos().file << std::endl << std::endl;
+		}
+
 		for (auto f : funcs) f->translate(stream, translator);
 	}
 }
@@ -0,0 +1,358 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef VL_MATH_PG_REG_TRANSLATION
+#define VL_MATH_PG_REG_TRANSLATION
+
+#include <string>
+#include <vector>
+
+#include "AsmTranslation.hpp"
+
+namespace VlMathPG_AST
+{
+	// Variables get registers the way AsmTranslator gives them addresses,
+	// temporaries are allocated right above them and freed after every statement
+	class RegTranslator : public AsmTranslator
+	{
+	private:
+		unsigned short frameSize_;
+
+		void updateFrameSize()
+		{
+			if (nextAdress_ > frameSize_) frameSize_ = nextAdress_;
+		}
+
+	public:
+		RegTranslator() :
+			AsmTranslator(),
+			frameSize_ (0)
+		{}
+
+		// Functions:
+		RegTranslator& addVar(std::string var, CodePos varPos)
+		{
+			AsmTranslator::addVar(var, varPos);
+			updateFrameSize();
+
+			return *this;
+		}
+
+		unsigned short newTemp()
+		{
+			unsigned short temp = nextAdress_++;
+			updateFrameSize();
+
+			return temp;
+		}
+
+		unsigned short tempMark() const
+		{
+			return nextAdress_;
+		}
+
+		RegTranslator& freeTemps(unsigned short mark)
+		{
+			nextAdress_ = mark;
+			return *this;
+		}
+
+		// Puts the value to the first free register
+		unsigned short toNewTemp(std::strstream& stream, unsigned short value)
+		{
+			unsigned short temp = newTemp();
+
+			if (value != temp) stream << "mov " << reg(temp) << " " << reg(value) << std::endl;
+
+			return temp;
+		}
+
+		RegTranslator& resetFrameSize()
+		{
+			frameSize_ = 0;
+			return *this;
+		}
+
+		unsigned short getFrameSize() const
+		{
+			return frameSize_;
+		}
+
+		static std::string reg(unsigned short regNum)
+		{
+			return "r" + std::to_string(regNum);
+		}
+	};
+
+	using namespace VlMathPG_AST;
+
+	unsigned short OperationNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+
+		std::vector<unsigned short> argRegs;
+		for (auto& arg : args) argRegs.push_back(arg->translateReg(stream, translator));
+
+		const std::string& command = VlMathPG_Asm_Command_List::OPERATOR_TO_REG_ASM.at(name.name);
+		if (command.empty()) return argRegs.front();
+
+		translator.freeTemps(mark);
+		unsigned short result = translator.newTemp();
+
+		stream << command << " " << RegTranslator::reg(result);
+		for (auto argReg : argRegs) stream << " " << RegTranslator::reg(argReg);
+		stream << std::endl;
+
+		return result;
+	}
+
+	unsigned short DataNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short result = translator.newTemp();
+
+		stream << "loadk " << RegTranslator::reg(result) << " " << AsmTranslator::literal(data) << std::endl;
+
+		return result;
+	}
+
+	unsigned short VariableNode::translateReg(std::strstream&, RegTranslator& translator) const
+	{
+		return translator.getAddress(name, getPos());
+	}
+
+	// Arguments go to consecutive registers, the callee frame starts at the first of them.
+	// Built-in functions are commands on the registers of the arguments.
+	unsigned short CallNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		if (translator.isMathFunction(name, args.size()))
+		{
+			unsigned short mark = translator.tempMark();
+
+			std::vector<unsigned short> argRegs;
+			for (auto& arg : args) argRegs.push_back(arg->translateReg(stream, translator));
+
+			translator.freeTemps(mark);
+			unsigned short result = translator.newTemp();
+
+			stream << VlMathPG_Asm_Command_List::MATH_FUNCTION_TO_ASM.at(name).first << " " << RegTranslator::reg(result);
+			for (auto argReg : argRegs) stream << " " << RegTranslator::reg(argReg);
+			stream << std::endl;
+
+			return result;
+		}
+
+		unsigned short base = translator.tempMark();
+
+		for (auto arg : args)
+		{
+			unsigned short mark = translator.tempMark();
+			unsigned short value = arg->translateReg(stream, translator);
+
+			translator.freeTemps(mark).toNewTemp(stream, value);
+		}
+
+		translator.freeTemps(base);
+		unsigned short result = translator.newTemp();
+
+		stream << "call " << RegTranslator::reg(result) << " " << name << " " << RegTranslator::reg(base) << std::endl;
+
+		return result;
+	}
+
+	unsigned short AssignNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+		unsigned short value = val->translateReg(stream, translator);
+
+		unsigned short address = translator.getAddress(name, getPos());
+		if (value != address) stream << "mov " << RegTranslator::reg(address) << " " << RegTranslator::reg(value) << std::endl;
+
+		translator.freeTemps(mark);
+		stream << std::endl;
+
+		return 0;
+	}
+
+	unsigned short DefVarNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+		unsigned short value = val->translateReg(stream, translator);
+
+		translator.freeTemps(mark).addVar(name, getPos());
+
+		unsigned short address = translator.getAddress(name, getPos());
+		if (value != address) stream << "mov " << RegTranslator::reg(address) << " " << RegTranslator::reg(value) << std::endl;
+
+		stream << std::endl;
+
+		return 0;
+	}
+
+	// The register machine has no memory but the register file
+	unsigned short DefArrayNode::translateReg(std::strstream&, RegTranslator&) const
+	{
+		throw Exception(ArgMsg("[%s %04zu %03hu] Arrays are not supported by the register machine",
+			getPos().file, getPos().line, getPos().col));
+	}
+
+	unsigned short IndexNode::translateReg(std::strstream&, RegTranslator&) const
+	{
+		throw Exception(ArgMsg("[%s %04zu %03hu] Arrays are not supported by the register machine",
+			getPos().file, getPos().line, getPos().col));
+	}
+
+	unsigned short AssignIndexNode::translateReg(std::strstream&, RegTranslator&) const
+	{
+		throw Exception(ArgMsg("[%s %04zu %03hu] Arrays are not supported by the register machine",
+			getPos().file, getPos().line, getPos().col));
+	}
+
+	unsigned short IfNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+
+		unsigned short condition = 0;
+		if (cond != nullptr) condition = cond->translateReg(stream, translator);
+		else
+		{
+			condition = translator.newTemp();
+			stream << "loadk " << RegTranslator::reg(condition) << " -1" << std::endl;
+		}
+
+		translator.freeTemps(mark);
+
+		std::string   ifTag = translator.generateLabel();
+		std::string elseTag = translator.generateLabel();
+		std::string  endTag = translator.generateLabel();
+
+		stream << "jgz " << RegTranslator::reg(condition) << " " << ifTag << std::endl;
+		stream << "jmp " << elseTag << std::endl << std::endl;
+
+		translator.newScope(getPos());
+
+		stream << ifTag << ":" << std::endl;
+		if (ifTrue != nullptr) ifTrue->translateReg(stream, translator);
+		stream << "jmp " << endTag << std::endl << std::endl;
+
+		translator.clearScope();
+
+		translator.newScope(getPos());
+
+		stream << elseTag << ":" << std::endl;
+		if (ifFalse != nullptr) ifFalse->translateReg(stream, translator);
+		stream << endTag << ":" << std::endl << std::endl;
+
+		translator.clearScope();
+
+		return 0;
+	}
+
+	unsigned short WhileNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		std::string condTag = translator.generateLabel();
+		std::string endBodyTag = translator.generateLabel();
+
+		stream << condTag << ":" << std::endl;
+
+		unsigned short mark = translator.tempMark();
+
+		unsigned short condition = 0;
+		if (cond != nullptr) condition = cond->translateReg(stream, translator);
+		else
+		{
+			condition = translator.newTemp();
+			stream << "loadk " << RegTranslator::reg(condition) << " -1" << std::endl;
+		}
+
+		translator.freeTemps(mark);
+
+		stream << "jlz " << RegTranslator::reg(condition) << " " << endBodyTag << std::endl << std::endl;
+
+		translator.newScope(getPos());
+		if (body != nullptr) body->translateReg(stream, translator);
+		translator.clearScope();
+
+		stream << "jmp " << condTag << std::endl;
+
+		stream << endBodyTag << ":" << std::endl << std::endl;
+
+		return 0;
+	}
+
+	unsigned short PrintNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+
+		unsigned short value = toPrint->translateReg(stream, translator);
+
+		stream << "print " << RegTranslator::reg(value) << std::endl;
+
+		translator.freeTemps(mark);
+
+		return 0;
+	}
+
+	unsigned short ReturnNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		unsigned short mark = translator.tempMark();
+		unsigned short value = toReturn->translateReg(stream, translator);
+
+		translator.freeTemps(mark);
+
+		if (translator.getCurFunc() == "main")
+		{
+			stream << "setrt " << RegTranslator::reg(value) << std::endl;
+			stream << "end" << std::endl;
+			return 0;
+		}
+
+		stream << "ret " << RegTranslator::reg(value) << std::endl;
+
+		return 0;
+	}
+
+	// The frame size is known after the body, so the body is translated separately
+	unsigned short DefFuncNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		translator.newScope(getPos()).enterFunc(name);
+		translator.resetFrameSize();
+
+		if (name == "main") stream << "beg" << std::endl;
+
+		stream << name << ":" << std::endl;
+
+		for (auto param : params) translator.addVar(param, getPos());
+
+		std::strstream body;
+		if (this->body != nullptr) this->body->translateReg(body, translator);
+
+		stream << "enter " << translator.getFrameSize() << std::endl << std::endl;
+		stream.write(body.str(), body.pcount());
+		body.freeze(false);
+
+		translator.clearScope().leaveFunc();
+		stream << std::endl << std::endl;
+
+		return 0;
+	}
+
+	unsigned short StSeqNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		for (auto st : statements) st->translateReg(stream, translator);
+
+		return 0;
+	}
+
+	unsigned short ProgramNode::translateReg(std::strstream& stream, RegTranslator& translator) const
+	{
+		for (auto f : funcs)
+		{
+			auto def = std::dynamic_pointer_cast<DefFuncNode>(f);
+			translator.addFunc(def->name, def->params.size());
+		}
+
+		for (auto f : funcs) f->translateReg(stream, translator);
+
+		return 0;
+	}
+}
+
+#endif  // VL_MATH_PG_REG_TRANSLATION
@@ -10,12 +10,16 @@
 
 #include <algorithm>
 #include <utility>
+#include <charconv>
+#include <cstring>
+#include <cmath>
 
 #include <boost/algorithm/string/predicate.hpp>
 
 #include "../libs/MyException.hpp"
 #include "../libs/FileWork_Old.hpp"
-#include "../assembler_std/Standard1.hpp"
+#include "../assembler_std/Standard2.hpp"
+#include "../assembler_std/DebugInfo.hpp"
 
 // Defines:
 
@@ -71,6 +75,14 @@ namespace AssemblerStd1
 			programme.insert(programme.end(), bytes, bytes + sizeof(toWrite));
 		}
 
+		// Standard 3 command is a whole MyStd1::Instruction: the operand was written at the start of
+		// the record, the command number goes after it
+		void finishInstruction(std::vector<unsigned char>& programme, size_t recordStart, MyStd1::Cmd_t cmd)
+		{
+			programme.resize(recordStart + sizeof(MyStd1::Instruction), 0);
+			programme[recordStart + offsetof(MyStd1::Instruction, cmd)] = cmd;
+		}
+
 	} // namespace _additional
 
 	namespace _registers
@@ -96,14 +108,43 @@ namespace AssemblerStd1
 
 	namespace _value
 	{
-		void writeValueByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		// Integer builds take integers only, integral numbers in the exponent form included
+		bool readValue(const FileWork::Word& word, MyStd1::Val_t& value)
 		{
-			try
+		#ifdef VALUE_TYPE_I64
+
+			const char* end = word.word + std::strlen(word.word);
+			std::from_chars_result result = std::from_chars(word.word, end, value);
+
+			if (result.ec == std::errc{} && result.ptr == end) return true;
+
+			double real = 0;
+			char tail = '\0';
+
+			if (std::sscanf(word.word, "%lf%c", &real, &tail) != 1 || real != std::floor(real) ||
+			    !(std::abs(real) < 9223372036854775808.0))
 			{
-				MyStd1::Val_t toRead = 0;
+				return false;
+			}
 
-				std::sscanf(word.word, MyStd1::INPUT_FORMAT, &toRead);
+			value = static_cast<MyStd1::Val_t>(real);
+			return true;
 
+		#else
+
+			return std::sscanf(word.word, MyStd1::INPUT_FORMAT, &value) == 1;
+
+		#endif
+		}
+
+		void writeValueByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		{
+			MyStd1::Val_t toRead = 0;
+
+			if (!readValue(word, toRead)) throw Exception("Unable to recognise value", word.file, word.word, word.line);
+
+			try
+			{
 				_additional::writeToProgramme<MyStd1::Val_t>(programme, toRead);
 			}
 			catch (std::exception& exc)
@@ -114,15 +155,6 @@ namespace AssemblerStd1
 
 	} // namespace _value
 
-	namespace _commandNum
-	{
-		void writeCmdNumByWord(std::vector<unsigned char>& programme, MyStd1::CmdNum_t cmdNum)
-		{
-			_additional::writeToProgramme<MyStd1::CmdNum_t>(programme, cmdNum);
-		}
-
-	} // namespace _commandNum
-
 	namespace _nameTag
 	{
 		bool isNameTag(const FileWork::Word& word)
@@ -151,9 +183,12 @@ namespace AssemblerStd1
 		(
 			std::vector<unsigned char>& programme,
 			std::map<std::string, std::vector<size_t>>& placesToInsertNameTag,
-			std::map<std::string, MyStd1::CmdNum_t> nameTags
+			std::map<std::string, MyStd1::CmdNum_t> nameTags,
+			MyStd1::StdNum_t std
 		)
 		{
+			size_t cmdNumSize = (std == MyStd1::STD_NUM)? sizeof(MyStd1::CmdNum_t) : sizeof(MyStd1::CmdNum2_t);
+
 			for (auto& strArrPair : placesToInsertNameTag)
 			{
 				auto whatToInsert = nameTags.find(strArrPair.first);
@@ -168,7 +203,8 @@ namespace AssemblerStd1
 				{
 					unsigned char* bytes = reinterpret_cast<unsigned char*>(&toInsert);
 
-					for (size_t curByte = 0; curByte < sizeof(MyStd1::CmdNum_t); ++curByte)
+					// Little endian, so standard 2 takes the lower half
+					for (size_t curByte = 0; curByte < cmdNumSize; ++curByte)
 					{
 						programme[placeToInsert + curByte] = bytes[curByte];
 					}
@@ -180,15 +216,26 @@ namespace AssemblerStd1
 
 	namespace _memory
 	{
-		void writeMemAddressByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		void writeMemAddressByWord(std::vector<unsigned char>& programme, const FileWork::Word& word, MyStd1::StdNum_t std)
 		{
 			try
 			{
-				MyStd1::MemAdr_t toRead = 0;
+				unsigned long toRead = 0;
+
+				std::sscanf(word.word, "%lu", &toRead);
+
+				if (std == MyStd1::STD_NUM)
+				{
+					if (toRead > std::numeric_limits<MyStd1::MemAdr_t>::max()) throw Exception("Memory address is too large", word.file, word.word, word.line);
 
-				std::sscanf(word.word, "%hd", &toRead);
+					_additional::writeToProgramme<MyStd1::MemAdr_t>(programme, static_cast<MyStd1::MemAdr_t>(toRead));
+				}
+				else
+				{
+					if (toRead > std::numeric_limits<MyStd1::MemAdr2_t>::max()) throw Exception("Memory address is too large for standard 2", word.file, word.word, word.line);
 
-				_additional::writeToProgramme<MyStd1::MemAdr_t>(programme, toRead);
+					_additional::writeToProgramme<MyStd1::MemAdr2_t>(programme, static_cast<MyStd1::MemAdr2_t>(toRead));
+				}
 			}
 			catch (std::exception& exc)
 			{
@@ -197,6 +244,86 @@ namespace AssemblerStd1
 		}
 	}
 
+	// Source positions from the translator, see DebugInfo.hpp
+	namespace _directive
+	{
+		bool isDirective(const FileWork::Word& word)
+		{
+			return word.word[0] == '.';
+		}
+
+		// Words longer than FileWork::MAX_WORD_SIZE come split, they are glued back by their columns
+		std::string restOfLine(const std::vector<FileWork::Word>& words, size_t& wordPos)
+		{
+			std::string toReturn{};
+
+			size_t line = words[wordPos].line;
+			size_t end  = words[wordPos].col + std::strlen(words[wordPos].word);
+
+			for (; wordPos + 1 < words.size() && words[wordPos + 1].line == line; ++wordPos)
+			{
+				const FileWork::Word& word = words[wordPos + 1];
+
+				if (!toReturn.empty()) toReturn.append(word.col - end, ' ');
+				toReturn.append(word.word);
+
+				end = word.col + std::strlen(word.word);
+			}
+
+			return toReturn;
+		}
+
+		// The position belongs to the command that is written next
+		void readDirective(const std::vector<FileWork::Word>& words, size_t& wordPos, MyStd1::_debug::DebugInfo& debug,
+		                   MyStd1::CmdNum_t nextCmd)
+		{
+			const FileWork::Word& directive = words[wordPos];
+
+			if (std::strcmp(directive.word, ".source") == 0)
+			{
+				debug.setSource(restOfLine(words, wordPos));
+				return;
+			}
+
+			if (wordPos + 1 >= words.size() || words[wordPos + 1].line != directive.line)
+			{
+				throw Exception("Argument mismatch", directive.file, directive.word, directive.line);
+			}
+
+			++wordPos;
+
+			if (std::strcmp(directive.word, ".func") == 0)
+			{
+				debug.addFunction(nextCmd, words[wordPos].word);
+			}
+			else if (std::strcmp(directive.word, ".line") == 0)
+			{
+				unsigned long line = 0;
+				unsigned long col  = 0;
+
+				if (std::sscanf(words[wordPos].word, "%lu", &line) != 1)
+				{
+					throw Exception("Unable to recognise line", words[wordPos].file, words[wordPos].word, words[wordPos].line);
+				}
+
+				// The column is optional
+				if (wordPos + 1 < words.size() && words[wordPos + 1].line == directive.line)
+				{
+					++wordPos;
+
+					if (std::sscanf(words[wordPos].word, "%lu", &col) != 1)
+					{
+						throw Exception("Unable to recognise column", words[wordPos].file, words[wordPos].word, words[wordPos].line);
+					}
+				}
+
+				debug.addLine(nextCmd, static_cast<uint32_t>(line), static_cast<uint32_t>(col));
+			}
+			else throw Exception("Unknown directive", directive.file, directive.word, directive.line);
+		}
+
+	} // namespace _directive
+
 	namespace _command
 	{
 		void writeCmdByWord
@@ -204,7 +331,8 @@ namespace AssemblerStd1
 			std::vector<unsigned char>& programme,
 			const std::vector<FileWork::Word>& words, 
 			size_t& wordPos,
-			std::map<std::string, std::vector<size_t>>& placesToInsertNameTag
+			std::map<std::string, std::vector<size_t>>& placesToInsertNameTag,
+			MyStd1::StdNum_t std
 		)
 		{
 			using namespace MyStd1::_command;
@@ -216,7 +344,8 @@ namespace AssemblerStd1
 				//  vvvvvvvvvvvvvv
 				if (boost::iequals(words[wordPos].word, COMMANDS[cmdI].name.word))
 				{
-					_additional::writeToProgramme<MyStd1::Cmd_t>(programme, cmdI);
+					size_t recordStart = programme.size();
+					if (std != MyStd1::STD_NUM) _additional::writeToProgramme<MyStd1::Cmd_t>(programme, cmdI);
 
 					// For assertion purposes
 					MyStd1::Cmd_t cmdNamePos = wordPos;
@@ -244,13 +373,20 @@ namespace AssemblerStd1
 							// Inserting current position as a place to insert
 							auto& placeToInsert = placesToInsertNameTag[words[wordPos].word];
 
-							placeToInsert.push_back(programme.size());
-
-							_additional::writeToProgramme<MyStd1::CmdNum_t>(programme, 0);
+							if (std == MyStd1::STD_NUM)
+							{
+								_additional::writeToProgramme<MyStd1::CmdNum_t>(programme, 0);
+								placeToInsert.push_back(programme.size() - sizeof(MyStd1::CmdNum_t));
+							}
+							else
+							{
+								_additional::writeToProgramme<MyStd1::CmdNum2_t>(programme, 0);
+								placeToInsert.push_back(programme.size() - sizeof(MyStd1::CmdNum2_t));
+							}
 						}
 						else if (argType == ArgType::MEMORY_ADDRESS)
 						{
-							_memory::writeMemAddressByWord(programme, words[wordPos]);
+							_memory::writeMemAddressByWord(programme, words[wordPos], std);
 						}
 						else
 						{
@@ -258,6 +394,8 @@ namespace AssemblerStd1
 						}
 					}
 
+					if (std == MyStd1::STD_NUM) _additional::finishInstruction(programme, recordStart, cmdI);
+
 					return;
 				}
 			}	
@@ -267,13 +405,13 @@ namespace AssemblerStd1
 
 	} // namespace _command
 
-	void assemble(const char* src, const char* dest)
+	// std is MyStd1::STD_NUM or MyStd1::STD_NUM_2, withDebug keeps the directives in standard 3
+	void assemble(const char* src, const char* dest, MyStd1::StdNum_t std = MyStd1::STD_NUM, bool withDebug = true)
 	{
-		FileWork::WriteBinaryFile stream{dest};
-
-		// Appending Standard number and magical number
-		stream.writeBytes(std::vector<unsigned char>(1, MyStd1::MAGIC_NUM));
-		stream.writeBytes(std::vector<unsigned char>(1, MyStd1::STD_NUM));
+		if (std == MyStd1::STD_NUM_2 && MyStd1::_values::INTEGER)
+		{
+			throw Exception("Standard 2 keeps doubles only", src, "-", 0);
+		}
 
 		// Preprocessing 
 		std::vector<FileWork::Word> words{_preprocess::preprocessAndSeperate(src)};
@@ -285,12 +423,19 @@ namespace AssemblerStd1
 		std::map<std::string, std::vector<size_t>> placesToInsertNameTag{};
 		std::map<std::string, MyStd1::CmdNum_t> nameTags{}; 
 
+		// Kept by standard 3 only
+		MyStd1::_debug::DebugInfo debug{};
+
 		MyStd1::CmdNum_t curCmd = 0;
 
 		// Going through preprocessed and seperated into words text
 		for (size_t curWord = 0; curWord < words.size(); ++curWord)
 		{
-			if (_nameTag::isNameTag(words[curWord]))
+			if (_directive::isDirective(words[curWord]))
+			{
+				_directive::readDirective(words, curWord, debug, curCmd);
+			}
+			else if (_nameTag::isNameTag(words[curWord]))
 			{
 				// NameTags support
 				std::string curNameTag = _nameTag::replaceColon(words[curWord]);  
@@ -308,7 +453,7 @@ namespace AssemblerStd1
 			{
 				++curCmd;
 				// Parsing command and its arguments
-				_command::writeCmdByWord(programme, words, curWord, placesToInsertNameTag);
+				_command::writeCmdByWord(programme, words, curWord, placesToInsertNameTag, std);
 			}
 		}
 
@@ -316,9 +461,39 @@ namespace AssemblerStd1
 		size_t zero = 0; // lvalue references to rvalue are forbidden
 		                 // so i couldn't write writeCmdByWord(..., 0, ...);
 		                 //                          there vvvv
-		_command::writeCmdByWord(programme, {FileWork::Word("END")}, zero, placesToInsertNameTag);
+		_command::writeCmdByWord(programme, {FileWork::Word("END")}, zero, placesToInsertNameTag, std);
+
+		if (std != MyStd1::STD_NUM && curCmd > std::numeric_limits<MyStd1::CmdNum2_t>::max())
+		{
+			throw Exception("Programme is too large for standard 2", src, "-", 0);
+		}
+
+		_nameTag::insertNameTagsWhereNecessary(programme, placesToInsertNameTag, nameTags, std);
+
+		FileWork::WriteBinaryFile stream{dest};
+
+		// Appending magical number and standard number, standard 3 has the whole header
+		if (std == MyStd1::STD_NUM)
+		{
+			debug.finish(curCmd + 1);
+
+			std::vector<unsigned char> section{};
+			if (withDebug && !debug.empty()) section = debug.encode();
+
+			std::vector<unsigned char> header{};
+			_additional::writeToProgramme<MyStd1::FileHeader>(header, {MyStd1::MAGIC_NUM, MyStd1::STD_NUM, sizeof(MyStd1::FileHeader),
+			                                                           static_cast<uint32_t>(curCmd + 1),
+			                                                           static_cast<uint32_t>(programme.size()),
+			                                                           static_cast<uint32_t>(section.size())});
+			stream.writeBytes(header);
 
-		_nameTag::insertNameTagsWhereNecessary(programme, placesToInsertNameTag, nameTags);
+			programme.insert(programme.end(), section.begin(), section.end());
+		}
+		else
+		{
+			stream.writeBytes(std::vector<unsigned char>(1, MyStd1::MAGIC_NUM));
+			stream.writeBytes(std::vector<unsigned char>(1, MyStd1::STD_NUM_2));
+		}
 
 		stream.writeBytes(programme);
 	}
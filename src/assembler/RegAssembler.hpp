@@ -0,0 +1,200 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_REG_ASSEMBLER_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_REG_ASSEMBLER_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include "Assembler.hpp"
+#include "../assembler_std/RegStandard.hpp"
+
+// Defines:
+
+#define FILENAME "reg/RegAssembler.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// Text of the register machine is split into words and nametags just like the stack one
+namespace AssemblerReg
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	using AssemblerStd1::_additional::writeToProgramme;
+
+	namespace _operands
+	{
+		void writeRegisterByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		{
+			MyRegStd::RegNum_t regNum = 0;
+			char tail = '\0';
+
+			if (word.word[0] != MyRegStd::REGISTER_PREFIX || std::sscanf(word.word + 1, "%hu%c", &regNum, &tail) != 1)
+			{
+				throw Exception("Unable to recognise register", word.file, word.word, word.line);
+			}
+
+			writeToProgramme<MyRegStd::RegNum_t>(programme, regNum);
+		}
+
+		void writeValueByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		{
+			MyRegStd::Val_t value = 0;
+
+			if (!AssemblerStd1::_value::readValue(word, value))
+			{
+				throw Exception("Unable to recognise value", word.file, word.word, word.line);
+			}
+
+			writeToProgramme<MyRegStd::Val_t>(programme, value);
+		}
+
+		void writeCountByWord(std::vector<unsigned char>& programme, const FileWork::Word& word)
+		{
+			MyRegStd::RegNum_t count = 0;
+
+			if (std::sscanf(word.word, "%hu", &count) != 1)
+			{
+				throw Exception("Unable to recognise count", word.file, word.word, word.line);
+			}
+
+			writeToProgramme<MyRegStd::RegNum_t>(programme, count);
+		}
+
+	} // namespace _operands
+
+	namespace _nameTag
+	{
+		void insertNameTags
+		(
+			std::vector<unsigned char>& programme,
+			const std::map<std::string, std::vector<size_t>>& placesToInsertNameTag,
+			const std::map<std::string, MyRegStd::CmdNum_t>& nameTags
+		)
+		{
+			for (auto& strArrPair : placesToInsertNameTag)
+			{
+				auto whatToInsert = nameTags.find(strArrPair.first);
+
+				if (whatToInsert == nameTags.end())
+				{
+					throw Exception("Unable to find corresponding nametag", "", strArrPair.first.c_str(), 0);
+				}
+
+				for (size_t placeToInsert : strArrPair.second)
+				{
+					std::memcpy(programme.data() + placeToInsert, &whatToInsert->second, sizeof(MyRegStd::CmdNum_t));
+				}
+			}
+		}
+
+	} // namespace _nameTag
+
+	namespace _command
+	{
+		void writeCmdByWord
+		(
+			std::vector<unsigned char>& programme,
+			const std::vector<FileWork::Word>& words,
+			size_t& wordPos,
+			std::map<std::string, std::vector<size_t>>& placesToInsertNameTag
+		)
+		{
+			using namespace MyRegStd;
+
+			for (Cmd_t cmdI = 0; cmdI < COMMAND_COUNT; ++cmdI)
+			{
+				if (!boost::iequals(words[wordPos].word, COMMANDS[cmdI].name.word)) continue;
+
+				writeToProgramme<Cmd_t>(programme, cmdI);
+
+				size_t cmdNamePos = wordPos;
+
+				for (auto argType : COMMANDS[cmdI].argTypes)
+				{
+					++wordPos;
+
+					if (wordPos >= words.size())
+					{
+						throw Exception("Argument mismatch", words[cmdNamePos].file, COMMANDS[cmdI].name.word, words[cmdNamePos].line);
+					}
+
+					switch (argType)
+					{
+						case ArgType::REGISTER: _operands::writeRegisterByWord(programme, words[wordPos]); break;
+						case ArgType::VALUE:    _operands::writeValueByWord   (programme, words[wordPos]); break;
+						case ArgType::COUNT:    _operands::writeCountByWord   (programme, words[wordPos]); break;
+						case ArgType::NAMETAG:
+						{
+							placesToInsertNameTag[words[wordPos].word].push_back(programme.size());
+							writeToProgramme<CmdNum_t>(programme, 0);
+							break;
+						}
+						default: throw Exception("Unexpected argType", PROGRAM_POS);
+					}
+				}
+
+				return;
+			}
+
+			throw Exception("Unable to recognise command name", words[wordPos].file, words[wordPos].word, words[wordPos].line);
+		}
+
+	} // namespace _command
+
+	void assemble(const char* src, const char* dest)
+	{
+		FileWork::WriteBinaryFile stream{dest};
+
+		stream.writeBytes(std::vector<unsigned char>(1, MyStd1::MAGIC_NUM));
+		stream.writeBytes(std::vector<unsigned char>(1, MyRegStd::STD_NUM));
+
+		std::vector<FileWork::Word> words{AssemblerStd1::_preprocess::preprocessAndSeperate(src)};
+
+		std::vector<unsigned char> programme{};
+
+		std::map<std::string, std::vector<size_t>> placesToInsertNameTag{};
+		std::map<std::string, MyRegStd::CmdNum_t> nameTags{};
+
+		MyRegStd::CmdNum_t curCmd = 0;
+
+		for (size_t curWord = 0; curWord < words.size(); ++curWord)
+		{
+			if (AssemblerStd1::_nameTag::isNameTag(words[curWord]))
+			{
+				std::string curNameTag = AssemblerStd1::_nameTag::replaceColon(words[curWord]);
+
+				if (nameTags.find(curNameTag) != nameTags.end())
+				{
+					throw Exception("Two equivalent nametags found", src, words[curWord].word, words[curWord].line);
+				}
+
+				nameTags[curNameTag] = curCmd;
+			}
+			else
+			{
+				++curCmd;
+				_command::writeCmdByWord(programme, words, curWord, placesToInsertNameTag);
+			}
+		}
+
+		// END allows nametags at the end of the programme
+		size_t zero = 0;
+		_command::writeCmdByWord(programme, {FileWork::Word("END")}, zero, placesToInsertNameTag);
+
+		_nameTag::insertNameTags(programme, placesToInsertNameTag, nameTags);
+
+		stream.writeBytes(programme);
+	}
+
+} // namespace AssemblerReg
+
+// Undefs:
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_REG_ASSEMBLER_HPP_INCLUDED*/
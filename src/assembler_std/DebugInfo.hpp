@@ -0,0 +1,402 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_DEBUG_INFO_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_DEBUG_INFO_HPP_INCLUDED
+
+// Includes:
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <exception>
+
+#include <cstdint>
+#include <cstring>
+
+#include "../libs/MyException.hpp"
+#include "../libs/FileWork_Old.hpp"
+#include "Standard2.hpp"
+
+// Defines:
+
+#define FILENAME "std1/DebugInfo.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// Source positions of a standard 3 programme. The translator writes them into the assembly as
+// directives, the assembler keeps them in the debug section after the code:
+//
+//     .source <file>       following commands come from the file, the rest of the line
+//     .func <name>         following commands up to the next .func belong to the function
+//     .line <n> [<col>]    following commands come from the line n and the column col (both from 1)
+//
+// The section is SectionHeader, the rows, the functions and the strings. A row starts where
+// the position changes: varint (command delta << 1 | file changed), varint file if it changed,
+// zigzag varint line delta, varint column. A function is varint start delta (from the end of
+// the previous one), varint length and varint name. Files and names are offsets in the strings.
+//
+// Nothing reads the section while a programme runs: reports and runtime errors decode it.
+namespace MyStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _debug
+	{
+		struct SectionHeader
+		{
+		public:
+			// Variables:
+				uint32_t rowCount;
+				uint32_t functionCount;
+				uint32_t tablesSize;    // Bytes of the rows and the functions
+				uint32_t stringsSize;
+		};
+
+		// Position of the commands from firstCmd up to the next row
+		struct Row
+		{
+		public:
+			// Variables:
+				CmdNum_t firstCmd;
+				uint32_t file;          // Index in DebugInfo::file()
+				uint32_t line;
+				uint32_t col;
+		};
+
+		// Commands [first, end)
+		struct Function
+		{
+		public:
+			// Variables:
+				CmdNum_t first;
+				CmdNum_t end;
+				uint32_t name;          // Index in DebugInfo::function()
+		};
+
+		//-----------------------------------------------------------------------------
+
+		void writeVarint(std::vector<unsigned char>& bytes, uint64_t value)
+		{
+			for (; value >= 0x80; value >>= 7) bytes.push_back(static_cast<unsigned char>(value | 0x80));
+
+			bytes.push_back(static_cast<unsigned char>(value));
+		}
+
+		uint64_t readVarint(const unsigned char*& cur, const unsigned char* end)
+		{
+			uint64_t value = 0;
+
+			for (unsigned shift = 0; shift < 64; shift += 7)
+			{
+				if (cur == end) throw Exception("Broken debug section", PROGRAM_POS);
+
+				unsigned char byte = *cur++;
+				value |= uint64_t{byte & 0x7Fu} << shift;
+
+				if ((byte & 0x80) == 0) return value;
+			}
+
+			throw Exception("Broken debug section", PROGRAM_POS);
+		}
+
+		uint64_t zigzag(int64_t value)
+		{
+			return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		}
+
+		int64_t unzigzag(uint64_t value)
+		{
+			return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		}
+
+		//-----------------------------------------------------------------------------
+
+		class DebugInfo
+		{
+		public:
+			// Ctor:
+				DebugInfo() :
+					rows_      (),
+					functions_ (),
+					files_     (),
+					names_     (),
+					curFile_   (0)
+				{}
+
+			// Filling (in the order of the commands):
+				void setSource(const std::string& file)
+				{
+					auto known = std::find(files_.begin(), files_.end(), file);
+
+					curFile_ = static_cast<uint32_t>(known - files_.begin());
+					if (known == files_.end()) files_.push_back(file);
+				}
+
+				// A later position of the same command replaces the earlier one
+				void addLine(CmdNum_t firstCmd, uint32_t line, uint32_t col)
+				{
+					if (files_.empty()) setSource("");
+
+					if (!rows_.empty() && rows_.back().firstCmd == firstCmd) rows_.pop_back();
+
+					const Row row{firstCmd, curFile_, line, col};
+					if (!rows_.empty() && rows_.back().file == row.file && rows_.back().line == line && rows_.back().col == col) return;
+
+					rows_.push_back(row);
+				}
+
+				void addFunction(CmdNum_t firstCmd, const std::string& name)
+				{
+					if (!functions_.empty() && functions_.back().first == firstCmd) functions_.pop_back();
+					if (!functions_.empty()) functions_.back().end = firstCmd;
+
+					functions_.push_back({firstCmd, firstCmd, static_cast<uint32_t>(names_.size())});
+					names_.push_back(name);
+				}
+
+				// The last function lasts till the end of the programme
+				void finish(CmdNum_t commandCount)
+				{
+					if (!functions_.empty()) functions_.back().end = commandCount;
+				}
+
+			// Access:
+				bool empty() const
+				{
+					return rows_.empty() && functions_.empty();
+				}
+
+				size_t fileCount() const
+				{
+					return files_.size();
+				}
+
+				const std::string& file(uint32_t index) const
+				{
+					return files_[index];
+				}
+
+				const std::string& function(uint32_t index) const
+				{
+					return names_[index];
+				}
+
+				// nullptr when the command has no position
+				const Row* rowOf(CmdNum_t cmd) const
+				{
+					auto after = std::upper_bound(rows_.begin(), rows_.end(), cmd,
+					                              [](CmdNum_t value, const Row& row) { return value < row.firstCmd; });
+
+					return (after == rows_.begin())? nullptr : &*(after - 1);
+				}
+
+				// nullptr when the command is in no function
+				const Function* functionOf(CmdNum_t cmd) const
+				{
+					auto after = std::upper_bound(functions_.begin(), functions_.end(), cmd,
+					                              [](CmdNum_t value, const Function& function) { return value < function.first; });
+
+					if (after == functions_.begin() || (after - 1)->end <= cmd) return nullptr;
+					return &*(after - 1);
+				}
+
+			// Section:
+				std::vector<unsigned char> encode() const
+				{
+					std::vector<unsigned char> strings{};
+					std::map<std::string, uint32_t> offsets{};
+
+					auto addString = [&strings, &offsets](const std::string& string)
+					{
+						auto known = offsets.find(string);
+						if (known != offsets.end()) return known->second;
+
+						uint32_t offset = static_cast<uint32_t>(strings.size());
+						strings.insert(strings.end(), string.begin(), string.end());
+						strings.push_back('\0');
+
+						offsets[string] = offset;
+						return offset;
+					};
+
+					std::vector<unsigned char> tables{};
+
+					Row last{0, UINT32_MAX, 0, 0};
+					for (const Row& row : rows_)
+					{
+						bool fileChanged = row.file != last.file;
+
+						writeVarint(tables, uint64_t{row.firstCmd - last.firstCmd} << 1 | (fileChanged? 1 : 0));
+						if (fileChanged) writeVarint(tables, addString(files_[row.file]));
+						writeVarint(tables, zigzag(int64_t{row.line} - int64_t{last.line}));
+						writeVarint(tables, row.col);
+
+						last = row;
+					}
+
+					CmdNum_t lastEnd = 0;
+					for (const Function& function : functions_)
+					{
+						writeVarint(tables, function.first - lastEnd);
+						writeVarint(tables, function.end - function.first);
+						writeVarint(tables, addString(names_[function.name]));
+
+						lastEnd = function.end;
+					}
+
+					SectionHeader header{static_cast<uint32_t>(rows_.size()), static_cast<uint32_t>(functions_.size()),
+					                     static_cast<uint32_t>(tables.size()), static_cast<uint32_t>(strings.size())};
+
+					std::vector<unsigned char> section(sizeof(header));
+					std::memcpy(section.data(), &header, sizeof(header));
+
+					section.insert(section.end(), tables.begin(), tables.end());
+					section.insert(section.end(), strings.begin(), strings.end());
+
+					return section;
+				}
+
+				static DebugInfo decode(const unsigned char* section, size_t size)
+				{
+					SectionHeader header{};
+					if (size < sizeof(header)) throw Exception("Broken debug section", PROGRAM_POS);
+
+					std::memcpy(&header, section, sizeof(header));
+
+					if (size != sizeof(header) + size_t{header.tablesSize} + header.stringsSize ||
+					    (header.stringsSize != 0 && section[size - 1] != '\0'))
+					{
+						throw Exception("Broken debug section", PROGRAM_POS);
+					}
+
+					const unsigned char* cur = section + sizeof(header);
+					const unsigned char* end = cur + header.tablesSize;
+					const char*      strings = reinterpret_cast<const char*>(end);
+
+					auto string = [&](uint64_t offset) -> std::string
+					{
+						if (offset >= header.stringsSize) throw Exception("Broken debug section", PROGRAM_POS);
+						return strings + offset;
+					};
+
+					DebugInfo info{};
+					info.rows_.reserve(header.rowCount);
+
+					Row row{0, 0, 0, 0};
+					for (uint32_t i = 0; i < header.rowCount; ++i)
+					{
+						uint64_t delta = readVarint(cur, end);
+						if (i == 0 && (delta & 1) == 0) throw Exception("Broken debug section", PROGRAM_POS);
+
+						if ((delta & 1) != 0) info.setSource(string(readVarint(cur, end)));
+
+						row.firstCmd += static_cast<CmdNum_t>(delta >> 1);
+						row.file      = info.curFile_;
+						row.line      = static_cast<uint32_t>(row.line + unzigzag(readVarint(cur, end)));
+						row.col       = static_cast<uint32_t>(readVarint(cur, end));
+
+						info.rows_.push_back(row);
+					}
+
+					CmdNum_t lastEnd = 0;
+					for (uint32_t i = 0; i < header.functionCount; ++i)
+					{
+						CmdNum_t first = lastEnd + static_cast<CmdNum_t>(readVarint(cur, end));
+						CmdNum_t last  = first   + static_cast<CmdNum_t>(readVarint(cur, end));
+
+						info.functions_.push_back({first, last, static_cast<uint32_t>(info.names_.size())});
+						info.names_.push_back(string(readVarint(cur, end)));
+
+						lastEnd = last;
+					}
+
+					if (cur != end) throw Exception("Broken debug section", PROGRAM_POS);
+
+					return info;
+				}
+
+		private:
+			// Variables:
+				std::vector<Row> rows_;
+				std::vector<Function> functions_;
+				std::vector<std::string> files_;
+				std::vector<std::string> names_;
+				uint32_t curFile_;
+		};
+
+		// Debug section of a programme file, empty for standard 2 and for files without it
+		DebugInfo read(const char* filename)
+		{
+			FileWork::MappedBinaryFile file{filename};
+
+			FileHeader header{};
+			if (file.size() < sizeof(header)) return {};
+
+			std::memcpy(&header, file.data(), sizeof(header));
+
+			if (header.magic != MAGIC_NUM || header.std != STD_NUM || header.debugSize == 0) return {};
+
+			size_t start = size_t{header.headerSize} + header.codeSize;
+			if (file.size() < start || file.size() - start < header.debugSize)
+			{
+				throw Exception("Broken debug section", filename, "-", 0);
+			}
+
+			return DebugInfo::decode(file.data() + start, header.debugSize);
+		}
+
+		//-----------------------------------------------------------------------------
+
+		// Fields of the Exception the engines throw for a runtime error
+		struct ErrorPosition
+		{
+		public:
+			// Variables:
+				std::string message;
+				std::string file;
+				std::string function;
+				unsigned    line;
+		};
+
+		// Where the command cmd of the programme comes from, the programme itself when the file has no
+		// debug section or cmd is past the end. Exception keeps pointers, so the strings live until
+		// the next call on the thread.
+		const ErrorPosition& locateError(const char* filename, CmdNum_t cmd, size_t commandCount)
+		{
+			thread_local ErrorPosition position{};
+			position = {"Runtime error", filename, "-", 0};
+
+			if (cmd >= commandCount) return position;
+
+			try
+			{
+				DebugInfo debug{read(filename)};
+
+				const Row* row = debug.rowOf(cmd);
+				if (row == nullptr) return position;
+
+				const Function* function = debug.functionOf(cmd);
+
+				if (!debug.file(row->file).empty()) position.file = debug.file(row->file);
+				if (function != nullptr)            position.function = debug.function(function->name);
+				if (row->col != 0)                  position.message = "Runtime error in column " + std::to_string(row->col);
+
+				position.line = row->line;
+			}
+			catch (std::exception&)
+			{
+				// A broken section leaves the error where it is
+			}
+
+			return position;
+		}
+
+	} // namespace _debug
+
+} // namespace MyStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_DEBUG_INFO_HPP_INCLUDED*/
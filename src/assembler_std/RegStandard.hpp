@@ -0,0 +1,141 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_REG_STANDARD_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_REG_STANDARD_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+
+#include "Standard2.hpp"
+
+// Code:
+
+// Register machine: three-address commands over the registers of the current frame.
+// Registers are numbered from the frame base, function arguments come first.
+namespace MyRegStd
+{
+	using MyStd1::Val_t;
+	using MyStd1::Cmd_t;
+	using MyStd1::MagicNum_t;
+	using MyStd1::StdNum_t;
+
+	using RegNum_t = unsigned short;
+	using CmdNum_t = unsigned int;
+
+	// Stack machine files have small numbers
+	const StdNum_t STD_NUM_DOUBLE = 0x52;
+	const StdNum_t STD_NUM_I64    = 0x53;
+
+#ifdef VALUE_TYPE_I64
+	const StdNum_t STD_NUM = STD_NUM_I64;
+#else
+	const StdNum_t STD_NUM = STD_NUM_DOUBLE;
+#endif
+
+	// Assembler prints registers as r<number>
+	const char REGISTER_PREFIX = 'r';
+
+	//-----------------------------------------------------------------------------
+
+	enum class ArgType
+	{
+		REGISTER,
+		VALUE,
+		NAMETAG,
+		COUNT
+	};
+
+	using Word = FileWork::Word;
+
+	struct CommandType
+	{
+	public:
+		// Variables:
+			FileWork::Word name;
+			const std::vector<ArgType> argTypes;
+	};
+
+	const CommandType COMMANDS[] =
+	{
+		{Word(  "BEG"), {}},                                                      //0
+		{Word(  "END"), {}},                                                      //1
+		{Word("ENTER"), {ArgType::COUNT}},                                        //2  frame size
+		{Word("LOADK"), {ArgType::REGISTER, ArgType::VALUE}},                     //3
+		{Word(  "MOV"), {ArgType::REGISTER, ArgType::REGISTER}},                  //4
+		{Word(  "NEG"), {ArgType::REGISTER, ArgType::REGISTER}},                  //5
+		{Word(  "ADD"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //6
+		{Word(  "SUB"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //7
+		{Word(  "MUL"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //8
+		{Word(  "DIV"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //9
+		{Word( "IS_L"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //10
+		{Word("IS_LE"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //11
+		{Word( "IS_M"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //12
+		{Word("IS_ME"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //13
+		{Word( "IS_E"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //14
+		{Word("IS_NE"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //15
+		{Word(  "AND"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //16
+		{Word(   "OR"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //17
+		{Word(  "JMP"), {ArgType::NAMETAG}},                                      //18
+		{Word(  "JGZ"), {ArgType::REGISTER, ArgType::NAMETAG}},                   //19 jump if > 0
+		{Word(  "JLZ"), {ArgType::REGISTER, ArgType::NAMETAG}},                   //20 jump if < 0
+		{Word( "CALL"), {ArgType::REGISTER, ArgType::NAMETAG, ArgType::REGISTER}},  //21 result, function, frame base
+		{Word(  "RET"), {ArgType::REGISTER}},                                     //22
+		{Word("SETRT"), {ArgType::REGISTER}},                                     //23 value END reports
+		{Word("PRINT"), {ArgType::REGISTER}},                                     //24
+		{Word( "SQRT"), {ArgType::REGISTER, ArgType::REGISTER}},                  //25
+		{Word(  "SIN"), {ArgType::REGISTER, ArgType::REGISTER}},                  //26
+		{Word(  "COS"), {ArgType::REGISTER, ArgType::REGISTER}},                  //27
+		{Word(  "EXP"), {ArgType::REGISTER, ArgType::REGISTER}},                  //28
+		{Word(  "LOG"), {ArgType::REGISTER, ArgType::REGISTER}},                  //29
+		{Word(  "POW"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //30
+		{Word(  "ABS"), {ArgType::REGISTER, ArgType::REGISTER}},                  //31
+		{Word("FLOOR"), {ArgType::REGISTER, ArgType::REGISTER}},                  //32
+		{Word(  "MIN"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}, //33
+		{Word(  "MAX"), {ArgType::REGISTER, ArgType::REGISTER, ArgType::REGISTER}}  //34
+	};
+
+	const Cmd_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(*COMMANDS);
+
+	// Command codes (indices in COMMANDS):
+	enum CmdCode : Cmd_t
+	{
+		REG_BEG   =  0,
+		REG_END   =  1,
+		REG_ENTER =  2,
+		REG_LOADK =  3,
+		REG_MOV   =  4,
+		REG_NEG   =  5,
+		REG_ADD   =  6,
+		REG_SUB   =  7,
+		REG_MUL   =  8,
+		REG_DIV   =  9,
+		REG_IS_L  = 10,
+		REG_IS_LE = 11,
+		REG_IS_M  = 12,
+		REG_IS_ME = 13,
+		REG_IS_E  = 14,
+		REG_IS_NE = 15,
+		REG_AND   = 16,
+		REG_OR    = 17,
+		REG_JMP   = 18,
+		REG_JGZ   = 19,
+		REG_JLZ   = 20,
+		REG_CALL  = 21,
+		REG_RET   = 22,
+		REG_SETRT = 23,
+		REG_PRINT = 24,
+		REG_SQRT  = 25,
+		REG_SIN   = 26,
+		REG_COS   = 27,
+		REG_EXP   = 28,
+		REG_LOG   = 29,
+		REG_POW   = 30,
+		REG_ABS   = 31,
+		REG_FLOOR = 32,
+		REG_MIN   = 33,
+		REG_MAX   = 34
+	};
+
+} // namespace MyRegStd
+
+#endif /*HEADER_GUARD_MY_COMPILER_REG_STANDARD_HPP_INCLUDED*/
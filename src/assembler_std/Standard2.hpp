@@ -9,14 +9,24 @@
 #include <vector>
 
 #include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
 #include <functional>
 #include <limits>
 #include <cmath>
+#include <charconv>
 
 #include <cstdio>
+#include <cstdint>
+#include <cinttypes>
+#include <cstddef>
 
 #include "../libs/MyException.hpp" 
 #include "../libs/Stack.hpp"
+#include "../libs/GrowableStack.hpp"
+#include "../libs/FileWork_Old.hpp"
+#include "../libs/VectorKernels.hpp"
 
 // Defines:
 
@@ -29,24 +39,173 @@ namespace MyStd1
 	using namespace MyStackStaticArrayRepresentation;
 
 	using RegAdr_t = unsigned char;
+#ifdef VALUE_TYPE_I64
+	using Val_t    = int64_t; // Build of the tools for integer programmes, see _values
+#else
 	using Val_t    = double; // Change PRINT_FORMAT
+#endif
 	using Cmd_t    = unsigned char;
-	using CmdNum_t = unsigned short;
-	using MemAdr_t = unsigned short;
+	using CmdNum_t = uint32_t;
+	using MemAdr_t = uint32_t;
 
 	using MagicNum_t = unsigned char;
 	using   StdNum_t = unsigned char;
 
 	MagicNum_t MAGIC_NUM = 0xBA;
-	StdNum_t STD_NUM = 2;
 
-	const char*  INPUT_FORMAT = "%lf";
-	const char* OUTPUT_FORMAT = "%.03lf\n";	
+	// Standard 3 files of the two value types have own numbers, the executor runs the ones of its build
+	const StdNum_t STD_NUM_DOUBLE = 3;
+	const StdNum_t STD_NUM_I64    = 0x13;
+
+#ifdef VALUE_TYPE_I64
+	StdNum_t STD_NUM = STD_NUM_I64;
+#else
+	StdNum_t STD_NUM = STD_NUM_DOUBLE;
+#endif
+
+	// Standard 2 is still read and written, it packs 16 bit command numbers and memory addresses
+	StdNum_t STD_NUM_2 = 2;
+
+	// Loaders give it for the files of the other value type
+#ifdef VALUE_TYPE_I64
+	const char* OTHER_VALUE_TYPE = "Programme has double values, the executor is built for int64 ones (VALUE_TYPE_I64)";
+#else
+	const char* OTHER_VALUE_TYPE = "Programme has int64 values (VALUE_TYPE_I64), the executor is built for double ones";
+#endif
+
+	using CmdNum2_t = uint16_t;
+	using MemAdr2_t = uint16_t;
+
+	// Command with its operand, the executor keeps programmes as arrays of them
+	struct Instruction
+	{
+	public:
+		// Variables:
+			union
+			{
+				Val_t    value;
+				RegAdr_t regAdr;
+				CmdNum_t cmdNum;
+				MemAdr_t memAdr;
+			} arg;
+			Cmd_t cmd;
+	};
+
+	// Standard 3 file starts with the header, the code section follows it. The code section is
+	// the array of Instructions as they are in memory, so the executor runs the mapped file in place.
+	// The header size keeps the code section aligned. The debug section, if any, follows the code
+	// (see DebugInfo.hpp), the executor reads it only for reports.
+	struct FileHeader
+	{
+	public:
+		// Variables:
+			MagicNum_t magic;
+			StdNum_t   std;
+			uint16_t   headerSize;   // Bytes, a multiple of 8
+			uint32_t   commandCount;
+			uint32_t   codeSize;     // Bytes, commandCount * sizeof(Instruction)
+			uint32_t   debugSize;    // Bytes, 0 when the file has no debug section
+	};
+
+	static_assert(sizeof(Instruction) == 16 && offsetof(Instruction, cmd) == 8, "Instruction is the standard 3 record");
+	static_assert(sizeof(FileHeader)  == 16,                                     "FileHeader is written as it is");
+
+#ifdef VALUE_TYPE_I64
+	const char*    INPUT_FORMAT = "%" SCNd64;
+	const char*   OUTPUT_FORMAT = "%" PRId64 "\n";
+	const char*      END_FORMAT = "\nExecution finished succesefully\nProcess returned: %" PRId64 "\n";
+	const char* REGISTER_FORMAT = "%s: %" PRId64 "\n";
+#else
+	const char*    INPUT_FORMAT = "%lf";
+	const char*   OUTPUT_FORMAT = "%.03lf\n";	
+	const char*      END_FORMAT = "\nExecution finished succesefully\nProcess returned: %f\n";
+	const char* REGISTER_FORMAT = "%s: %lf\n";
+#endif
 
 	const char* SINGLE_LINE_COMMENT = "//";
 
 	//-----------------------------------------------------------------------------
 
+	// Arithmetic every engine does the same way. Doubles compare equal within a relative epsilon,
+	// 64 bit integers are exact: they wrap around on overflow, divide toward zero and the results
+	// of the math functions (computed on doubles) are truncated and clamped to the range.
+	namespace _values
+	{
+	#ifdef VALUE_TYPE_I64
+
+		inline Val_t add(Val_t l, Val_t r) { return static_cast<Val_t>(static_cast<uint64_t>(l) + static_cast<uint64_t>(r)); }
+		inline Val_t sub(Val_t l, Val_t r) { return static_cast<Val_t>(static_cast<uint64_t>(l) - static_cast<uint64_t>(r)); }
+		inline Val_t mul(Val_t l, Val_t r) { return static_cast<Val_t>(static_cast<uint64_t>(l) * static_cast<uint64_t>(r)); }
+
+		// The smallest value divided by -1 overflows too
+		inline Val_t div(Val_t l, Val_t r) { return (r == -1)? sub(0, l) : l / r; }
+
+		inline bool isZero(Val_t x)         { return x == 0; }
+		inline bool equal (Val_t l, Val_t r) { return l == r; }
+
+		inline Val_t min(Val_t l, Val_t r) { return (l < r)? l : r; }
+		inline Val_t max(Val_t l, Val_t r) { return (l > r)? l : r; }
+
+		inline Val_t abs(Val_t x) { return (x < 0)? sub(0, x) : x; }
+
+		inline Val_t fromReal(double x)
+		{
+			if (std::isnan(x)) return 0;
+			if (x >=  9223372036854775808.0) return std::numeric_limits<Val_t>::max();
+			if (x <  -9223372036854775808.0) return std::numeric_limits<Val_t>::min();
+
+			return static_cast<Val_t>(x);
+		}
+
+		// False when the power is not a real number: never, 0 to a negative power is clamped
+		inline bool pow(Val_t base, Val_t exponent, Val_t& power)
+		{
+			if (exponent < 0)
+			{
+				power = fromReal(std::pow(static_cast<double>(base), static_cast<double>(exponent)));
+				return true;
+			}
+
+			for (power = 1; exponent != 0; exponent >>= 1)
+			{
+				if (exponent & 1) power = mul(power, base);
+				base = mul(base, base);
+			}
+
+			return true;
+		}
+
+	#else
+
+		inline Val_t add(Val_t l, Val_t r) { return l + r; }
+		inline Val_t sub(Val_t l, Val_t r) { return l - r; }
+		inline Val_t mul(Val_t l, Val_t r) { return l * r; }
+		inline Val_t div(Val_t l, Val_t r) { return l / r; }
+
+		inline bool isZero(Val_t x)         { return std::abs(x) <= std::numeric_limits<Val_t>::epsilon() * 5; }
+		inline bool equal (Val_t l, Val_t r) { return std::abs(l-r) <= 5 * std::abs(l+r) * std::numeric_limits<Val_t>::epsilon(); }
+
+		inline Val_t min(Val_t l, Val_t r) { return std::fmin(l, r); }
+		inline Val_t max(Val_t l, Val_t r) { return std::fmax(l, r); }
+
+		inline Val_t abs(Val_t x) { return std::fabs(x); } // -0 too
+
+		inline Val_t fromReal(double x) { return x; }
+
+		inline bool pow(Val_t base, Val_t exponent, Val_t& power)
+		{
+			power = std::pow(base, exponent);
+			return !std::isnan(power);
+		}
+
+	#endif
+
+		const bool INTEGER = std::numeric_limits<Val_t>::is_integer;
+
+	} // namespace _values
+
+	//-----------------------------------------------------------------------------
+
 	namespace _registers
 	{
 		const size_t REGISTER_COUNT = 7;
@@ -70,31 +229,543 @@ namespace MyStd1
 
 	//-----------------------------------------------------------------------------
 
+	// OUT and PRINT write through a buffer, stdout gets it on END, DUMP, IN and runtime errors
+	namespace _output
+	{
+		// valang_execute --output=text|shortest|binary
+		enum class Format
+		{
+			TEXT,     // OUTPUT_FORMAT
+			SHORTEST, // Shortest text that reads back to the same value
+			BINARY    // Packed Val_t, the reports go to stderr
+		};
+
+		const size_t MAX_TEXT_SIZE = 512; // %.3f of the largest double fits
+
+		// Where the values and the reports of END and DUMP go
+		struct Streams
+		{
+		public:
+			// Variables:
+				std::FILE* values  = stdout;
+				std::FILE* reports = nullptr; // stderr for the binary output, values otherwise
+		};
+
+		class Output
+		{
+		public:
+			// Ctor:
+				explicit Output(Format format = Format::TEXT, Streams streams = {}) :
+					format_  (format),
+					reports_ (streams.reports),
+					buffer_  (streams.values)
+				{
+					if (reports_ == nullptr) reports_ = (format == Format::BINARY)? stderr : streams.values;
+				}
+
+			// Functions:
+				void value(Val_t toWrite)
+				{
+					if (format_ == Format::BINARY)
+					{
+						buffer_.write(&toWrite, sizeof(toWrite));
+						return;
+					}
+
+					char* begin = buffer_.reserve(MAX_TEXT_SIZE);
+					char* end   = begin + MAX_TEXT_SIZE - 1;
+
+				#ifdef VALUE_TYPE_I64
+					std::to_chars_result result = std::to_chars(begin, end, toWrite);
+				#else
+					std::to_chars_result result = (format_ == Format::TEXT)?
+						std::to_chars(begin, end, toWrite, std::chars_format::fixed, 3) :
+						std::to_chars(begin, end, toWrite);
+				#endif
+
+					*result.ptr = '\n';
+					buffer_.commit(result.ptr + 1);
+				}
+
+				// Report of END, it stays out of the binary output
+				void end(Val_t returned)
+				{
+					std::fprintf(reports(), END_FORMAT, returned);
+				}
+
+				// Text goes after the values written before
+				std::FILE* reports()
+				{
+					buffer_.flush();
+
+					return reports_;
+				}
+
+				void flush()
+				{
+					buffer_.flush();
+				}
+
+		private:
+			// Variables:
+				Format format_;
+				std::FILE* reports_;
+				FileWork::OutputBuffer buffer_;
+		};
+
+	} // namespace _output
+
+	//-----------------------------------------------------------------------------
+
+	// IN takes values from a file read at start or, without a file, from stdin one by one
+	namespace _input
+	{
+		// valang_execute --input=FILE [--input-format=text|binary]
+		struct Source
+		{
+		public:
+			// Variables:
+				const char* filename = nullptr; // stdin
+				bool binary = false;            // Packed Val_t
+		};
+
+		class Input
+		{
+		public:
+			// Ctor:
+				explicit Input(Source source = {}) :
+					file_     (),
+					parsed_   (),
+					next_     (nullptr),
+					end_      (nullptr),
+					position_ (0)
+				{
+					if (source.filename == nullptr) return;
+
+					file_ = std::make_unique<FileWork::MappedBinaryFile>(source.filename);
+
+					if (source.binary) mapValues(source.filename);
+					else               parseValues(source.filename);
+				}
+
+			// Functions:
+				// stdin is read when the value is needed, so the output must be seen before
+				bool interactive() const
+				{
+					return file_ == nullptr;
+				}
+
+				// 0 when the input is over, as scanf leaves it
+				Val_t next()
+				{
+					++position_;
+
+					if (next_ != end_) return *next_++;
+
+					Val_t toRead = 0;
+					if (interactive()) std::scanf(INPUT_FORMAT, &toRead);
+
+					return toRead;
+				}
+
+				// Values taken so far
+				size_t position() const
+				{
+					return position_;
+				}
+
+				// Resumed runs go on from where the input was left
+				void skip(size_t count)
+				{
+					for (size_t i = 0; i < count; ++i) next();
+				}
+
+		private:
+			// Variables:
+				std::unique_ptr<FileWork::MappedBinaryFile> file_;
+				std::vector<Val_t> parsed_;
+				const Val_t* next_;
+				const Val_t* end_;
+				size_t position_;
+
+			// Functions:
+				// Values are used right from the mapping
+				void mapValues(const char* filename)
+				{
+					if (file_->size() % sizeof(Val_t) != 0) throw Exception("Input is not an array of values", filename, "-", 0);
+
+					next_ = reinterpret_cast<const Val_t*>(file_->data());
+					end_  = next_ + file_->size() / sizeof(Val_t);
+				}
+
+				// Whitespace separated values, all of them are parsed at once
+				void parseValues(const char* filename)
+				{
+					const char* cur = reinterpret_cast<const char*>(file_->data());
+					const char* end = cur + file_->size();
+
+					// Upper bound, a value takes two bytes at least. Pages past the real count are never touched.
+					parsed_.reserve(file_->size() / 2 + 1);
+
+					while (true)
+					{
+						while (cur != end && (*cur == ' ' || *cur == '\n' || *cur == '\t' || *cur == '\r')) ++cur;
+						if (cur == end) break;
+
+						if (*cur == '+') ++cur;
+
+						Val_t value = 0;
+						std::from_chars_result result = std::from_chars(cur, end, value);
+						if (result.ec != std::errc()) throw Exception("Unable to read input value", filename, "-", 0);
+
+						parsed_.push_back(value);
+						cur = result.ptr;
+					}
+
+					file_.reset();
+
+					next_ = parsed_.data();
+					end_  = next_ + parsed_.size();
+				}
+		};
+
+	} // namespace _input
+
+	//-----------------------------------------------------------------------------
+
+	// Arrays of the language. Small ones of a constant size live in the frame: ALLOCM puts their
+	// length to the slot of the variable and the elements right above it. The others are allocated
+	// by NEWARR, the slot of the variable keeps the handle.
+	namespace _arrays
+	{
+		const size_t MAX_ARRAY_SIZE = 1 << 28; // Elements
+
+		// Length operand of ALLOCM and NEWARR
+		bool toLength(Val_t value, size_t& length)
+		{
+			if (!(value >= 0 && value <= static_cast<Val_t>(MAX_ARRAY_SIZE)) || value != std::floor(value)) return false;
+
+			length = static_cast<size_t>(value);
+			return true;
+		}
+
+		// Element of an array of the length the index value points at, it is truncated toward zero
+		bool toIndex(Val_t value, Val_t length, size_t& index)
+		{
+			if (!(value > -1 && value < length && value < static_cast<Val_t>(MAX_ARRAY_SIZE))) return false;
+
+			index = static_cast<size_t>(value);
+			return true;
+		}
+
+		// Operand of the vector commands (REFM): -1 - the slot of the length for a frame array,
+		// the handle for a heap one
+		Val_t frameReference(size_t slot)
+		{
+			return -1 - static_cast<Val_t>(slot);
+		}
+
+		// Entry of the table, the JIT reads it as it is
+		struct View
+		{
+		public:
+			// Variables:
+				Val_t*   data;
+				uint64_t size;
+		};
+
+		// Arrays of NEWARR. An array belongs to the value stack slot its handle was stored to.
+		// Storing a new one to a slot frees the arrays of that slot and of the slots above it:
+		// they belong to scopes that were left and to frames that returned. So the live arrays
+		// are always ordered by their slots. Handles are indices in the table from 1, 0 is no array.
+		class ArrayHeap
+		{
+		public:
+			// Ctor:
+				ArrayHeap() :
+					views_   (),
+					storage_ (),
+					owners_  (),
+					live_    (),
+					free_    ()
+				{}
+
+			// Functions:
+				// 0 when there is no memory for it, the elements are zeros
+				Val_t allocate(size_t size, size_t owner)
+				{
+					while (!live_.empty() && owners_[live_.back()] >= owner)
+					{
+						release(live_.back());
+						live_.pop_back();
+					}
+
+					std::unique_ptr<Val_t[]> values{new (std::nothrow) Val_t[size]()};
+					if (values == nullptr) return 0;
+
+					size_t index = views_.size();
+					if (free_.empty()) addEntry();
+					else
+					{
+						index = free_.back();
+						free_.pop_back();
+					}
+
+					views_  [index] = {values.get(), size};
+					storage_[index] = std::move(values);
+					owners_ [index] = owner;
+					live_.push_back(index);
+
+					return static_cast<Val_t>(index + 1);
+				}
+
+				// nullptr when the handle is no array, a freed one has no elements
+				const View* find(Val_t handle) const
+				{
+					if (!(handle >= 1 && handle < static_cast<Val_t>(views_.size() + 1))) return nullptr;
+
+					return &views_[static_cast<size_t>(handle) - 1];
+				}
+
+				const View* views() const
+				{
+					return views_.data();
+				}
+
+				size_t tableSize() const
+				{
+					return views_.size();
+				}
+
+			// Snapshots:
+				// By the slots
+				const std::vector<size_t>& liveArrays() const
+				{
+					return live_;
+				}
+
+				size_t owner(size_t index) const
+				{
+					return owners_[index];
+				}
+
+				// Live arrays come in the order of liveArrays()
+				bool restore(size_t index, size_t owner, const Val_t* values, size_t size)
+				{
+					std::unique_ptr<Val_t[]> copy{new (std::nothrow) Val_t[size]()};
+					if (copy == nullptr) return false;
+
+					std::copy(values, values + size, copy.get());
+
+					while (views_.size() <= index)
+					{
+						free_.push_back(views_.size());
+						addEntry();
+					}
+
+					free_.erase(std::remove(free_.begin(), free_.end(), index), free_.end());
+
+					views_  [index] = {copy.get(), size};
+					storage_[index] = std::move(copy);
+					owners_ [index] = owner;
+					live_.push_back(index);
+
+					return true;
+				}
+
+		private:
+			// Variables:
+				std::vector<View> views_;
+				std::vector<std::unique_ptr<Val_t[]>> storage_;
+				std::vector<size_t> owners_;
+				std::vector<size_t> live_;
+				std::vector<size_t> free_;
+
+			// Functions:
+				void addEntry()
+				{
+					views_.push_back({nullptr, 0});
+					storage_.emplace_back();
+					owners_.push_back(0);
+				}
+
+				void release(size_t index)
+				{
+					views_[index] = {nullptr, 0};
+					storage_[index].reset();
+					free_.push_back(index);
+				}
+		};
+
+	} // namespace _arrays
+
+	//-----------------------------------------------------------------------------
+
 	namespace _command
 	{
+		// Committed at start, the stacks grow on demand up to the maximal size
 		const size_t VALUE_STACK_SIZE = 1024;
 		const size_t  CALL_STACK_SIZE = 1024;
 
-		struct Command;
+		const size_t DEFAULT_MAX_STACK_SIZE = 65536;
+		const size_t         MAX_STACK_SIZE = 1 << 24; // Limit of --max-stack-size, the maximal size is reserved at start
+
+		// Value stack is touched by every command, the build variant decides how much it checks.
+		// Call stack is touched by CALL and RET only, it checks everything in every build.
+		using ValueStackChecks = DefaultChecks;
+		using  CallStackChecks = CanaryChecks;
+
+		// Sizes of both stacks, valang_execute --stack-size and --max-stack-size
+		struct StackSizes
+		{
+		public:
+			// Variables:
+				size_t size    = VALUE_STACK_SIZE;
+				size_t maxSize = DEFAULT_MAX_STACK_SIZE;
+		};
+
+		struct CPU;
+
+		struct Command
+		{
+		public:
+			// Dtor:
+				virtual ~Command() = default; // pure
+			
+			// Functions:
+				// Commands keep no state, all CPUs running the programme share them
+				virtual void execute(CPU& cpu) const = 0; // pure
+		};
+
+		// Commands are stored inline in equal slots of one buffer:
+		const size_t COMMAND_SLOT_SIZE = sizeof(void*) + sizeof(Val_t); // vptr and the widest operand
+
+		class CommandBuffer
+		{
+		private:
+			// Types:
+				struct alignas(COMMAND_SLOT_SIZE) Slot
+				{
+					unsigned char bytes[COMMAND_SLOT_SIZE];
+				};
+
+			// Variables:
+				Slot*  slots_;
+				size_t size_;
+				size_t capacity_;
+
+		public:
+			// Ctors && dtor:
+				CommandBuffer() :
+					slots_    (nullptr),
+					size_     (0),
+					capacity_ (0)
+				{}
+
+				CommandBuffer(const CommandBuffer& that) = delete;
+				CommandBuffer& operator=(const CommandBuffer& that) = delete;
+
+				CommandBuffer(CommandBuffer&& that) :
+					slots_    (that.slots_),
+					size_     (that.size_),
+					capacity_ (that.capacity_)
+				{
+					that.slots_    = nullptr;
+					that.size_     = 0;
+					that.capacity_ = 0;
+				}
+
+				CommandBuffer& operator=(CommandBuffer&& that)
+				{
+					std::swap(slots_,    that.slots_);
+					std::swap(size_,     that.size_);
+					std::swap(capacity_, that.capacity_);
+
+					return *this;
+				}
+
+				~CommandBuffer()
+				{
+					clear();
+
+					delete[] slots_;
+				}
+
+			// Functions:
+				// Allocates all the slots at once, must be called on an empty buffer
+				void reserve(size_t capacity)
+				{
+					if (size_ != 0) throw Exception("Unable to reserve a non-empty buffer", "", "CommandBuffer", 0);
+
+					delete[] slots_;
+					slots_ = nullptr;
+
+					slots_    = new Slot[capacity];
+					capacity_ = capacity;
+				}
+
+				template <class Cmd, class... Args>
+				Cmd& emplace(Args&&... args)
+				{
+					static_assert(sizeof(Cmd) <= sizeof(Slot) && alignof(Cmd) <= alignof(Slot), "Command doesn't fit into a slot");
+
+					if (size_ == capacity_) throw Exception("Command buffer is full", "", "CommandBuffer", 0);
 
+					Cmd* cmd = new (slots_ + size_) Cmd(std::forward<Args>(args)...);
+					++size_;
+
+					return *cmd;
+				}
+
+				Command& operator[](size_t index)
+				{
+					return *std::launder(reinterpret_cast<Command*>(slots_ + index));
+				}
+
+				const Command& operator[](size_t index) const
+				{
+					return *std::launder(reinterpret_cast<const Command*>(slots_ + index));
+				}
+
+				size_t size() const
+				{
+					return size_;
+				}
+
+				void clear()
+				{
+					for (size_t i = 0; i < size_; ++i) (*this)[i].~Command();
+
+					size_ = 0;
+				}
+		};
+
+		// State of one run, the code is elsewhere and may be run by many CPUs at once
 		struct CPU
 		{
 		public:
 			// Variables:
-				std::vector<Command*> cmdArr;
 				CmdNum_t curCmd;
-				Stack<CmdNum_t,  CALL_STACK_SIZE> callSt;
-				Stack<   Val_t, VALUE_STACK_SIZE>  valSt; 
+				bool halted;
+				GrowableStack<CmdNum_t,  CallStackChecks> callSt;
+				GrowableStack<   Val_t, ValueStackChecks>  valSt;
 				std::array<Val_t, _registers::REGISTER_COUNT> regs;
+				_arrays::ArrayHeap arrays;
+				_output::Output out;
+				_input::Input in;
 
 			// Ctor:
 
-				CPU() :
-					cmdArr(),
+				explicit CPU(StackSizes sizes = {}, _output::Format format = _output::Format::TEXT, _input::Source input = {},
+				             _output::Streams streams = {}) :
 					curCmd(0),
-					callSt(),
-					valSt (),
-					regs  ()
+					halted(false),
+					callSt(sizes.size, sizes.maxSize, "CALL: Stack overflow"),
+					valSt (sizes.size, sizes.maxSize, "Value stack is full!"),
+					regs  (),
+					arrays(),
+					out   (format, streams),
+					in    (input)
 				{
 					regs.fill(0);
 				}
@@ -105,16 +776,6 @@ namespace MyStd1
 				}
 		};
 	
-		struct Command
-		{
-		public:
-			// Dtor:
-				virtual ~Command() = default; // pure
-			
-			// Functions:
-				virtual void execute(CPU& cpu) = 0; // pure
-		};
-
 		// Defines:
 		#define THROW_IF_VAL_ST_FULL(cmd_name) \
 			if (cpu.valSt.full()) throw Exception("Value stack is full!", "", cmd_name, 0)
@@ -130,7 +791,7 @@ namespace MyStd1
 			{                                                                      \
 				class_name() = default;                                            \
 				virtual ~class_name() = default;                                   \
-				void execute(CPU& cpu)                                             \
+				void execute(CPU& cpu) const                                       \
 				{                                                                  \
 					if (cpu.valSt.empty())                                         \
 						throw Exception("Value stack is empty!", "", cmd_name, 0); \
@@ -145,13 +806,29 @@ namespace MyStd1
 				}                                                                  \
 			};
 
+		#define DEF_UNARY_FUNCTION(class_name, cmd_name, piece_of_code)            \
+			struct class_name : Command                                            \
+			{                                                                      \
+				class_name() = default;                                            \
+				virtual ~class_name() = default;                                   \
+				void execute(CPU& cpu) const                                       \
+				{                                                                  \
+					if (cpu.valSt.empty())                                         \
+						throw Exception("Value stack is empty!", "", cmd_name, 0); \
+					Val_t x = cpu.valSt.pop();                                     \
+                                                                                   \
+					cpu.valSt.push(piece_of_code);                                 \
+					cpu.updateSp();                                                \
+				}                                                                  \
+			};
+
 		#define DEF_COND_JUMP(class_name, cmd_name, jump_condition)                \
 			struct class_name : public CmdJmp                                      \
 			{                                                                      \
 				explicit class_name(CmdNum_t toJump) :                             \
 					CmdJmp(toJump) {};                                             \
 				virtual ~class_name() = default;                                   \
-				void execute(CPU& cpu)                                             \
+				void execute(CPU& cpu) const                                       \
 				{                                                                  \
 					if (cpu.valSt.empty())                                         \
 						throw Exception("Value stack is empty!", "", cmd_name, 0); \
@@ -175,7 +852,7 @@ namespace MyStd1
 					// Functions:
 						CmdBeg() = default;
 						virtual ~CmdBeg() = default;
-						virtual void execute(CPU& cpu) override {}
+						virtual void execute(CPU&) const override {}
 				};
 
 				struct CmdEnd : public Command
@@ -183,12 +860,11 @@ namespace MyStd1
 					// Functions:
 						CmdEnd() = default;
 						virtual ~CmdEnd() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
-							cpu.curCmd = cpu.cmdArr.size();
+							cpu.halted = true;
 
-							std::printf("\nExecution finished succesefully\nProcess returned: %f\n",
-								cpu.regs.at(_registers::RT_REGISTER_I));
+							cpu.out.end(cpu.regs.at(_registers::RT_REGISTER_I));
 						}
 				};
 
@@ -202,7 +878,7 @@ namespace MyStd1
 					// Functions:
 						explicit CmdPush(Val_t toPush) : toPush_ (toPush) {}
 						virtual ~CmdPush() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_FULL("PUSH");
 
@@ -220,7 +896,7 @@ namespace MyStd1
 					// Functions:
 						explicit CmdPushR(RegAdr_t regAdr) : regAdr_ (regAdr) {};
 						virtual ~CmdPushR() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_FULL("PUSHR");
 
@@ -237,7 +913,7 @@ namespace MyStd1
 					// Functions:
 						CmdPop() = default;
 						virtual ~CmdPop() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("POP");
 
@@ -255,7 +931,7 @@ namespace MyStd1
 					// Functions:
 						explicit CmdPopR(RegAdr_t regAdr) : regAdr_ (regAdr) {};
 						virtual ~CmdPopR() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("POPR");
 
@@ -269,29 +945,29 @@ namespace MyStd1
 
 			// Arithmetics:
 
-				DEF_BINARY_OPERATOR(CmdAdd, "ADD", l + r);
-				DEF_BINARY_OPERATOR(CmdSub, "SUB", l - r);
-				DEF_BINARY_OPERATOR(CmdMul, "MUL", l * r);
+				DEF_BINARY_OPERATOR(CmdAdd, "ADD", _values::add(l, r));
+				DEF_BINARY_OPERATOR(CmdSub, "SUB", _values::sub(l, r));
+				DEF_BINARY_OPERATOR(CmdMul, "MUL", _values::mul(l, r));
 
 				struct CmdDiv : public Command
 				{
 					// Functions:
 						CmdDiv() = default;
 						virtual ~CmdDiv() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("DIV");
 
 							Val_t divisor = cpu.valSt.pop();
 
-							if (std::abs(divisor) <= std::numeric_limits<Val_t>::epsilon() * 5)
+							if (_values::isZero(divisor))
 							{
 								throw Exception("Unable to divide by 0!", "", "DIV", 0);
 							}
 
 							THROW_IF_VAL_ST_EMPTY("DIV");
 
-							cpu.valSt.push(cpu.valSt.pop() / divisor);
+							cpu.valSt.push(_values::div(cpu.valSt.pop(), divisor));
 
 							cpu.updateSp();
 						}
@@ -302,7 +978,7 @@ namespace MyStd1
 					// Functions:
 						CmdSqrt() = default;
 						virtual ~CmdSqrt() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("SQRT");
 
@@ -313,7 +989,63 @@ namespace MyStd1
 								throw Exception("Root of negative number doesn't exist", "", "SQRT", 0);
 							}
 
-							cpu.valSt.push(std::sqrt(popped));
+							cpu.valSt.push(_values::fromReal(std::sqrt(popped)));
+
+							cpu.updateSp();
+						}
+				};
+
+			// Built-in functions of the language (libm):
+
+				DEF_UNARY_FUNCTION(CmdSin,   "SIN",   _values::fromReal(std::sin(x)))
+				DEF_UNARY_FUNCTION(CmdCos,   "COS",   _values::fromReal(std::cos(x)))
+				DEF_UNARY_FUNCTION(CmdExp,   "EXP",   _values::fromReal(std::exp(x)))
+				DEF_UNARY_FUNCTION(CmdAbs,   "ABS",   _values::abs(x))
+				DEF_UNARY_FUNCTION(CmdFloor, "FLOOR", _values::fromReal(std::floor(x)))
+
+				DEF_BINARY_OPERATOR(CmdMin, "MIN", _values::min(l, r))
+				DEF_BINARY_OPERATOR(CmdMax, "MAX", _values::max(l, r))
+
+				struct CmdLog : public Command
+				{
+					// Functions:
+						CmdLog() = default;
+						virtual ~CmdLog() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("LOG");
+
+							Val_t popped = cpu.valSt.pop();
+
+							if (!(popped > 0))
+							{
+								throw Exception("Logarithm of non-positive number doesn't exist", "", "LOG", 0);
+							}
+
+							cpu.valSt.push(_values::fromReal(std::log(popped)));
+
+							cpu.updateSp();
+						}
+				};
+
+				// NaN (a negative base with a fractional exponent) is an error
+				struct CmdPow : public Command
+				{
+					// Functions:
+						CmdPow() = default;
+						virtual ~CmdPow() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("POW");
+							Val_t exponent = cpu.valSt.pop();
+
+							THROW_IF_VAL_ST_EMPTY("POW");
+							Val_t power = 0;
+
+							if (!_values::pow(cpu.valSt.pop(), exponent, power))
+								throw Exception("Power is not a real number", "", "POW", 0);
+
+							cpu.valSt.push(power);
 
 							cpu.updateSp();
 						}
@@ -326,11 +1058,11 @@ namespace MyStd1
 					// Functions:
 						CmdOut() = default;
 						virtual ~CmdOut() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("OUT");
 
-							std::printf(OUTPUT_FORMAT, cpu.valSt.pop());
+							cpu.out.value(cpu.valSt.pop());
 
 							cpu.updateSp();
 						}
@@ -341,11 +1073,12 @@ namespace MyStd1
 					// Functions:
 						CmdIn() = default;
 						virtual ~CmdIn() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
-							Val_t toRead = 0;
+							// A prompt printed before must be seen
+							if (cpu.in.interactive()) cpu.out.flush();
 
-							std::scanf(INPUT_FORMAT, &toRead);
+							Val_t toRead = cpu.in.next();
 
 							THROW_IF_VAL_ST_FULL("IN");
 
@@ -364,14 +1097,14 @@ namespace MyStd1
 					// Functions:
 						explicit CmdJmp(CmdNum_t toJump) : toJump_ (toJump) {};
 						virtual ~CmdJmp() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							cpu.curCmd = toJump_ - 1; // That -1 is because ++cpu.curCmd is called when the cycle step ends
 						}
 				};
 
-				DEF_COND_JUMP(CmdJe,  "JE",  std::abs(l-r) <= 5 * std::abs(l+r) * std::numeric_limits<Val_t>::epsilon())
-				DEF_COND_JUMP(CmdJne, "JNE", std::abs(l-r) >  5 * std::abs(l+r) * std::numeric_limits<Val_t>::epsilon())
+				DEF_COND_JUMP(CmdJe,  "JE",   _values::equal(l, r))
+				DEF_COND_JUMP(CmdJne, "JNE", !_values::equal(l, r))
 
 				DEF_COND_JUMP(CmdJa,  "JA",  l >  r)
 				DEF_COND_JUMP(CmdJae, "JAE", l >= r)
@@ -382,7 +1115,7 @@ namespace MyStd1
 					explicit CmdJbe(CmdNum_t toJump) :                             
 						CmdJmp(toJump) {};                                             
 					virtual ~CmdJbe() = default;                                   
-					void execute(CPU& cpu)                                             
+					void execute(CPU& cpu) const
 					{   
 						THROW_IF_VAL_ST_EMPTY("JBE");
 						Val_t r = cpu.valSt.pop();                                     
@@ -403,7 +1136,7 @@ namespace MyStd1
 					// Functions:
 						explicit CmdCall(CmdNum_t toJump) : CmdJmp(toJump) {};
 						virtual ~CmdCall() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							if (cpu.callSt.full())
 							{
@@ -422,7 +1155,7 @@ namespace MyStd1
 					// Functions:
 						CmdRet() = default;
 						virtual ~CmdRet() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							if (cpu.callSt.empty())
 							{
@@ -442,24 +1175,26 @@ namespace MyStd1
 					// Functions:
 						CmdDump() = default;
 						virtual ~CmdDump() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
-							std::printf("--------------STACK----------------\n");
+							std::FILE* stream = cpu.out.reports();
+
+							std::fprintf(stream, "--------------STACK----------------\n");
 							for (size_t i = cpu.valSt.filledSize() - 1; i < cpu.valSt.filledSize(); --i)
 							{
-								std::printf(OUTPUT_FORMAT, cpu.valSt.at(i));
+								std::fprintf(stream, OUTPUT_FORMAT, cpu.valSt.at(i));
 							}
-							std::printf("------------CALL-STACK-------------\n");
+							std::fprintf(stream, "------------CALL-STACK-------------\n");
 							for (size_t i = cpu.callSt.filledSize() - 1; i < cpu.callSt.filledSize(); --i)
 							{
-								std::printf(OUTPUT_FORMAT, cpu.callSt.at(i));
+								std::fprintf(stream, OUTPUT_FORMAT, static_cast<Val_t>(cpu.callSt.at(i)));
 							}
-							std::printf("------------REGISTERS-------------\n");
+							std::fprintf(stream, "------------REGISTERS-------------\n");
 							for (size_t i = 0; i < cpu.regs.size(); ++i)
 							{
-								std::printf("%s: %lf\n", _registers::REGISTERS[i], cpu.regs.at(i));
+								std::fprintf(stream, REGISTER_FORMAT, _registers::REGISTERS[i], cpu.regs.at(i));
 							}
-							std::printf("----------------------------------\n");
+							std::fprintf(stream, "----------------------------------\n");
 						}
 				};
 
@@ -468,11 +1203,11 @@ namespace MyStd1
 					// Funcyions:
 						CmdPrint() = default;
 						virtual ~CmdPrint() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("PRINT");
 
-							std::printf(OUTPUT_FORMAT, cpu.valSt.pop());
+							cpu.out.value(cpu.valSt.pop());
 
 							cpu.updateSp();
 						}
@@ -501,11 +1236,11 @@ namespace MyStd1
 						{}
 
 						virtual ~CmdPushMem() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_FULL("PUSHM");
 
-							MemAdr_t bp = cpu.regs.at(_registers::BP_REGISTER_I);
+							size_t bp = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I));
 
 							if (bp + memAdr_ >= cpu.valSt.filledSize())
 							{
@@ -527,11 +1262,11 @@ namespace MyStd1
 							memAdr_(memAdr)
 						{}
 						virtual ~CmdPopMem() = default;
-						virtual void execute(CPU& cpu) override
+						virtual void execute(CPU& cpu) const override
 						{
 							THROW_IF_VAL_ST_EMPTY("POPM");
 
-							MemAdr_t bp = cpu.regs.at(_registers::BP_REGISTER_I);
+							size_t bp = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I));
 
 							if (bp + memAdr_ >= cpu.valSt.filledSize())
 								throw Exception("Access out of stack", "", "POPM", 0);
@@ -545,6 +1280,437 @@ namespace MyStd1
 						}
 				};
 
+				// The top memAdr_ values become the frame from BP on, the rest of the frame is dropped.
+				// The translator follows it with a jump to the function called in the tail position.
+				struct CmdTailCall : public Command
+				{
+					// Variables:
+						MemAdr_t argCount_;
+					// Functions:
+						CmdTailCall(MemAdr_t argCount) :
+							argCount_(argCount)
+						{}
+						virtual ~CmdTailCall() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							size_t bp = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I));
+							size_t filled = cpu.valSt.filledSize();
+
+							if (bp + argCount_ > filled)
+								throw Exception("Access out of stack", "", "TAILCALL", 0);
+
+							for (size_t i = 0; i < argCount_; ++i)
+							{
+								cpu.valSt.at(bp + i) = cpu.valSt.at(filled - argCount_ + i);
+							}
+
+							cpu.valSt.setFilledSize(bp + argCount_);
+
+							cpu.updateSp();
+						}
+				};
+
+			// Arrays (see _arrays):
+
+				// Length on top. The slot memAdr_ gets the length, the elements above it get zeros.
+				// The stack ends at the last element at least.
+				struct CmdAllocMem : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdAllocMem(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdAllocMem() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("ALLOCM");
+
+							size_t length = 0;
+							if (!_arrays::toLength(cpu.valSt.pop(), length))
+								throw Exception("Bad array size", "", "ALLOCM", 0);
+
+							size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr_;
+
+							if (address > cpu.valSt.filledSize())
+								throw Exception("Access out of stack", "", "ALLOCM", 0);
+
+							if (address + 1 + length > cpu.valSt.maxSize())
+								throw Exception("Value stack is full!", "", "ALLOCM", 0);
+
+							cpu.valSt.setFilledSize(std::max(cpu.valSt.filledSize(), address + 1 + length));
+
+							cpu.valSt.at(address) = static_cast<Val_t>(length);
+							std::fill(cpu.valSt.data() + address + 1, cpu.valSt.data() + address + 1 + length, 0);
+
+							cpu.updateSp();
+						}
+				};
+
+				// Index on top, it becomes the element of the array at the slot memAdr_
+				struct CmdPushMemIndexed : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdPushMemIndexed(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdPushMemIndexed() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("PUSHMI");
+
+							size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr_;
+							size_t top = cpu.valSt.filledSize() - 1;
+
+							if (address >= top)
+								throw Exception("Access out of stack", "", "PUSHMI", 0);
+
+							size_t index = 0;
+							if (!_arrays::toIndex(cpu.valSt.at(top), cpu.valSt.at(address), index))
+								throw Exception("Index out of array", "", "PUSHMI", 0);
+
+							if (address + 1 + index >= top)
+								throw Exception("Access out of stack", "", "PUSHMI", 0);
+
+							cpu.valSt.at(top) = cpu.valSt.at(address + 1 + index);
+						}
+				};
+
+				// Index and value on top, the value goes to the element of the array at the slot memAdr_
+				struct CmdPopMemIndexed : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdPopMemIndexed(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdPopMemIndexed() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							if (cpu.valSt.filledSize() < 2)
+								throw Exception("Value stack is empty!", "", "POPMI", 0);
+
+							Val_t value = cpu.valSt.pop();
+							Val_t index = cpu.valSt.pop();
+
+							size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr_;
+
+							if (address >= cpu.valSt.filledSize())
+								throw Exception("Access out of stack", "", "POPMI", 0);
+
+							size_t element = 0;
+							if (!_arrays::toIndex(index, cpu.valSt.at(address), element))
+								throw Exception("Index out of array", "", "POPMI", 0);
+
+							if (address + 1 + element >= cpu.valSt.filledSize())
+								throw Exception("Access out of stack", "", "POPMI", 0);
+
+							cpu.valSt.at(address + 1 + element) = value;
+
+							cpu.updateSp();
+						}
+				};
+
+				// Length on top. The slot memAdr_ gets the handle of a new array of zeros,
+				// it is pushed when the slot is the top.
+				struct CmdNewArray : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdNewArray(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdNewArray() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("NEWARR");
+
+							size_t length = 0;
+							if (!_arrays::toLength(cpu.valSt.pop(), length))
+								throw Exception("Bad array size", "", "NEWARR", 0);
+
+							size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr_;
+
+							if (address > cpu.valSt.filledSize())
+								throw Exception("Access out of stack", "", "NEWARR", 0);
+
+							if (address == cpu.valSt.filledSize()) THROW_IF_VAL_ST_FULL("NEWARR");
+
+							Val_t handle = cpu.arrays.allocate(length, address);
+							if (handle == 0)
+								throw Exception("Not enough memory for the array", "", "NEWARR", 0);
+
+							if (address == cpu.valSt.filledSize()) cpu.valSt.push(handle);
+							else                                    cpu.valSt.at(address) = handle;
+
+							cpu.updateSp();
+						}
+				};
+
+				// Element of the array, its handle is in the slot memAdr_
+				const _arrays::View& findArray(CPU& cpu, MemAdr_t memAdr, const char* cmdName)
+				{
+					size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr;
+
+					if (address >= cpu.valSt.filledSize())
+						throw Exception("Access out of stack", "", cmdName, 0);
+
+					const _arrays::View* view = cpu.arrays.find(cpu.valSt.at(address));
+					if (view == nullptr)
+						throw Exception("Not an array", "", cmdName, 0);
+
+					return *view;
+				}
+
+				// Index on top, it becomes the element
+				struct CmdLoadArray : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdLoadArray(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdLoadArray() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_EMPTY("LOADA");
+
+							const _arrays::View& array = findArray(cpu, memAdr_, "LOADA");
+
+							Val_t& top = cpu.valSt.at(cpu.valSt.filledSize() - 1);
+
+							size_t index = 0;
+							if (!_arrays::toIndex(top, static_cast<Val_t>(array.size), index))
+								throw Exception("Index out of array", "", "LOADA", 0);
+
+							top = array.data[index];
+						}
+				};
+
+				// Index and value on top, the value goes to the element
+				struct CmdStoreArray : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdStoreArray(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdStoreArray() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							if (cpu.valSt.filledSize() < 2)
+								throw Exception("Value stack is empty!", "", "STOREA", 0);
+
+							Val_t value = cpu.valSt.pop();
+							Val_t index = cpu.valSt.pop();
+
+							const _arrays::View& array = findArray(cpu, memAdr_, "STOREA");
+
+							size_t element = 0;
+							if (!_arrays::toIndex(index, static_cast<Val_t>(array.size), element))
+								throw Exception("Index out of array", "", "STOREA", 0);
+
+							array.data[element] = value;
+
+							cpu.updateSp();
+						}
+				};
+
+			// Vector commands (see VectorKernels.hpp), arrays of REFM or handles on the stack:
+
+				// Pushes the reference to the frame array at the slot memAdr_
+				struct CmdRefMem : public Command
+				{
+					// Variables:
+						MemAdr_t memAdr_;
+					// Functions:
+						CmdRefMem(MemAdr_t memAdr) :
+							memAdr_(memAdr)
+						{}
+						virtual ~CmdRefMem() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							THROW_IF_VAL_ST_FULL("REFM");
+
+							size_t address = static_cast<MemAdr_t>(cpu.regs.at(_registers::BP_REGISTER_I)) + memAdr_;
+
+							if (address >= cpu.valSt.filledSize())
+								throw Exception("Access out of stack", "", "REFM", 0);
+
+							cpu.valSt.push(_arrays::frameReference(address));
+
+							cpu.updateSp();
+						}
+				};
+
+				// Pops count references, arrays[0] is the deepest one. Frame arrays must be under them.
+				void popArrays(CPU& cpu, size_t count, _arrays::View* arrays, const char* cmdName)
+				{
+					if (cpu.valSt.filledSize() < count)
+						throw Exception("Value stack is empty!", "", cmdName, 0);
+
+					for (size_t i = count - 1; i < count; --i)
+					{
+						Val_t reference = cpu.valSt.pop();
+
+						if (reference >= 0)
+						{
+							const _arrays::View* view = cpu.arrays.find(reference);
+							if (view == nullptr) throw Exception("Not an array", "", cmdName, 0);
+
+							arrays[i] = *view;
+							continue;
+						}
+
+						Val_t slot = -1 - reference;
+						size_t length = 0;
+
+						if (!(slot < static_cast<Val_t>(cpu.valSt.filledSize())) || slot != std::floor(slot) ||
+						    !_arrays::toLength(cpu.valSt.at(static_cast<size_t>(slot)), length) ||
+						    static_cast<size_t>(slot) + 1 + length > cpu.valSt.filledSize())
+						{
+							throw Exception("Not an array", "", cmdName, 0);
+						}
+
+						arrays[i] = {cpu.valSt.data() + static_cast<size_t>(slot) + 1, length};
+					}
+
+					cpu.updateSp();
+				}
+
+				void checkSameLength(const _arrays::View* arrays, size_t count, const char* cmdName)
+				{
+					for (size_t i = 1; i < count; ++i)
+					{
+						if (arrays[i].size != arrays[0].size) throw Exception("Arrays differ in length", "", cmdName, 0);
+					}
+				}
+
+				// Destination, left and right
+				#define DEF_VECTOR_OPERATOR(class_name, cmd_name, kernel)                  \
+					struct class_name : Command                                            \
+					{                                                                      \
+						class_name() = default;                                            \
+						virtual ~class_name() = default;                                   \
+						void execute(CPU& cpu) const                                       \
+						{                                                                  \
+							_arrays::View arrays[3];                                       \
+							popArrays(cpu, 3, arrays, cmd_name);                           \
+							checkSameLength(arrays, 3, cmd_name);                          \
+							                                                               \
+							const _arrays::View* a = arrays;                               \
+							MyVectorKernels::kernels<Val_t>().kernel(a[0].data, a[1].data, a[2].data, a[0].size); \
+						}                                                                  \
+					};
+
+				DEF_VECTOR_OPERATOR(CmdVAdd, "VADD", add)
+				DEF_VECTOR_OPERATOR(CmdVSub, "VSUB", sub)
+				DEF_VECTOR_OPERATOR(CmdVMul, "VMUL", mul)
+
+				#undef DEF_VECTOR_OPERATOR
+
+				// Same check as DIV, the quotients are written anyway
+				struct CmdVDiv : public Command
+				{
+					// Functions:
+						CmdVDiv() = default;
+						virtual ~CmdVDiv() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							_arrays::View arrays[3];
+							popArrays(cpu, 3, arrays, "VDIV");
+							checkSameLength(arrays, 3, "VDIV");
+
+							if (!MyVectorKernels::kernels<Val_t>().div(arrays[0].data, arrays[1].data, arrays[2].data, arrays[0].size,
+							                                           std::numeric_limits<Val_t>::epsilon() * 5))
+							{
+								throw Exception("Unable to divide by 0!", "", "VDIV", 0);
+							}
+						}
+				};
+
+				// Destination, then a * b + c rounded once
+				struct CmdVFma : public Command
+				{
+					// Functions:
+						CmdVFma() = default;
+						virtual ~CmdVFma() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							_arrays::View arrays[4];
+							popArrays(cpu, 4, arrays, "VFMA");
+							checkSameLength(arrays, 4, "VFMA");
+
+							MyVectorKernels::kernels<Val_t>().fma(arrays[0].data, arrays[1].data, arrays[2].data, arrays[3].data, arrays[0].size);
+						}
+				};
+
+				struct CmdVDot : public Command
+				{
+					// Functions:
+						CmdVDot() = default;
+						virtual ~CmdVDot() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							_arrays::View arrays[2];
+							popArrays(cpu, 2, arrays, "VDOT");
+							checkSameLength(arrays, 2, "VDOT");
+
+							cpu.valSt.push(MyVectorKernels::kernels<Val_t>().dot(arrays[0].data, arrays[1].data, arrays[0].size));
+
+							cpu.updateSp();
+						}
+				};
+
+				struct CmdVSum : public Command
+				{
+					// Functions:
+						CmdVSum() = default;
+						virtual ~CmdVSum() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							_arrays::View array{};
+							popArrays(cpu, 1, &array, "VSUM");
+
+							cpu.valSt.push(MyVectorKernels::kernels<Val_t>().sum(array.data, array.size));
+
+							cpu.updateSp();
+						}
+				};
+
+				// Minimum (min_ is true) or maximum of a non-empty array
+				template <bool min_>
+				struct CmdVExtremum : public Command
+				{
+					// Functions:
+						CmdVExtremum() = default;
+						virtual ~CmdVExtremum() = default;
+						virtual void execute(CPU& cpu) const override
+						{
+							const char* cmdName = min_? "VMIN" : "VMAX";
+
+							_arrays::View array{};
+							popArrays(cpu, 1, &array, cmdName);
+
+							if (array.size == 0) throw Exception("Array is empty", "", cmdName, 0);
+
+							const MyVectorKernels::KernelsOf<Val_t>& kernels = MyVectorKernels::kernels<Val_t>();
+							cpu.valSt.push(min_? kernels.min(array.data, array.size) : kernels.max(array.data, array.size));
+
+							cpu.updateSp();
+						}
+				};
+
+				using CmdVMin = CmdVExtremum<true>;
+				using CmdVMax = CmdVExtremum<false>;
+
 		//-----------------------------------------------------------------------------
 
 		// Now info for assembler and disassembler:
@@ -603,11 +1769,102 @@ namespace MyStd1
 			{Word(   "AND"), {}}, //30
 			{Word(    "OR"), {}}, //31
 			{Word("PUSHM"), {ArgType::MEMORY_ADDRESS}}, // 32
-			{Word( "POPM"), {ArgType::MEMORY_ADDRESS}}  // 33
+			{Word( "POPM"), {ArgType::MEMORY_ADDRESS}}, // 33
+			{Word("TAILCALL"), {ArgType::MEMORY_ADDRESS}}, // 34
+			{Word(  "ALLOCM"), {ArgType::MEMORY_ADDRESS}}, // 35
+			{Word(  "PUSHMI"), {ArgType::MEMORY_ADDRESS}}, // 36
+			{Word(   "POPMI"), {ArgType::MEMORY_ADDRESS}}, // 37
+			{Word(  "NEWARR"), {ArgType::MEMORY_ADDRESS}}, // 38
+			{Word(   "LOADA"), {ArgType::MEMORY_ADDRESS}}, // 39
+			{Word(  "STOREA"), {ArgType::MEMORY_ADDRESS}}, // 40
+			{Word(    "REFM"), {ArgType::MEMORY_ADDRESS}}, // 41
+			{Word(    "VADD"), {}}, // 42
+			{Word(    "VSUB"), {}}, // 43
+			{Word(    "VMUL"), {}}, // 44
+			{Word(    "VDIV"), {}}, // 45
+			{Word(    "VFMA"), {}}, // 46
+			{Word(    "VDOT"), {}}, // 47
+			{Word(    "VSUM"), {}}, // 48
+			{Word(    "VMIN"), {}}, // 49
+			{Word(    "VMAX"), {}}, // 50
+			{Word(     "SIN"), {}}, // 51
+			{Word(     "COS"), {}}, // 52
+			{Word(     "EXP"), {}}, // 53
+			{Word(     "LOG"), {}}, // 54
+			{Word(     "POW"), {}}, // 55
+			{Word(     "ABS"), {}}, // 56
+			{Word(   "FLOOR"), {}}, // 57
+			{Word(     "MIN"), {}}, // 58
+			{Word(     "MAX"), {}}  // 59
 		};
 
 		const Cmd_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(*COMMANDS);
 
+		// Command codes (indices in COMMANDS):
+		enum CmdCode : Cmd_t
+		{
+			CMD_BEG   =  0,
+			CMD_END   =  1,
+			CMD_PUSH  =  2,
+			CMD_PUSHR =  3,
+			CMD_POP   =  4,
+			CMD_POPR  =  5,
+			CMD_ADD   =  6,
+			CMD_SUB   =  7,
+			CMD_MUL   =  8,
+			CMD_DIV   =  9,
+			CMD_SQRT  = 10,
+			CMD_OUT   = 11,
+			CMD_IN    = 12,
+			CMD_JMP   = 13,
+			CMD_JE    = 14,
+			CMD_JNE   = 15,
+			CMD_JA    = 16,
+			CMD_JAE   = 17,
+			CMD_JB    = 18,
+			CMD_JBE   = 19,
+			CMD_CALL  = 20,
+			CMD_RET   = 21,
+			CMD_DUMP  = 22,
+			CMD_PRINT = 23,
+			CMD_IS_L  = 24,
+			CMD_IS_LE = 25,
+			CMD_IS_M  = 26,
+			CMD_IS_ME = 27,
+			CMD_IS_E  = 28,
+			CMD_IS_NE = 29,
+			CMD_AND   = 30,
+			CMD_OR    = 31,
+			CMD_PUSHM = 32,
+			CMD_POPM  = 33,
+			CMD_TAILCALL = 34,
+			CMD_ALLOCM = 35,
+			CMD_PUSHMI = 36,
+			CMD_POPMI  = 37,
+			CMD_NEWARR = 38,
+			CMD_LOADA  = 39,
+			CMD_STOREA = 40,
+			CMD_REFM   = 41,
+			CMD_VADD   = 42,
+			CMD_VSUB   = 43,
+			CMD_VMUL   = 44,
+			CMD_VDIV   = 45,
+			CMD_VFMA   = 46,
+			CMD_VDOT   = 47,
+			CMD_VSUM   = 48,
+			CMD_VMIN   = 49,
+			CMD_VMAX   = 50,
+			CMD_SIN    = 51,
+			CMD_COS    = 52,
+			CMD_EXP    = 53,
+			CMD_LOG    = 54,
+			CMD_POW    = 55,
+			CMD_ABS    = 56,
+			CMD_FLOOR  = 57,
+			CMD_MIN    = 58,
+			CMD_MAX    = 59
+		};
+
 	} // namespace _command
 
 } // namespace MyCompilerStandard0
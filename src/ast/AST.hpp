@@ -16,6 +16,7 @@ namespace VlMathPG_AST
 	using namespace TokenizeFParser;
 
 	class AsmTranslator;
+	class RegTranslator;
 
 	struct Node
 	{
@@ -39,6 +40,9 @@ namespace VlMathPG_AST
 
 		virtual void translate(std::strstream&, AsmTranslator&) const = 0;
 
+		// Returns the register holding the value of an expression, statements return 0
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const = 0;
+
 	private:
 		CodePos pos_;
 	};
@@ -134,6 +138,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct DataNode : public Node
@@ -150,6 +155,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct VariableNode : public Node
@@ -171,6 +177,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct CallNode : public Node
@@ -189,6 +196,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct AssignNode : public Node
@@ -207,6 +215,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct DefVarNode : public Node
@@ -225,6 +234,69 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
+	};
+
+	// var name[size];
+	struct DefArrayNode : public Node
+	{
+	public:
+		std::string name;
+		std::shared_ptr<Node> size;
+
+		DefArrayNode(std::string arrName, std::shared_ptr<Node> arrSize, CodePos pos) :
+			Node(pos),
+			name (arrName),
+			size (arrSize)
+		{}
+
+		virtual ~DefArrayNode() = default;
+
+		virtual void print(std::strstream& stream) const;
+		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
+	};
+
+	// name[index] in an expression
+	struct IndexNode : public Node
+	{
+	public:
+		std::string name;
+		std::shared_ptr<Node> index;
+
+		IndexNode(std::string arrName, std::shared_ptr<Node> elemIndex, CodePos pos) :
+			Node(pos),
+			name (arrName),
+			index (elemIndex)
+		{}
+
+		virtual ~IndexNode() = default;
+
+		virtual void print(std::strstream& stream) const;
+		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
+	};
+
+	// name[index] = val;
+	struct AssignIndexNode : public Node
+	{
+	public:
+		std::string name;
+		std::shared_ptr<Node> index;
+		std::shared_ptr<Node> val;
+
+		AssignIndexNode(std::string arrName, std::shared_ptr<Node> elemIndex, std::shared_ptr<Node> elemVal, CodePos pos) :
+			Node(pos),
+			name (arrName),
+			index (elemIndex),
+			val (elemVal)
+		{}
+
+		virtual ~AssignIndexNode() = default;
+
+		virtual void print(std::strstream& stream) const;
+		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct IfNode : public Node
@@ -245,6 +317,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct WhileNode : public Node
@@ -263,6 +336,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct PrintNode : public Node
@@ -279,6 +353,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct ReturnNode : public Node
@@ -295,6 +370,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct DefFuncNode : public Node
@@ -315,6 +391,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct StSeqNode : public Node
@@ -331,6 +408,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 
 	struct ProgramNode : public Node
@@ -347,6 +425,7 @@ namespace VlMathPG_AST
 
 		virtual void print(std::strstream& stream) const;
 		virtual void translate(std::strstream&, AsmTranslator&) const;
+		virtual unsigned short translateReg(std::strstream&, RegTranslator&) const;
 	};
 }
 
@@ -64,6 +64,29 @@ namespace VlMathPG_AST
 		stream << ";\n";
 	}
 
+	void DefArrayNode::print(std::strstream& stream) const
+	{
+		stream << "var " << name << "[";
+		size->print(stream);
+		stream << "];\n";
+	}
+
+	void IndexNode::print(std::strstream& stream) const
+	{
+		stream << name << "[";
+		index->print(stream);
+		stream << "]";
+	}
+
+	void AssignIndexNode::print(std::strstream& stream) const
+	{
+		stream << name << "[";
+		index->print(stream);
+		stream << "] = ";
+		val->print(stream);
+		stream << ";\n";
+	}
+
 	void IfNode::print(std::strstream& stream) const
 	{
 		stream << "if (";
@@ -104,7 +104,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 		std::shared_ptr<Node> parseUnaryPrefix(TokenizerFileParser& parser, size_t layer)
 		{
-			const Token& tk = parser.peek();
+			const Token tk = parser.peek(); // A copy, move() changes the peeked one
 			for (auto op : std::get<0>(precedence_.at(layer)))
 			{
 				if (op != tk) continue;
@@ -131,7 +131,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 			if (parser.finished()) return operand;
 
-			const Token& tk = parser.peek();
+			const Token tk = parser.peek();
 			for (auto op : std::get<0>(precedence_.at(layer)))
 			{
 				if (op != tk) continue;
@@ -154,7 +154,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 			if (parser.finished()) return l;
 
-			const Token& tk = parser.peek();
+			const Token tk = parser.peek();
 			for (auto op : std::get<0>(precedence_.at(layer)))
 			{
 				if (op != tk) continue;
@@ -193,7 +193,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 			// Creating tree for second argument
 
-			const Token& tk = parser.peek();
+			const Token tk = parser.peek();
 			bool found = false;
 			for (auto op : std::get<0>(precedence_.at(layer)))	
 			{
@@ -224,7 +224,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 			while (!parser.finished())
 			{
-				const Token& tk = parser.peek();
+				const Token tk = parser.peek();
 				found = false;
 				for (auto op : std::get<0>(precedence_.at(layer)))
 				{
@@ -266,7 +266,7 @@ namespace VlMathPG_OperatorConstructsParser
 
 			while (!parser.finished())
 			{
-				const Token& tk = parser.peek();
+				const Token tk = parser.peek();
 				bool found = false;
 				for (auto op : std::get<0>(precedence_.at(layer)))	
 				{
@@ -69,6 +69,15 @@ namespace VlMathPG_RecursiveDescentParsers
 		std::string name{tk.token};
 
 		THROW_IF_FINISHED();
+		if (parser.peek().is("["))
+		{
+			parser.move();
+			auto index = parseE(parser);
+			EAT_TOKEN(BRACKET, "]", "Expected ] after the index");
+
+			return std::make_shared<IndexNode>(name, index, pos);
+		}
+
 		if (!parser.peek().is("(")) return std::make_shared<VariableNode>(tk);
 		parser.move();
 
@@ -144,12 +153,22 @@ namespace VlMathPG_RecursiveDescentParsers
 		CodePos pos = tk.pos;
 		std::string name{tk.token};
 
+		std::shared_ptr<Node> index = nullptr;
+		THROW_IF_FINISHED();
+		if (parser.peek().is("["))
+		{
+			parser.move();
+			index = parseE(parser);
+			EAT_TOKEN(BRACKET, "]", "Expected ] after the index");
+		}
+
 		EAT_TOKEN(OPERATOR, "=", "Expected assign operator");
 
 		auto val = parseE(parser);
 
 		EAT_TOKEN(SEMICOLON, false, "Expected ; after assign statement");
 
+		if (index != nullptr) return std::make_shared<AssignIndexNode>(name, index, val, pos);
 		return std::make_shared<AssignNode>(name, val, pos);
 	}
 
@@ -162,6 +181,17 @@ namespace VlMathPG_RecursiveDescentParsers
 		CodePos pos = tk.pos;
 		std::string name{tk.token};
 
+		THROW_IF_FINISHED();
+		if (parser.peek().is("["))
+		{
+			parser.move();
+			auto size = parseE(parser);
+			EAT_TOKEN(BRACKET, "]", "Expected ] after the array size");
+			EAT_TOKEN(SEMICOLON, false, "Expected ; after array definition");
+
+			return std::make_shared<DefArrayNode>(name, size, pos);
+		}
+
 		EAT_TOKEN(OPERATOR, "=", "Expected assign operator");
 
 		auto val = parseE(parser);
@@ -0,0 +1,92 @@
+// Copyright 2018 Aleinik Vladislav
+// Cost of the checking policies of Stack<T, N>.
+// Whole programme numbers come from valang_execute built with -DSTACK_CHECKS_BOUNDS or -DSTACK_CHECKS_NONE.
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "../libs/Stack.hpp"
+
+using namespace MyStackStaticArrayRepresentation;
+
+namespace
+{
+	const size_t STACK_SIZE = 1024;
+	const size_t REPEATS    = 200000;
+
+	// Pushes the stack full and pops it empty
+	template <class Checks>
+	double pushPop(Stack<double, STACK_SIZE, Checks>& stack)
+	{
+		double sum = 0;
+
+		for (size_t repeat = 0; repeat < REPEATS; ++repeat)
+		{
+			for (size_t i = 0; i < STACK_SIZE; ++i) stack.push(static_cast<double>(i));
+			for (size_t i = 0; i < STACK_SIZE; ++i) sum += stack.pop();
+		}
+
+		return sum;
+	}
+
+	// What a stack machine does: pushm a / pushm b / add / popm c
+	template <class Checks>
+	double interpreter(Stack<double, STACK_SIZE, Checks>& stack)
+	{
+		for (size_t i = 0; i < 16; ++i) stack.push(static_cast<double>(i));
+
+		for (size_t repeat = 0; repeat < REPEATS * 64; ++repeat)
+		{
+			size_t a = repeat % 16;
+
+			stack.push(stack.at(a));
+			stack.push(stack.at((a + 5) % 16));
+
+			double r = stack.pop();
+			double l = stack.pop();
+			stack.push(l + r);
+
+			stack.at((a + 11) % 16) = stack.pop() * 0.5;
+		}
+
+		double sum = 0;
+		while (!stack.empty()) sum += stack.pop();
+
+		return sum;
+	}
+
+	template <class Checks>
+	void measure(const char* name, double (*benchmark)(Stack<double, STACK_SIZE, Checks>&), size_t operations)
+	{
+		// Stack objects are big, they live on the heap
+		auto* stack = new Stack<double, STACK_SIZE, Checks>{};
+
+		auto start = std::chrono::steady_clock::now();
+		double result = benchmark(*stack);
+		auto finish = std::chrono::steady_clock::now();
+
+		delete stack;
+
+		double ns = std::chrono::duration<double, std::nano>(finish - start).count();
+		std::printf("  %-8s %7.3f ns/op  (%g)\n", name, ns / operations, result);
+	}
+
+	template <class Checks>
+	void measureAll(const char* name)
+	{
+		std::printf("%s:\n", name);
+
+		measure<Checks>("push/pop",    pushPop<Checks>,     REPEATS * STACK_SIZE * 2);
+		measure<Checks>("machine",     interpreter<Checks>, REPEATS * 64 * 8);
+	}
+
+} // namespace
+
+int main()
+{
+	measureAll<CanaryChecks>("CanaryChecks");
+	measureAll<BoundsChecks>("BoundsChecks");
+	measureAll<NoChecks>    ("NoChecks");
+
+	return EXIT_SUCCESS;
+}
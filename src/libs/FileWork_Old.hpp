@@ -9,9 +9,15 @@
 
 #include <cctype>
 #include <utility>
+#include <algorithm>
 
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "MyException.hpp"
 
 // Defines:
@@ -185,6 +191,8 @@ namespace FileWork
 			// Functions:
 				std::vector<unsigned char> getBytes(size_t count);
 
+				void getBytes(void* dest, size_t count);
+
 				bool finished() const;
 
 		private:
@@ -253,6 +261,36 @@ namespace FileWork
 				return toReturn;
 			}
 
+			// Copies straight from the chunk buffer, no temporary vector
+			void ReadBinaryFile::getBytes(void* dest, size_t count)
+			{
+				unsigned char* bytes = static_cast<unsigned char*>(dest);
+
+				while (count != 0)
+				{
+					if (size_ == 0) // File finished
+					{
+						throw Exception("Unable to read enough bytes from file", filename_, "", 0);
+					}
+
+					size_t toCopy = std::min(count, size_ - index_);
+
+					std::memcpy(bytes, buf_ + index_, toCopy);
+
+					bytes  += toCopy;
+					count  -= toCopy;
+					index_ += toCopy;
+
+					// Reading ahead keeps finished() exact
+					if (index_ == size_)
+					{
+						size_ = std::fread(buf_, sizeof(*buf_), sizeof(buf_), file_);
+
+						index_ = 0;
+					}
+				}
+			}
+
 			bool ReadBinaryFile::finished() const
 			{
 				if (size_ == 0) return true;
@@ -260,6 +298,111 @@ namespace FileWork
 				return false;
 			}
 
+	// Reading from file:
+	// (Binary file mapped into memory, read in place)
+
+		class MappedBinaryFile
+		{
+		public:
+			// Ctor && dtor:
+				// Copy on write mapping may be changed, the file stays as it is
+				explicit MappedBinaryFile(const char* filename, bool copyOnWrite = false);
+
+				MappedBinaryFile(const MappedBinaryFile&) = delete;
+				MappedBinaryFile& operator=(const MappedBinaryFile&) = delete;
+
+				~MappedBinaryFile();
+
+			// Getters:
+				// Page aligned, nullptr for an empty file
+				const unsigned char* data() const;
+
+				// Copy on write mapping only
+				unsigned char* writableData();
+
+				size_t size() const;
+
+		private:
+			// Variables:
+				unsigned char* data_;
+				size_t size_;
+				bool copyOnWrite_;
+		};
+
+		// Ctor && dtor:
+			MappedBinaryFile::MappedBinaryFile(const char* filename, bool copyOnWrite) :
+				data_        (nullptr),
+				size_        (0),
+				copyOnWrite_ (copyOnWrite)
+			{
+				int file = open(filename, O_RDONLY);
+				if (file == -1)
+				{
+					throw Exception("Unable to open file", filename, "", 0);
+				}
+
+				struct stat status{};
+				if (fstat(file, &status) != 0)
+				{
+					close(file);
+					throw Exception("Unable to get file size", filename, "", 0);
+				}
+
+				size_ = static_cast<size_t>(status.st_size);
+
+				if (size_ != 0)
+				{
+					// The whole file is paged in at once, not page by page while it is read
+					int flags = MAP_PRIVATE;
+				#ifdef MAP_POPULATE
+					flags |= MAP_POPULATE;
+				#endif
+
+					// Populated read only: a writable private mapping would get copies of all pages at once
+					void* mapping = mmap(nullptr, size_, PROT_READ, flags, file, 0);
+					if (mapping == MAP_FAILED)
+					{
+						close(file);
+						throw Exception("Unable to map file", filename, "", 0);
+					}
+
+					data_ = static_cast<unsigned char*>(mapping);
+
+					if (copyOnWrite && mprotect(mapping, size_, PROT_READ | PROT_WRITE) != 0)
+					{
+						munmap(mapping, size_);
+						close(file);
+						throw Exception("Unable to map file", filename, "", 0);
+					}
+				}
+
+				// The mapping stays valid without the descriptor
+				close(file);
+			}
+
+			MappedBinaryFile::~MappedBinaryFile()
+			{
+				if (data_ != nullptr) munmap(data_, size_);
+			}
+
+		// Getters:
+			const unsigned char* MappedBinaryFile::data() const
+			{
+				return data_;
+			}
+
+			unsigned char* MappedBinaryFile::writableData()
+			{
+				if (!copyOnWrite_) throw Exception("File is mapped read only", PROGRAM_POS);
+
+				return data_;
+			}
+
+			size_t MappedBinaryFile::size() const
+			{
+				return size_;
+			}
+
 	// Writing to file:
 	// (Text file)
 
@@ -427,6 +570,89 @@ namespace FileWork
 				}
 			}
 
+	// Writing to a stream:
+	// (Large buffer, the stream gets whole chunks)
+
+		class OutputBuffer
+		{
+		public:
+			// Constants:
+				static const size_t BUFFER_SIZE = 1 << 16;
+
+			// Ctor && dtor:
+				explicit OutputBuffer(std::FILE* stream);
+
+				OutputBuffer(const OutputBuffer&) = delete;
+				OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+				~OutputBuffer();
+
+			// Other func:
+				// Room for at least size bytes, size <= BUFFER_SIZE
+				char* reserve(size_t size);
+				void commit(char* end);
+
+				void write(const void* bytes, size_t size);
+
+				void flush();
+
+		private:
+			// Variables:
+				std::FILE* stream_;
+				size_t size_;
+				char buf_[BUFFER_SIZE];
+		};
+
+		// Ctor && dtor:
+			OutputBuffer::OutputBuffer(std::FILE* stream) :
+				stream_ (stream),
+				size_   (0)
+			{}
+
+			OutputBuffer::~OutputBuffer()
+			{
+				flush();
+			}
+
+		// Other func:
+			char* OutputBuffer::reserve(size_t size)
+			{
+				if (BUFFER_SIZE - size_ < size) flush();
+
+				return buf_ + size_;
+			}
+
+			void OutputBuffer::commit(char* end)
+			{
+				size_ = end - buf_;
+			}
+
+			void OutputBuffer::write(const void* bytes, size_t size)
+			{
+				const char* toWrite = static_cast<const char*>(bytes);
+
+				while (size != 0)
+				{
+					size_t chunk = std::min(size, BUFFER_SIZE);
+					char* place = reserve(chunk);
+
+					std::memcpy(place, toWrite, chunk);
+					commit(place + chunk);
+
+					toWrite += chunk;
+					size    -= chunk;
+				}
+			}
+
+			// Goes through stdio, so the order with printf calls made before the flush is kept
+			void OutputBuffer::flush()
+			{
+				if (size_ != 0) std::fwrite(buf_, 1, size_, stream_);
+				size_ = 0;
+
+				std::fflush(stream_);
+			}
+
 } // namespace FileWork 
 
 #undef FILENAME
@@ -0,0 +1,372 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_NODE_REPRESENTATION_GROWABLE_STACK_HPP_INCLUDED
+#define HEADER_GUARD_NODE_REPRESENTATION_GROWABLE_STACK_HPP_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <csetjmp>
+#include <csignal>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "MyException.hpp"
+#include "Stack.hpp"
+
+#define PROGRAM_POS __FILE__, __FUNCTION__, __LINE__
+
+// Stack in its own mapping: the maximal size is reserved, a part of it is committed and the rest
+// is committed by the SIGSEGV handler when it is touched. The page right after the maximal size
+// is never committed, so pushes don't compare the size with anything: writing there is an overflow.
+namespace MyStackStaticArrayRepresentation
+{
+	namespace _mapping
+	{
+		// [begin, committed) is read-write, [committed, end) is committed on touch, [end, end + page) is the guard
+		struct Region
+		{
+			std::atomic<char*> begin;
+			std::atomic<char*> committed;
+			char* end;
+			const char* overflowMessage;
+		};
+
+		const size_t MAX_REGIONS = 256;
+
+		// Plain data only, the fault handler reads it
+		Region* regions()
+		{
+			static Region regions[MAX_REGIONS];
+			return regions;
+		}
+
+		// begin of a region that is being filled in, the fault handler skips it
+		char* claimedMark()
+		{
+			static char mark;
+			return &mark;
+		}
+
+		size_t pageSize()
+		{
+			static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			return size;
+		}
+
+		size_t pageUp(size_t bytes)
+		{
+			return (bytes + pageSize() - 1) / pageSize() * pageSize();
+		}
+
+		char* pageUp(char* address)
+		{
+			return reinterpret_cast<char*>(pageUp(reinterpret_cast<uintptr_t>(address)));
+		}
+
+		// Set by runCatchingOverflow for the thread
+		sigjmp_buf*& recoveryPoint()
+		{
+			thread_local sigjmp_buf* point = nullptr;
+			return point;
+		}
+
+		const char*& overflowMessage()
+		{
+			thread_local const char* message = nullptr;
+			return message;
+		}
+
+		struct sigaction& previousAction(int signal)
+		{
+			static struct sigaction segv;
+			static struct sigaction bus;
+			return (signal == SIGSEGV)? segv : bus;
+		}
+
+		void onFault(int signal, siginfo_t* info, void*)
+		{
+			char* address = static_cast<char*>(info->si_addr);
+
+			for (size_t i = 0; i < MAX_REGIONS; ++i)
+			{
+				Region& region = regions()[i];
+
+				char* begin = region.begin.load(std::memory_order_acquire);
+				if (begin == nullptr || begin == claimedMark() || address < begin || address >= region.end + pageSize()) continue;
+
+				char* committed = region.committed.load(std::memory_order_relaxed);
+				if (address < committed) break;
+
+				if (address < region.end)
+				{
+					// Twice as much as committed, at least up to the touched page
+					char* newCommitted = committed + (committed - begin);
+					if (newCommitted <= address) newCommitted = pageUp(address + 1);
+					if (newCommitted >  region.end) newCommitted = region.end;
+
+					if (mprotect(committed, newCommitted - committed, PROT_READ | PROT_WRITE) != 0) break;
+
+					region.committed.store(newCommitted, std::memory_order_relaxed);
+					return;
+				}
+
+				// Guard page
+				if (recoveryPoint() == nullptr) break;
+
+				overflowMessage() = region.overflowMessage;
+				siglongjmp(*recoveryPoint(), 1);
+			}
+
+			// Not ours, the previous handler gets the fault when the command is repeated
+			sigaction(signal, &previousAction(signal), nullptr);
+		}
+
+		void installHandler()
+		{
+			static std::atomic<bool> installed{false};
+			if (installed.exchange(true)) return;
+
+			struct sigaction action{};
+			action.sa_sigaction = onFault;
+			action.sa_flags     = SA_SIGINFO | SA_NODEFER;
+			sigemptyset(&action.sa_mask);
+
+			sigaction(SIGSEGV, &action, &previousAction(SIGSEGV));
+			sigaction(SIGBUS,  &action, &previousAction(SIGBUS));
+		}
+
+		Region& addRegion(char* begin, char* committed, char* end, const char* overflowMessage)
+		{
+			installHandler();
+
+			for (size_t i = 0; i < MAX_REGIONS; ++i)
+			{
+				Region& region = regions()[i];
+
+				char* free = nullptr;
+				if (region.begin.load() != nullptr || !region.begin.compare_exchange_strong(free, claimedMark())) continue;
+
+				region.committed.store(committed, std::memory_order_relaxed);
+				region.end             = end;
+				region.overflowMessage = overflowMessage;
+
+				// Published last, onFault sees the fields filled in once it loads begin
+				region.begin.store(begin, std::memory_order_release);
+
+				return region;
+			}
+
+			throw MyException::Exception("Too many growable stacks", PROGRAM_POS);
+		}
+
+		void removeRegion(Region& region)
+		{
+			region.begin.store(nullptr, std::memory_order_release);
+		}
+
+	} // namespace _mapping
+
+	// Runs the function, an overflow of a growable stack inside it is thrown as an exception.
+	// The function is left with siglongjmp, so it must not keep objects with destructors.
+	template <class Function>
+	void runCatchingOverflow(Function function)
+	{
+		sigjmp_buf recovery;
+		sigjmp_buf* previous = _mapping::recoveryPoint();
+
+		if (sigsetjmp(recovery, 1) != 0)
+		{
+			_mapping::recoveryPoint() = previous;
+			throw MyException::Exception(_mapping::overflowMessage(), "", "", 0);
+		}
+
+		_mapping::recoveryPoint() = &recovery;
+
+		try
+		{
+			function();
+		}
+		catch (...)
+		{
+			_mapping::recoveryPoint() = previous;
+			throw;
+		}
+
+		_mapping::recoveryPoint() = previous;
+	}
+
+	template <class T, class Checks = DefaultChecks>
+	class GrowableStack
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Elements live in raw mapped memory");
+
+	private:
+		// Variables:
+			char* mapping_;
+			size_t mappingSize_;
+			_mapping::Region* region_;
+			T* stack_;
+			size_t elementCount_;
+			size_t maxSize_;
+
+	public:
+		// Ctors && dtors:
+			// The maximal size of the stack ends right at the guard page
+			GrowableStack(size_t size, size_t maxSize, const char* overflowMessage) :
+				mapping_      (nullptr),
+				mappingSize_  (0),
+				region_       (nullptr),
+				stack_        (nullptr),
+				elementCount_ (0),
+				maxSize_      (maxSize)
+			{
+				if (maxSize == 0 || size > maxSize) throw MyException::Exception("Wrong stack sizes", PROGRAM_POS);
+
+				size_t usable = _mapping::pageUp(maxSize * sizeof(T));
+				mappingSize_ = usable + _mapping::pageSize();
+
+				void* mapping = mmap(nullptr, mappingSize_, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+				if (mapping == MAP_FAILED) throw MyException::Exception("Unable to reserve the stack", PROGRAM_POS);
+
+				mapping_ = static_cast<char*>(mapping);
+
+				char* end = mapping_ + usable;
+				stack_ = reinterpret_cast<T*>(end) - maxSize;
+
+				char* committed = _mapping::pageUp(reinterpret_cast<char*>(stack_ + size));
+				if (committed == mapping_) committed += _mapping::pageSize();
+
+				if (mprotect(mapping_, committed - mapping_, PROT_READ | PROT_WRITE) != 0)
+				{
+					munmap(mapping_, mappingSize_);
+					throw MyException::Exception("Unable to commit the stack", PROGRAM_POS);
+				}
+
+				region_ = &_mapping::addRegion(mapping_, committed, end, overflowMessage);
+			}
+
+			GrowableStack(const GrowableStack&) = delete;
+			GrowableStack& operator=(const GrowableStack&) = delete;
+
+			~GrowableStack()
+			{
+				if (region_ != nullptr) _mapping::removeRegion(*region_);
+				if (mapping_ != nullptr) munmap(mapping_, mappingSize_);
+			}
+
+		// Getters and headers:
+			T& head()
+			{
+				throwIfNotOkChecked();
+
+				if constexpr (Checks::BOUNDS)
+				{
+					if (elementCount_ == 0) throw MyException::Exception("Stack is empty", PROGRAM_POS);
+				}
+
+				return stack_[elementCount_ - 1];
+			}
+
+			T& at(size_t index)
+			{
+				throwIfNotOkChecked();
+
+				if constexpr (Checks::BOUNDS)
+				{
+					if (index >= maxSize_) throw MyException::Exception("Access out of stack", PROGRAM_POS);
+				}
+
+				return stack_[index];
+			}
+
+			size_t filledSize() const
+			{
+				return elementCount_;
+			}
+
+			size_t maxSize() const
+			{
+				return maxSize_;
+			}
+
+			bool empty() const
+			{
+				throwIfNotOkChecked();
+
+				return elementCount_ == 0;
+			}
+
+			bool full() const
+			{
+				throwIfNotOkChecked();
+
+				return elementCount_ == maxSize_;
+			}
+
+		// Unchecked access, the caller keeps the bounds itself:
+			T* data()
+			{
+				return stack_;
+			}
+
+			void setFilledSize(size_t filledSize)
+			{
+				elementCount_ = filledSize;
+			}
+
+		// Push && pop:
+			// Overflow is the write to the guard page
+			GrowableStack& push(T toPush)
+			{
+				throwIfNotOkChecked();
+
+				stack_[elementCount_] = toPush;
+				elementCount_++;
+
+				return *this;
+			}
+
+			T pop()
+			{
+				throwIfNotOkChecked();
+
+				if constexpr (Checks::BOUNDS)
+				{
+					if (elementCount_ == 0) throw MyException::Exception("Stack is empty", PROGRAM_POS);
+				}
+
+				elementCount_--;
+
+				return stack_[elementCount_];
+			}
+
+		// Debugging:
+			void throwIfNotOk() const
+			{
+				if (region_ == nullptr || region_->begin.load() != mapping_)
+					throw MyException::Exception("Stack is not mapped", PROGRAM_POS);
+
+				if (elementCount_ > maxSize_)
+					throw MyException::Exception("Stack has more elements than its size provides, the stack was touched", PROGRAM_POS);
+			}
+
+	private:
+		// Functions:
+			void throwIfNotOkChecked() const
+			{
+				if constexpr (Checks::CANARIES)
+				{
+					try { throwIfNotOk(); }
+					catch (const MyException::Exception& exception)
+					{
+						throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
+					}
+				}
+			}
+	};
+}
+
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_NODE_REPRESENTATION_GROWABLE_STACK_HPP_INCLUDED*/
@@ -6,6 +6,17 @@
 
 #define PROGRAM_POS __FILE__, __FUNCTION__, __LINE__
 
+// Validates the canaries if the policy asks for it
+#define STACK_ASSERT_OK()                                                                  \
+	if constexpr (Checks::CANARIES)                                                        \
+	{                                                                                      \
+		try { throwIfNotOk(); }                                                            \
+		catch (const MyException::Exception& exception)                                    \
+		{                                                                                  \
+			throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);      \
+		}                                                                                  \
+	}
+
 namespace MyStackStaticArrayRepresentation
 {
 	namespace MyException = MyExceptionCharStringRepresentation;
@@ -21,7 +32,39 @@ namespace MyStackStaticArrayRepresentation
 		};
 	}
 
-	template <class T, size_t stackSize_>
+	// Checking policies, the interface of the stack is the same for all of them:
+
+	// Canaries around the data are validated on every access, bounds are checked
+	struct CanaryChecks
+	{
+		static const bool CANARIES = true;
+		static const bool BOUNDS   = true;
+	};
+
+	// Empty, full and index checks only
+	struct BoundsChecks
+	{
+		static const bool CANARIES = false;
+		static const bool BOUNDS   = true;
+	};
+
+	// Nothing is checked, the user of the stack keeps the bounds
+	struct NoChecks
+	{
+		static const bool CANARIES = false;
+		static const bool BOUNDS   = false;
+	};
+
+	// Build variant: -DSTACK_CHECKS_BOUNDS or -DSTACK_CHECKS_NONE, canaries otherwise
+	#if defined(STACK_CHECKS_NONE)
+		using DefaultChecks = NoChecks;
+	#elif defined(STACK_CHECKS_BOUNDS)
+		using DefaultChecks = BoundsChecks;
+	#else
+		using DefaultChecks = CanaryChecks;
+	#endif
+
+	template <class T, size_t stackSize_, class Checks = DefaultChecks>
 	class Stack
 	{
 	private:
@@ -41,11 +84,7 @@ namespace MyStackStaticArrayRepresentation
 				stack_        (),
 				guard2_       (_detail::Guard::GUARD2)
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 			}
 
 			Stack(const Stack& that) = default;
@@ -71,15 +110,11 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			const T& head() const
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (elementCount_ == 0)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Stack is empty", PROGRAM_POS);
+					if (elementCount_ == 0) throw MyException::Exception("Stack is empty", PROGRAM_POS);
 				}
 
 				return stack_[elementCount_ - 1];
@@ -88,15 +123,11 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			T& head()
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (elementCount_ == 0)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Stack is empty", PROGRAM_POS);
+					if (elementCount_ == 0) throw MyException::Exception("Stack is empty", PROGRAM_POS);
 				}
 
 				return stack_[elementCount_ - 1];
@@ -104,15 +135,11 @@ namespace MyStackStaticArrayRepresentation
 
 			T& at(size_t index)
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (index >= stackSize_)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Access out of stack", PROGRAM_POS);
+					if (index >= stackSize_) throw MyException::Exception("Access out of stack", PROGRAM_POS);
 				}
 
 				return stack_[index];
@@ -126,11 +153,7 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			bool empty() const
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
 				return elementCount_ == 0;
 			}
@@ -138,28 +161,31 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			bool full() const
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
 				return elementCount_ == stackSize_;
 			}
 
+		// Unchecked access, the caller keeps the bounds itself:
+			T* data()
+			{
+				return stack_;
+			}
+
+			void setFilledSize(size_t filledSize)
+			{
+				elementCount_ = filledSize;
+			}
+
 		// Push && pop:
 			// Strong ExcG
 			Stack& push(const T& toPush)
 			{	
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (elementCount_ == stackSize_)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Stack is full", PROGRAM_POS);
+					if (elementCount_ == stackSize_) throw MyException::Exception("Stack is full", PROGRAM_POS);
 				}
 
 				size_t elementCount = elementCount_;
@@ -189,11 +215,7 @@ namespace MyStackStaticArrayRepresentation
 
 				elementCount_++;
 
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
 				return *this;
 			}
@@ -201,15 +223,11 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			Stack& push(T&& toPush)
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (elementCount_ == stackSize_)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Stack is full", PROGRAM_POS);
+					if (elementCount_ == stackSize_) throw MyException::Exception("Stack is full", PROGRAM_POS);
 				}
 
 				size_t elementCount = elementCount_;
@@ -239,11 +257,7 @@ namespace MyStackStaticArrayRepresentation
 
 				elementCount_++;
 
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
 				return *this;
 			}
@@ -251,15 +265,11 @@ namespace MyStackStaticArrayRepresentation
 			// Strong ExcG
 			T pop()
 			{
-				try { throwIfNotOk(); }
-				catch (const MyException::Exception& exception)
-				{
-					throw MyException::Exception("Assertion failed", PROGRAM_POS, exception);
-				}
+				STACK_ASSERT_OK();
 
-				if (elementCount_ == 0)
+				if constexpr (Checks::BOUNDS)
 				{
-					throw MyException::Exception("Stack is empty", PROGRAM_POS);
+					if (elementCount_ == 0) throw MyException::Exception("Stack is empty", PROGRAM_POS);
 				}
 
 				elementCount_--;
@@ -293,5 +303,6 @@ namespace MyStackStaticArrayRepresentation
 }
 
 #undef PROGRAM_POS
+#undef STACK_ASSERT_OK
 
 #endif /*HEADER_GUARD_NODE_REPRESENTATION_STACK_HPP_INCLUDED*/
\ No newline at end of file
@@ -0,0 +1,481 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_NODE_REPRESENTATION_VECTOR_KERNELS_HPP_INCLUDED
+#define HEADER_GUARD_NODE_REPRESENTATION_VECTOR_KERNELS_HPP_INCLUDED
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// SSE2 is a part of x86-64, AVX2 is looked for at run time
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define VECTOR_KERNELS_X86_64
+	#include <immintrin.h>
+#endif
+
+// Loops over arrays of doubles. Every instruction set gives the same results bit for bit:
+// sums go to LANES partial sums by the index modulo LANES that are added up in one order,
+// products are rounded before they are added (only fma is fused, in every variant).
+// Arrays of 64 bit integers have plain loops that wrap around on overflow.
+namespace MyVectorKernels
+{
+	const size_t LANES = 8;
+
+	template <class T>
+	struct KernelsOf
+	{
+	public:
+		// Variables:
+			void (*add)(T* dst, const T* a, const T* b, size_t n);
+			void (*sub)(T* dst, const T* a, const T* b, size_t n);
+			void (*mul)(T* dst, const T* a, const T* b, size_t n);
+			bool (*div)(T* dst, const T* a, const T* b, size_t n, T limit); // false if some |b| <= limit
+			void (*fma)(T* dst, const T* a, const T* b, const T* c, size_t n);
+			T    (*dot)(const T* a, const T* b, size_t n);
+			T    (*sum)(const T* a, size_t n);
+			T    (*min)(const T* a, size_t n); // n != 0
+			T    (*max)(const T* a, size_t n); // n != 0
+	};
+
+	using Kernels = KernelsOf<double>;
+
+	namespace _lanes
+	{
+		// x < y ? x : y is what minpd does, NaNs included
+		inline double min(double x, double y) { return (x < y)? x : y; }
+		inline double max(double x, double y) { return (x > y)? x : y; }
+
+		inline double sum(const double* lanes)
+		{
+			return ((lanes[0] + lanes[4]) + (lanes[2] + lanes[6])) + ((lanes[1] + lanes[5]) + (lanes[3] + lanes[7]));
+		}
+
+		template <class Op>
+		double reduce(const double* lanes, Op op)
+		{
+			return op(op(op(lanes[0], lanes[4]), op(lanes[2], lanes[6])), op(op(lanes[1], lanes[5]), op(lanes[3], lanes[7])));
+		}
+
+	} // namespace _lanes
+
+	//-----------------------------------------------------------------------------
+
+	// Reference variants, also the tails of the others
+	namespace _scalar
+	{
+		void add(double* dst, const double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) dst[i] = a[i] + b[i]; }
+		void sub(double* dst, const double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) dst[i] = a[i] - b[i]; }
+		void mul(double* dst, const double* a, const double* b, size_t n) { for (size_t i = 0; i < n; ++i) dst[i] = a[i] * b[i]; }
+
+		bool div(double* dst, const double* a, const double* b, size_t n, double limit)
+		{
+			bool ok = true;
+			for (size_t i = 0; i < n; ++i)
+			{
+				ok = ok && !(std::abs(b[i]) <= limit);
+				dst[i] = a[i] / b[i];
+			}
+
+			return ok;
+		}
+
+		void fma(double* dst, const double* a, const double* b, const double* c, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) dst[i] = std::fma(a[i], b[i], c[i]);
+		}
+
+		// The lanes go on from the element from
+		void dotLanes(double* lanes, const double* a, const double* b, size_t from, size_t n)
+		{
+			for (size_t i = from; i < n; ++i)
+			{
+				double product = a[i] * b[i];
+				lanes[i % LANES] += product;
+			}
+		}
+
+		void sumLanes(double* lanes, const double* a, size_t from, size_t n)
+		{
+			for (size_t i = from; i < n; ++i) lanes[i % LANES] += a[i];
+		}
+
+		template <class Op>
+		void reduceLanes(double* lanes, const double* a, size_t from, size_t n, Op op)
+		{
+			for (size_t i = from; i < n; ++i) lanes[i % LANES] = op(lanes[i % LANES], a[i]);
+		}
+
+		double dot(const double* a, const double* b, size_t n)
+		{
+			double lanes[LANES] = {};
+			dotLanes(lanes, a, b, 0, n);
+			return _lanes::sum(lanes);
+		}
+
+		double sum(const double* a, size_t n)
+		{
+			double lanes[LANES] = {};
+			sumLanes(lanes, a, 0, n);
+			return _lanes::sum(lanes);
+		}
+
+		double min(const double* a, size_t n)
+		{
+			double lanes[LANES] = {a[0], a[0], a[0], a[0], a[0], a[0], a[0], a[0]};
+			reduceLanes(lanes, a, 0, n, _lanes::min);
+			return _lanes::reduce(lanes, _lanes::min);
+		}
+
+		double max(const double* a, size_t n)
+		{
+			double lanes[LANES] = {a[0], a[0], a[0], a[0], a[0], a[0], a[0], a[0]};
+			reduceLanes(lanes, a, 0, n, _lanes::max);
+			return _lanes::reduce(lanes, _lanes::max);
+		}
+
+		const Kernels KERNELS = {add, sub, mul, div, fma, dot, sum, min, max};
+
+	} // namespace _scalar
+
+#ifdef VECTOR_KERNELS_X86_64
+
+	//-----------------------------------------------------------------------------
+
+	// Two doubles a register, four registers for the eight lanes
+	namespace _sse2
+	{
+		#define VECTOR_KERNELS_ELEMENTWISE(name, intrinsic)                                      \
+			void name(double* dst, const double* a, const double* b, size_t n)                  \
+			{                                                                                    \
+				size_t i = 0;                                                                    \
+				for (; i + 4 <= n; i += 4)                                                       \
+				{                                                                                \
+					_mm_storeu_pd(dst + i,     intrinsic(_mm_loadu_pd(a + i),     _mm_loadu_pd(b + i)));     \
+					_mm_storeu_pd(dst + i + 2, intrinsic(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2))); \
+				}                                                                                \
+				_scalar::name(dst + i, a + i, b + i, n - i);                                     \
+			}
+
+		VECTOR_KERNELS_ELEMENTWISE(add, _mm_add_pd)
+		VECTOR_KERNELS_ELEMENTWISE(sub, _mm_sub_pd)
+		VECTOR_KERNELS_ELEMENTWISE(mul, _mm_mul_pd)
+
+		#undef VECTOR_KERNELS_ELEMENTWISE
+
+		bool div(double* dst, const double* a, const double* b, size_t n, double limit)
+		{
+			const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+			const __m128d limits  = _mm_set1_pd(limit);
+			__m128d bad = _mm_setzero_pd();
+
+			size_t i = 0;
+			for (; i + 2 <= n; i += 2)
+			{
+				__m128d divisor = _mm_loadu_pd(b + i);
+				bad = _mm_or_pd(bad, _mm_cmple_pd(_mm_and_pd(divisor, absMask), limits));
+				_mm_storeu_pd(dst + i, _mm_div_pd(_mm_loadu_pd(a + i), divisor));
+			}
+
+			return _scalar::div(dst + i, a + i, b + i, n - i, limit) && _mm_movemask_pd(bad) == 0;
+		}
+
+		double dot(const double* a, const double* b, size_t n)
+		{
+			__m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+			{
+				for (size_t r = 0; r < 4; ++r)
+				{
+					acc[r] = _mm_add_pd(acc[r], _mm_mul_pd(_mm_loadu_pd(a + i + 2 * r), _mm_loadu_pd(b + i + 2 * r)));
+				}
+			}
+
+			double lanes[LANES];
+			for (size_t r = 0; r < 4; ++r) _mm_storeu_pd(lanes + 2 * r, acc[r]);
+
+			_scalar::dotLanes(lanes, a, b, i, n);
+			return _lanes::sum(lanes);
+		}
+
+		double sum(const double* a, size_t n)
+		{
+			__m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+			{
+				for (size_t r = 0; r < 4; ++r) acc[r] = _mm_add_pd(acc[r], _mm_loadu_pd(a + i + 2 * r));
+			}
+
+			double lanes[LANES];
+			for (size_t r = 0; r < 4; ++r) _mm_storeu_pd(lanes + 2 * r, acc[r]);
+
+			_scalar::sumLanes(lanes, a, i, n);
+			return _lanes::sum(lanes);
+		}
+
+		template <__m128d (*op)(__m128d, __m128d), double (*scalarOp)(double, double)>
+		double reduce(const double* a, size_t n)
+		{
+			__m128d first = _mm_set1_pd(a[0]);
+			__m128d acc[4] = {first, first, first, first};
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+			{
+				for (size_t r = 0; r < 4; ++r) acc[r] = op(acc[r], _mm_loadu_pd(a + i + 2 * r));
+			}
+
+			double lanes[LANES];
+			for (size_t r = 0; r < 4; ++r) _mm_storeu_pd(lanes + 2 * r, acc[r]);
+
+			_scalar::reduceLanes(lanes, a, i, n, scalarOp);
+			return _lanes::reduce(lanes, scalarOp);
+		}
+
+		inline __m128d minPd(__m128d x, __m128d y) { return _mm_min_pd(x, y); }
+		inline __m128d maxPd(__m128d x, __m128d y) { return _mm_max_pd(x, y); }
+
+		const Kernels KERNELS = {add, sub, mul, div, _scalar::fma, dot, sum,
+		                         reduce<minPd, _lanes::min>, reduce<maxPd, _lanes::max>};
+
+	} // namespace _sse2
+
+	//-----------------------------------------------------------------------------
+
+	// Four doubles a register, two registers for the eight lanes. Only fma is compiled with FMA,
+	// so the products of dot can't be contracted.
+	namespace _avx2
+	{
+		#define VECTOR_KERNELS_ELEMENTWISE(name, intrinsic)                                      \
+			__attribute__((target("avx2")))                                                      \
+			void name(double* dst, const double* a, const double* b, size_t n)                  \
+			{                                                                                    \
+				size_t i = 0;                                                                    \
+				for (; i + 8 <= n; i += 8)                                                       \
+				{                                                                                \
+					_mm256_storeu_pd(dst + i,     intrinsic(_mm256_loadu_pd(a + i),     _mm256_loadu_pd(b + i)));     \
+					_mm256_storeu_pd(dst + i + 4, intrinsic(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4))); \
+				}                                                                                \
+				_scalar::name(dst + i, a + i, b + i, n - i);                                     \
+			}
+
+		VECTOR_KERNELS_ELEMENTWISE(add, _mm256_add_pd)
+		VECTOR_KERNELS_ELEMENTWISE(sub, _mm256_sub_pd)
+		VECTOR_KERNELS_ELEMENTWISE(mul, _mm256_mul_pd)
+
+		#undef VECTOR_KERNELS_ELEMENTWISE
+
+		__attribute__((target("avx2")))
+		bool div(double* dst, const double* a, const double* b, size_t n, double limit)
+		{
+			const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFF));
+			const __m256d limits  = _mm256_set1_pd(limit);
+			__m256d bad = _mm256_setzero_pd();
+
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				__m256d divisor = _mm256_loadu_pd(b + i);
+				bad = _mm256_or_pd(bad, _mm256_cmp_pd(_mm256_and_pd(divisor, absMask), limits, _CMP_LE_OQ));
+				_mm256_storeu_pd(dst + i, _mm256_div_pd(_mm256_loadu_pd(a + i), divisor));
+			}
+
+			return _scalar::div(dst + i, a + i, b + i, n - i, limit) && _mm256_movemask_pd(bad) == 0;
+		}
+
+		__attribute__((target("avx2,fma")))
+		void fma(double* dst, const double* a, const double* b, const double* c, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4)
+			{
+				_mm256_storeu_pd(dst + i, _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i)));
+			}
+
+			_scalar::fma(dst + i, a + i, b + i, c + i, n - i);
+		}
+
+		__attribute__((target("avx2")))
+		double dot(const double* a, const double* b, size_t n)
+		{
+			__m256d low  = _mm256_setzero_pd();
+			__m256d high = _mm256_setzero_pd();
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+			{
+				low  = _mm256_add_pd(low,  _mm256_mul_pd(_mm256_loadu_pd(a + i),     _mm256_loadu_pd(b + i)));
+				high = _mm256_add_pd(high, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+			}
+
+			double lanes[LANES];
+			_mm256_storeu_pd(lanes,     low);
+			_mm256_storeu_pd(lanes + 4, high);
+
+			_scalar::dotLanes(lanes, a, b, i, n);
+			return _lanes::sum(lanes);
+		}
+
+		__attribute__((target("avx2")))
+		double sum(const double* a, size_t n)
+		{
+			__m256d low  = _mm256_setzero_pd();
+			__m256d high = _mm256_setzero_pd();
+
+			size_t i = 0;
+			for (; i + LANES <= n; i += LANES)
+			{
+				low  = _mm256_add_pd(low,  _mm256_loadu_pd(a + i));
+				high = _mm256_add_pd(high, _mm256_loadu_pd(a + i + 4));
+			}
+
+			double lanes[LANES];
+			_mm256_storeu_pd(lanes,     low);
+			_mm256_storeu_pd(lanes + 4, high);
+
+			_scalar::sumLanes(lanes, a, i, n);
+			return _lanes::sum(lanes);
+		}
+
+		#define VECTOR_KERNELS_REDUCE(name, intrinsic)                                           \
+			__attribute__((target("avx2")))                                                      \
+			double name(const double* a, size_t n)                                               \
+			{                                                                                    \
+				__m256d low  = _mm256_set1_pd(a[0]);                                             \
+				__m256d high = low;                                                              \
+				                                                                                 \
+				size_t i = 0;                                                                    \
+				for (; i + LANES <= n; i += LANES)                                               \
+				{                                                                                \
+					low  = intrinsic(low,  _mm256_loadu_pd(a + i));                              \
+					high = intrinsic(high, _mm256_loadu_pd(a + i + 4));                          \
+				}                                                                                \
+				                                                                                 \
+				double lanes[LANES];                                                             \
+				_mm256_storeu_pd(lanes,     low);                                                \
+				_mm256_storeu_pd(lanes + 4, high);                                               \
+				                                                                                 \
+				_scalar::reduceLanes(lanes, a, i, n, _lanes::name);                              \
+				return _lanes::reduce(lanes, _lanes::name);                                      \
+			}
+
+		VECTOR_KERNELS_REDUCE(min, _mm256_min_pd)
+		VECTOR_KERNELS_REDUCE(max, _mm256_max_pd)
+
+		#undef VECTOR_KERNELS_REDUCE
+
+		const Kernels KERNELS = {add, sub, mul, div, fma, dot, sum, min, max};
+
+	} // namespace _avx2
+
+#endif // VECTOR_KERNELS_X86_64
+
+	//-----------------------------------------------------------------------------
+
+	// Computed on uint64_t, where the overflow is defined. The divisors 0 are skipped (limit is 0),
+	// -1 negates as the smallest value can't be divided by it
+	namespace _integer
+	{
+		inline int64_t wrap(uint64_t x) { return static_cast<int64_t>(x); }
+
+		void add(int64_t* dst, const int64_t* a, const int64_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) dst[i] = wrap(static_cast<uint64_t>(a[i]) + static_cast<uint64_t>(b[i]));
+		}
+
+		void sub(int64_t* dst, const int64_t* a, const int64_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) dst[i] = wrap(static_cast<uint64_t>(a[i]) - static_cast<uint64_t>(b[i]));
+		}
+
+		void mul(int64_t* dst, const int64_t* a, const int64_t* b, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) dst[i] = wrap(static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]));
+		}
+
+		bool div(int64_t* dst, const int64_t* a, const int64_t* b, size_t n, int64_t limit)
+		{
+			bool ok = true;
+			for (size_t i = 0; i < n; ++i)
+			{
+				if (std::abs(b[i]) <= limit) { ok = false; continue; }
+
+				dst[i] = (b[i] == -1)? wrap(0 - static_cast<uint64_t>(a[i])) : a[i] / b[i];
+			}
+
+			return ok;
+		}
+
+		void fma(int64_t* dst, const int64_t* a, const int64_t* b, const int64_t* c, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				dst[i] = wrap(static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]) + static_cast<uint64_t>(c[i]));
+			}
+		}
+
+		int64_t dot(const int64_t* a, const int64_t* b, size_t n)
+		{
+			uint64_t result = 0;
+			for (size_t i = 0; i < n; ++i) result += static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]);
+			return wrap(result);
+		}
+
+		int64_t sum(const int64_t* a, size_t n)
+		{
+			uint64_t result = 0;
+			for (size_t i = 0; i < n; ++i) result += static_cast<uint64_t>(a[i]);
+			return wrap(result);
+		}
+
+		int64_t min(const int64_t* a, size_t n)
+		{
+			int64_t result = a[0];
+			for (size_t i = 1; i < n; ++i) result = (a[i] < result)? a[i] : result;
+			return result;
+		}
+
+		int64_t max(const int64_t* a, size_t n)
+		{
+			int64_t result = a[0];
+			for (size_t i = 1; i < n; ++i) result = (a[i] > result)? a[i] : result;
+			return result;
+		}
+
+		const KernelsOf<int64_t> KERNELS = {add, sub, mul, div, fma, dot, sum, min, max};
+
+	} // namespace _integer
+
+	//-----------------------------------------------------------------------------
+
+	template <class T>
+	const KernelsOf<T>& kernels();
+
+	template <>
+	inline const KernelsOf<int64_t>& kernels<int64_t>()
+	{
+		return _integer::KERNELS;
+	}
+
+	// The best variant the processor runs
+	template <>
+	inline const Kernels& kernels<double>()
+	{
+	#ifdef VECTOR_KERNELS_X86_64
+
+		static const Kernels& chosen = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))?
+		                               _avx2::KERNELS : _sse2::KERNELS;
+		return chosen;
+
+	#else
+
+		return _scalar::KERNELS;
+
+	#endif
+	}
+
+} // namespace MyVectorKernels
+
+#endif /*HEADER_GUARD_NODE_REPRESENTATION_VECTOR_KERNELS_HPP_INCLUDED*/
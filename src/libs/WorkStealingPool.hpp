@@ -0,0 +1,112 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_NODE_REPRESENTATION_WORK_STEALING_POOL_HPP_INCLUDED
+#define HEADER_GUARD_NODE_REPRESENTATION_WORK_STEALING_POOL_HPP_INCLUDED
+
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a known number of independent jobs on a set of threads.
+// Jobs are dealt round robin, so low job numbers are done first. A worker takes its own jobs
+// from the front of its queue, the one whose queue is empty steals from the back of the others.
+namespace MyThreadPool
+{
+	class WorkStealingPool
+	{
+	public:
+		// Ctor:
+			explicit WorkStealingPool(size_t threadCount) :
+				threadCount_ ((threadCount == 0)? 1 : threadCount)
+			{}
+
+		// Functions:
+			// task(job) for every job in [0, jobCount), the calling thread is one of the workers.
+			// The first exception a task throws is rethrown when all jobs are over.
+			template <class Task>
+			void run(size_t jobCount, Task task)
+			{
+				std::vector<Queue> queues(threadCount_);
+				for (size_t job = 0; job < jobCount; ++job) queues[job % threadCount_].jobs.push_back(job);
+
+				std::exception_ptr failure;
+				std::mutex failureMutex;
+
+				auto worker = [&](size_t self)
+				{
+					size_t job = 0;
+					while (take(queues, self, job))
+					{
+						try
+						{
+							task(job);
+						}
+						catch (...)
+						{
+							std::lock_guard<std::mutex> lock(failureMutex);
+							if (!failure) failure = std::current_exception();
+						}
+					}
+				};
+
+				std::vector<std::thread> threads;
+				for (size_t self = 1; self < threadCount_ && self < jobCount; ++self) threads.emplace_back(worker, self);
+
+				worker(0);
+
+				for (std::thread& thread : threads) thread.join();
+
+				if (failure) std::rethrow_exception(failure);
+			}
+
+			size_t threadCount() const
+			{
+				return threadCount_;
+			}
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<size_t> jobs;
+		};
+
+		// Variables:
+			size_t threadCount_;
+
+		// Functions:
+			// No job is added while the pool runs, so all queues empty means the work is over
+			static bool take(std::vector<Queue>& queues, size_t self, size_t& job)
+			{
+				{
+					Queue& own = queues[self];
+					std::lock_guard<std::mutex> lock(own.mutex);
+
+					if (!own.jobs.empty())
+					{
+						job = own.jobs.front();
+						own.jobs.pop_front();
+						return true;
+					}
+				}
+
+				for (size_t i = 1; i < queues.size(); ++i)
+				{
+					Queue& victim = queues[(self + i) % queues.size()];
+					std::lock_guard<std::mutex> lock(victim.mutex);
+
+					if (!victim.jobs.empty())
+					{
+						job = victim.jobs.back();
+						victim.jobs.pop_back();
+						return true;
+					}
+				}
+
+				return false;
+			}
+	};
+}
+
+#endif /*HEADER_GUARD_NODE_REPRESENTATION_WORK_STEALING_POOL_HPP_INCLUDED*/
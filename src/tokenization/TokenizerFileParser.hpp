@@ -20,7 +20,7 @@ namespace TokenizeFParser
 		TokenRegex("[A-Z][a-zA-Z0-9]*"),
 		TokenRegex("[!%%&*+\\-./:<=>?@^|~]+"),
 		TokenRegex("-?(0|[1-9][0-9]*)(\\.[0-9]+)?"),
-		TokenRegex("[\\(\\)\\{\\}]"),
+		TokenRegex("[\\(\\)\\{\\}\\[\\]]"),
 		TokenRegex(","),
 		TokenRegex(";")
 	};
@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "assembler/Assembler.hpp"
+#include "assembler/RegAssembler.hpp"
 
 #define FILENAME "src/assemble.cpp"
 #define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
@@ -12,12 +13,17 @@ int main(int argc, const char* argv[])
 {
 	try
 	{
-		if (argc != 4)
+		if (argc != 4 && !(argc == 5 && std::strcmp(argv[4], "--strip-debug") == 0))
 		{
-			throw Exception("Input pattern: valang_assemble <src> --std=<std> <dest>", PROGRAM_POS);
+			throw Exception("Input pattern: valang_assemble <src> --std=<std> <dest> [--strip-debug]", PROGRAM_POS);
 		}
 
-		if (std::strcmp(argv[2], "--std=2") == 0) AssemblerStd1::assemble(argv[1], argv[3]);
+		// Standard 3 keeps the source positions unless asked not to
+		bool withDebug = (argc == 4);
+
+		if      (std::strcmp(argv[2], "--std=3")   == 0) AssemblerStd1::assemble(argv[1], argv[3], MyStd1::STD_NUM, withDebug);
+		else if (std::strcmp(argv[2], "--std=2")   == 0) AssemblerStd1::assemble(argv[1], argv[3], MyStd1::STD_NUM_2);
+		else if (std::strcmp(argv[2], "--std=reg") == 0) AssemblerReg::assemble(argv[1], argv[3]);
 		else throw Exception("Unknown standard", PROGRAM_POS);
 	}
 	catch (Exception& ex)
@@ -1,24 +1,121 @@
 // Copyright 2016 Aleinik Vladislav
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "virt_proc_execute/CPU.hpp"
+#include "virt_proc_execute/ThreadedCPU.hpp"
+#include "virt_proc_execute/JitCPU.hpp"
+#include "virt_proc_execute/TraceJitCPU.hpp"
+#include "virt_proc_execute/RegCPU.hpp"
+#include "virt_proc_execute/BatchCPU.hpp"
+#include "virt_proc_execute/Profiler.hpp"
 
 #define FILENAME "std1/valang.cpp"
 #define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
 
 using namespace MyExceptionCharStringRepresentation;
 
+// --name=N, N is a positive number
+bool parseSize(const char* option, const char* name, size_t& size)
+{
+	size_t nameLength = std::strlen(name);
+	if (std::strncmp(option, name, nameLength) != 0 || option[nameLength] != '=') return false;
+
+	char* end = nullptr;
+	unsigned long long value = std::strtoull(option + nameLength + 1, &end, 10);
+	if (end == option + nameLength + 1 || *end != '\0' || value == 0) throw Exception("Wrong number in option", PROGRAM_POS);
+
+	size = static_cast<size_t>(value);
+	return true;
+}
+
 int main(int argc, const char* argv[])
 {
 	try
 	{
-		if (argc != 2)
+		if (argc < 2)
+		{
+			throw Exception("Input pattern: valang_execute <src> [--engine=classic|threaded] [--jit] [--jit=trace] [--verify] "
+			                "[--stack-size=N] [--max-stack-size=N] [--output=text|shortest|binary] "
+			                "[--input=FILE] [--input-format=text|binary] [--batch=MANIFEST] [--threads=N] "
+			                "[--snapshot=FILE] [--snapshot-every=N] [--resume=FILE] [--profile] [--sample] [--sample-rate=N]", PROGRAM_POS);
+		}
+
+		bool threaded = false;
+		bool classic  = false; // Asked for, batch mode is threaded otherwise
+		bool jit      = false;
+		bool traced   = false;
+		bool verify   = false;
+		bool profile  = false;
+
+		MyStd1::_output::Format format = MyStd1::_output::Format::TEXT;
+		MyStd1::_input::Source  input{};
+
+		EmulatedProcessorStd1::_snapshot::Options snapshots{};
+
+		const char* manifest    = nullptr;
+		size_t      threadCount = 0; // All cores
+
+		size_t sampleRate = 0; // Not sampled
+
+		MyStd1::_command::StackSizes sizes{};
+		for (int argI = 2; argI < argc; ++argI)
 		{
-			throw Exception("Input pattern: valang_execute <src>", PROGRAM_POS);
+			if      (std::strcmp(argv[argI], "--engine=classic")  == 0) threaded = false, classic = true;
+			else if (std::strcmp(argv[argI], "--engine=threaded") == 0) threaded = true,  classic = false;
+			else if (std::strcmp(argv[argI], "--jit")             == 0) jit      = true,  traced = false;
+			else if (std::strcmp(argv[argI], "--jit=trace")       == 0) traced   = true,  jit    = false;
+			else if (std::strcmp(argv[argI], "--verify")          == 0) verify   = true;
+			else if (std::strcmp(argv[argI], "--profile")         == 0) profile  = true;
+			else if (std::strcmp(argv[argI], "--sample")          == 0) sampleRate = EmulatedProcessorStd1::_sampler::DEFAULT_RATE;
+			else if (parseSize(argv[argI], "--sample-rate",     sampleRate))   {}
+			else if (std::strcmp(argv[argI], "--output=text")     == 0) format   = MyStd1::_output::Format::TEXT;
+			else if (std::strcmp(argv[argI], "--output=shortest") == 0) format   = MyStd1::_output::Format::SHORTEST;
+			else if (std::strcmp(argv[argI], "--output=binary")   == 0) format   = MyStd1::_output::Format::BINARY;
+			else if (std::strncmp(argv[argI], "--input=", 8)      == 0) input.filename = argv[argI] + 8;
+			else if (std::strcmp(argv[argI], "--input-format=text")   == 0) input.binary = false;
+			else if (std::strcmp(argv[argI], "--input-format=binary") == 0) input.binary = true;
+			else if (std::strncmp(argv[argI], "--batch=", 8)      == 0) manifest = argv[argI] + 8;
+			else if (parseSize(argv[argI], "--threads",        threadCount))   {}
+			else if (std::strncmp(argv[argI], "--snapshot=", 11)  == 0) snapshots.filename = argv[argI] + 11;
+			else if (std::strncmp(argv[argI], "--resume=", 9)     == 0) snapshots.resume   = argv[argI] + 9;
+			else if (parseSize(argv[argI], "--snapshot-every", snapshots.every)) {}
+			else if (parseSize(argv[argI], "--stack-size",     sizes.size))    {}
+			else if (parseSize(argv[argI], "--max-stack-size", sizes.maxSize)) {}
+			else throw Exception("Unknown option", PROGRAM_POS);
 		}
 
-		EmulatedProcessorStd1::execute(argv[1]);
+		if (sizes.maxSize > MyStd1::_command::MAX_STACK_SIZE) throw Exception("Maximal stack size is too large", PROGRAM_POS);
+		if (sizes.size > sizes.maxSize) sizes.size = sizes.maxSize;
+
+		if (snapshots.every != 0 && snapshots.filename == nullptr) throw Exception("--snapshot-every needs --snapshot", PROGRAM_POS);
+		if (sampleRate > EmulatedProcessorStd1::_sampler::MAX_RATE) throw Exception("Sample rate is too high", PROGRAM_POS);
+
+		// Register machine programmes have one engine only
+		if (EmulatedProcessorReg::isRegProgramme(argv[1]))
+		{
+			if (manifest != nullptr) throw Exception("Batch mode runs stack machine programmes only", PROGRAM_POS);
+			if (snapshots.any())     throw Exception("Snapshots are taken of stack machine programmes only", PROGRAM_POS);
+			if (profile || sampleRate != 0) throw Exception("Stack machine programmes only are profiled", PROGRAM_POS);
+			if (input.filename != nullptr || input.binary)
+			{
+				throw Exception("Register machine programmes have no IN, --input is for stack machine ones", PROGRAM_POS);
+			}
+
+			if (verify) EmulatedProcessorReg::reportVerification(argv[1]);
+			else        EmulatedProcessorReg::execute(argv[1], sizes, format);
+		}
+		else if (verify)   EmulatedProcessorStd1::reportVerification(argv[1]);
+		else if (manifest && snapshots.any()) throw Exception("Snapshots are not taken in batch mode", PROGRAM_POS);
+		else if (profile && (manifest || snapshots.any())) throw Exception("--profile runs alone, without batch mode and snapshots", PROGRAM_POS);
+		else if (sampleRate != 0 && (manifest || profile)) throw Exception("--sample runs without batch mode and --profile", PROGRAM_POS);
+		else if (profile)  EmulatedProcessorStd1::executeProfiled(argv[1], sizes, format, input);
+		else if (manifest) EmulatedProcessorStd1::executeBatch(argv[1], manifest, threadCount, !classic, sizes, format, input.binary);
+		else if (traced)   EmulatedProcessorStd1::executeTraced(argv[1], sizes, format, input, snapshots, static_cast<unsigned>(sampleRate));
+		else if (jit)      EmulatedProcessorStd1::executeJit(argv[1], sizes, format, input, snapshots, static_cast<unsigned>(sampleRate));
+		else if (threaded) EmulatedProcessorStd1::executeThreaded(argv[1], sizes, format, input, snapshots, static_cast<unsigned>(sampleRate));
+		else               EmulatedProcessorStd1::execute(argv[1], sizes, format, input, snapshots, static_cast<unsigned>(sampleRate));
 	}
 	catch (Exception& ex)
 	{
@@ -1,6 +1,7 @@
 // Copyright 2016 Aleinik Vladislav
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <strstream>
 #include <fstream>
@@ -8,6 +9,7 @@
 #include "ast/RecursiveDescent.hpp"
 #include "ast/AST_Print.hpp"
 #include "asm_translation/AsmTranslation.hpp"
+#include "asm_translation/RegTranslation.hpp"
 
 int main(int argc, const char* argv[])
 {
@@ -15,15 +17,31 @@ int main(int argc, const char* argv[])
 
 	try
 	{
-		if (argc != 3) throw Exception("Input pattern: valang_translate <src> <dest>"_msg);
+		if (argc != 3 && argc != 4) throw Exception("Input pattern: valang_translate <src> <dest> [--target=stack|reg]"_msg);
+
+		bool toReg = false;
+		if (argc == 4)
+		{
+			if      (std::strcmp(argv[3], "--target=stack") == 0) toReg = false;
+			else if (std::strcmp(argv[3], "--target=reg")   == 0) toReg = true;
+			else throw Exception("Unknown target"_msg);
+		}
 
 		auto parser = VMPG::createParser(argv[1]);
 
 		auto ast = VMPG::parsePg(parser);
 
-		VlMathPG_AST::AsmTranslator translator;
 		std::strstream assembled_stream;
-		ast->translate(assembled_stream, translator);
+		if (toReg)
+		{
+			VlMathPG_AST::RegTranslator translator;
+			ast->translateReg(assembled_stream, translator);
+		}
+		else
+		{
+			VlMathPG_AST::AsmTranslator translator;
+			ast->translate(assembled_stream, translator);
+		}
 
 		std::fstream file;
 		file.open(argv[2], std::fstream::out);
@@ -0,0 +1,231 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_BATCH_CPU_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_BATCH_CPU_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+
+#include "ThreadedCPU.hpp"
+#include "../libs/WorkStealingPool.hpp"
+
+// Defines:
+
+#define FILENAME "std1/BatchCPU.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// The programme is loaded and prepared once, every job of the manifest runs it on the threaded or
+// the classic engine with its own CPU and its own input. Output of a job is kept in memory until
+// the jobs before it are written, so stdout and stderr get whole jobs in the order of the manifest.
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _batch
+	{
+		struct Job
+		{
+		public:
+			// Variables:
+				std::string input;
+
+				char*  values      = nullptr; // open_memstream buffers
+				size_t valuesSize  = 0;
+				char*  reports     = nullptr;
+				size_t reportsSize = 0;
+
+				bool finished = false;
+		};
+
+		// One input file per line, empty lines are skipped
+		std::vector<Job> readManifest(const char* manifest)
+		{
+			FileWork::MappedBinaryFile file{manifest};
+
+			const char* cur = reinterpret_cast<const char*>(file.data());
+			const char* end = cur + file.size();
+
+			std::vector<Job> jobs;
+
+			while (cur != end)
+			{
+				const char* lineEnd = cur;
+				while (lineEnd != end && *lineEnd != '\n') ++lineEnd;
+
+				const char* last = lineEnd;
+				while (last != cur && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) --last;
+				while (cur != last && (*cur == ' ' || *cur == '\t')) ++cur;
+
+				if (cur != last) jobs.push_back({std::string(cur, last)});
+
+				cur = (lineEnd == end)? end : lineEnd + 1;
+			}
+
+			return jobs;
+		}
+
+		// Whoever finishes the next job in order writes it and the finished jobs after it
+		class OrderedWriter
+		{
+		public:
+			// Ctor:
+				explicit OrderedWriter(std::vector<Job>& jobs) :
+					jobs_  (jobs),
+					mutex_ (),
+					next_  (0)
+				{}
+
+			// Functions:
+				void finished(size_t job)
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+
+					jobs_[job].finished = true;
+
+					for (; next_ < jobs_.size() && jobs_[next_].finished; ++next_)
+					{
+						Job& toWrite = jobs_[next_];
+
+						std::fwrite(toWrite.values,  1, toWrite.valuesSize,  stdout);
+						std::fwrite(toWrite.reports, 1, toWrite.reportsSize, stderr);
+
+						std::free(toWrite.values);
+						std::free(toWrite.reports);
+						toWrite.values  = nullptr;
+						toWrite.reports = nullptr;
+					}
+
+					std::fflush(stdout);
+				}
+
+		private:
+			// Variables:
+				std::vector<Job>& jobs_;
+				std::mutex mutex_;
+				size_t next_;
+		};
+
+		// Output of a job whose buffers couldn't be opened is the error only
+		void failWithoutStreams(Job& job, std::FILE* values, std::FILE* reports)
+		{
+			if (values  != nullptr) std::fclose(values);
+			if (reports != nullptr) std::fclose(reports);
+
+			std::free(job.values);
+			std::free(job.reports);
+			job.reports     = nullptr;
+			job.reportsSize = 0;
+
+			std::string error{Exception("Unable to create the output of a job", job.input.c_str(), "-", 0).what()};
+			error += '\n';
+
+			job.values     = strdup(error.c_str());
+			job.valuesSize = (job.values != nullptr)? error.size() : 0;
+		}
+
+		// Runtime errors are a part of the output of the job, other jobs go on
+		void runJob(const char* filename, const _program::Program& program, bool threaded, bool verified, Job& job,
+		            MyStd1::_command::StackSizes sizes, MyStd1::_output::Format format, bool binaryInput)
+		{
+			std::FILE* values  = open_memstream(&job.values,  &job.valuesSize);
+			std::FILE* reports = open_memstream(&job.reports, &job.reportsSize);
+
+			// The job fails alone, the writer waits for it
+			if (values == nullptr || reports == nullptr)
+			{
+				failWithoutStreams(job, values, reports);
+				return;
+			}
+
+			// The binary output has its reports apart, the text output has them in line with the values
+			MyStd1::_output::Streams streams{values, (format == MyStd1::_output::Format::BINARY)? reports : values};
+
+			thread_local std::vector<const void*> handlers;
+
+			try
+			{
+				MyStd1::_command::CPU cpu{sizes, format, {job.input.c_str(), binaryInput}, streams};
+				cpu.curCmd = program.entry;
+
+				try
+				{
+					runCatchingOverflow([&]()
+					{
+						if      (!threaded) _command::run(program, cpu);
+						else if (verified)  _threaded::run<false>(program, cpu, handlers);
+						else                _threaded::run<true> (program, cpu, handlers);
+					});
+				}
+				catch (Exception& exc)
+				{
+					// The input of the job on top of the source position
+					try
+					{
+						rethrowRuntimeError(filename, program, cpu, exc);
+					}
+					catch (Exception& positioned)
+					{
+						throw Exception("Job failed", job.input.c_str(), "-", 0, positioned);
+					}
+				}
+			}
+			catch (Exception& exc)
+			{
+				std::fprintf(values, "%s\n", exc.what());
+			}
+			catch (std::exception& exc)
+			{
+				std::fprintf(values, "%s\n", exc.what());
+			}
+
+			std::fclose(values);
+			std::fclose(reports);
+		}
+
+	} // namespace _batch
+
+	void executeBatch(const char* filename, const char* manifest, size_t threadCount, bool threaded = true,
+	                  MyStd1::_command::StackSizes sizes = {},
+	                  MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, bool binaryInput = false)
+	{
+		_program::Program program{_program::load(filename)};
+
+		_verifier::Report report{};
+
+		if (threaded)
+		{
+			report = _verifier::verify(program);
+			_fusion::fuse(program);
+		}
+		else _command::buildCommands(program);
+
+		// All jobs share the programme from here on
+		const _program::Program& shared = program;
+
+		std::vector<_batch::Job> jobs{_batch::readManifest(manifest)};
+		_batch::OrderedWriter writer{jobs};
+
+		if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+
+		MyThreadPool::WorkStealingPool pool{threadCount};
+		pool.run(jobs.size(), [&](size_t job)
+		{
+			_batch::runJob(filename, shared, threaded, report.verified, jobs[job], sizes, format, binaryInput);
+			writer.finished(job);
+		});
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_BATCH_CPU_HPP_INCLUDED*/
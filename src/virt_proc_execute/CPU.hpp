@@ -4,11 +4,19 @@
 
 // Includes:
 
+#include <vector>
+#include <memory>
+#include <cstring>
+
 #include "../libs/MyException.hpp"
 #include "../libs/FileWork_Old.hpp"
 #include "../libs/Stack.hpp"
 
-#include "../assembler_std/Standard1.hpp"
+#include "../assembler_std/Standard2.hpp"
+#include "../assembler_std/DebugInfo.hpp"
+
+#include "Snapshot.hpp"
+#include "Sampler.hpp"
 
 // Defines:
 
@@ -24,25 +32,54 @@ namespace EmulatedProcessorStd1
 
 	namespace _additional
 	{
-		template <typename ToRead> 
-		ToRead getFromBinaryFile(FileWork::ReadBinaryFile& stream)
+		// Reads fields of a mapped file in place, one after another
+		class MappedReader
 		{
-			std::vector<unsigned char> bytes{stream.getBytes(sizeof(ToRead))};
+		public:
+			// Ctor:
+				MappedReader(const unsigned char* bytes, size_t size) :
+					bytes_  (bytes),
+					size_   (size),
+					offset_ (0)
+				{}
+
+			// Functions:
+				template <typename ToRead>
+				ToRead get()
+				{
+					if (offset_ > size_ || size_ - offset_ < sizeof(ToRead))
+					{
+						throw Exception("Unable to read enough bytes from file", PROGRAM_POS);
+					}
 
-			ToRead* data = reinterpret_cast<ToRead*>(bytes.data());
+					ToRead data{};
+					std::memcpy(&data, bytes_ + offset_, sizeof(ToRead));
+					offset_ += sizeof(ToRead);
 
-			return *data;
-		}
+					return data;
+				}
+
+				bool finished() const
+				{
+					return offset_ >= size_;
+				}
+
+		private:
+			// Variables:
+				const unsigned char* bytes_;
+				size_t size_;
+				size_t offset_;
+		};
 
 	} // namespace _additional
 
 	namespace _address
 	{
-		MyStd1::RegAdr_t getAddress(FileWork::ReadBinaryFile& stream)
+		MyStd1::RegAdr_t getAddress(_additional::MappedReader& reader)
 		{
 			try
 			{
-				return _additional::getFromBinaryFile<MyStd1::RegAdr_t>(stream);
+				return reader.get<MyStd1::RegAdr_t>();
 			}
 			catch (std::exception& exc)
 			{
@@ -54,11 +91,11 @@ namespace EmulatedProcessorStd1
 
 	namespace _value
 	{
-		MyStd1::Val_t getValue(FileWork::ReadBinaryFile& stream)
+		MyStd1::Val_t getValue(_additional::MappedReader& reader)
 		{
 			try
 			{
-				return _additional::getFromBinaryFile<MyStd1::Val_t>(stream);
+				return reader.get<MyStd1::Val_t>();
 			}
 			catch (std::exception& exc)
 			{
@@ -68,13 +105,15 @@ namespace EmulatedProcessorStd1
 
 	} // namespace _value
 
+	// Standard 2 operands, command numbers and memory addresses are 16 bit there
+
 	namespace _commandNumber
 	{
-		MyStd1::CmdNum_t getCommandNumber(FileWork::ReadBinaryFile& stream)
+		MyStd1::CmdNum_t getCommandNumber(_additional::MappedReader& reader)
 		{
 			try
 			{
-				return _additional::getFromBinaryFile<MyStd1::CmdNum_t>(stream);
+				return reader.get<MyStd1::CmdNum2_t>();
 			}
 			catch (std::exception& exc)
 			{
@@ -86,11 +125,11 @@ namespace EmulatedProcessorStd1
 
 	namespace _memory
 	{
-		MyStd1::MemAdr_t getMemoryAddress(FileWork::ReadBinaryFile& stream)
+		MyStd1::MemAdr_t getMemoryAddress(_additional::MappedReader& reader)
 		{
 			try
 			{
-				return _additional::getFromBinaryFile<MyStd1::MemAdr_t>(stream);
+				return reader.get<MyStd1::MemAdr2_t>();
 			}
 			catch (std::exception& exc)
 			{
@@ -102,11 +141,11 @@ namespace EmulatedProcessorStd1
 
 	namespace _command
 	{
-		MyStd1::Cmd_t getCommand(FileWork::ReadBinaryFile& stream)
+		MyStd1::Cmd_t getCommand(_additional::MappedReader& reader)
 		{
 			try
 			{
-				return _additional::getFromBinaryFile<MyStd1::Cmd_t>(stream);
+				return reader.get<MyStd1::Cmd_t>();
 			}
 			catch (std::exception& exc)
 			{
@@ -114,99 +153,358 @@ namespace EmulatedProcessorStd1
 			}
 		}
 
+	} // namespace _command
+
+	// Decoded program: one contiguous array of commands with their operands stored inline
+	namespace _program
+	{
+		using Instruction = MyStd1::Instruction;
+
+		// Commands of a programme: decoded into own memory or, for standard 3, the mapped file itself
+		class Code
+		{
+		public:
+			// Ctor:
+				Code() :
+					owned_  (),
+					mapped_ (),
+					data_   (nullptr),
+					size_   (0)
+				{}
+
+				Code(Code&& that) = default;
+				Code& operator=(Code&& that) = default;
+
+			// Filling:
+				void reserve(size_t count)
+				{
+					owned_.reserve(count);
+					data_ = owned_.data();
+				}
+
+				void push_back(const Instruction& instr)
+				{
+					owned_.push_back(instr);
+
+					data_ = owned_.data();
+					size_ = owned_.size();
+				}
+
+				// Instructions lie in the copy on write mapping
+				void adopt(std::unique_ptr<FileWork::MappedBinaryFile> file, Instruction* first, size_t count)
+				{
+					owned_.clear();
+
+					mapped_ = std::move(file);
+					data_   = first;
+					size_   = count;
+				}
+
+			// Access:
+				size_t size() const { return size_; }
+				bool  empty() const { return size_ == 0; }
+
+				      Instruction* data()       { return data_; }
+				const Instruction* data() const { return data_; }
+
+				      Instruction& operator[](size_t pc)       { return data_[pc]; }
+				const Instruction& operator[](size_t pc) const { return data_[pc]; }
+
+				      Instruction* begin()       { return data_; }
+				const Instruction* begin() const { return data_; }
+				      Instruction* end()         { return data_ + size_; }
+				const Instruction* end()   const { return data_ + size_; }
+
+		private:
+			// Variables:
+				std::vector<Instruction> owned_;
+				std::unique_ptr<FileWork::MappedBinaryFile> mapped_;
+				Instruction* data_;
+				size_t size_;
+		};
+
+		// Not changed once it is loaded (fused, built), so any number of CPUs may run it at once
+		struct Program
+		{
+		public:
+			// Variables:
+				Code code;
+				MyStd1::CmdNum_t entry;
+				MyStd1::_command::CommandBuffer commands; // Classic engine, see _command::buildCommands
+		};
+
 		//-----------------------------------------------------------------------------
 
-		MyStd1::_command::Command* commandFromFile(FileWork::ReadBinaryFile& stream, MyStd1::_command::CPU& cpu)
+		Instruction instructionFromFile(_additional::MappedReader& reader)
+		{
+			using namespace MyStd1::_command;
+
+			Instruction instr{};
+			instr.cmd = _command::getCommand(reader);
+
+			if (instr.cmd >= COMMAND_COUNT) throw Exception("Unknown command number", PROGRAM_POS);
+
+			if (COMMANDS[instr.cmd].argTypes.empty()) return instr;
+
+			switch (COMMANDS[instr.cmd].argTypes[0])
+			{
+				case ArgType::VALUE:            instr.arg.value  = _value::getValue(reader);                 break;
+				case ArgType::REGISTER_ADDRESS: instr.arg.regAdr = _address::getAddress(reader);             break;
+				case ArgType::NAMETAG:          instr.arg.cmdNum = _commandNumber::getCommandNumber(reader); break;
+				case ArgType::MEMORY_ADDRESS:   instr.arg.memAdr = _memory::getMemoryAddress(reader);        break;
+				default: throw Exception("Unexpected argType", PROGRAM_POS);
+			}
+
+			return instr;
+		}
+
+		// Standard 3 code section is checked and run from the mapping, nothing is copied
+		void adoptStd3(std::unique_ptr<FileWork::MappedBinaryFile> file, Program& program, const char* filename)
+		{
+			MyStd1::FileHeader header{_additional::MappedReader{file->data(), file->size()}.get<MyStd1::FileHeader>()};
+
+			// The code must fit into the file behind the header, a header larger than the file included
+			if (header.headerSize < sizeof(header) || header.headerSize % alignof(Instruction) != 0 ||
+			    static_cast<size_t>(header.codeSize) != header.commandCount * sizeof(Instruction) ||
+			    static_cast<size_t>(header.headerSize) > file->size() ||
+			    file->size() - static_cast<size_t>(header.headerSize) < static_cast<size_t>(header.codeSize))
+			{
+				throw Exception("Broken header", filename, "-", 0);
+			}
+
+			Instruction* code = reinterpret_cast<Instruction*>(file->writableData() + header.headerSize);
+
+			for (size_t cmd = 0; cmd < header.commandCount; ++cmd)
+			{
+				if (code[cmd].cmd >= MyStd1::_command::COMMAND_COUNT) throw Exception("Unknown command number", PROGRAM_POS);
+			}
+
+			program.code.adopt(std::move(file), code, header.commandCount);
+		}
+
+		// Standard 2 is decoded from the mapping into own memory
+		void decodeStd2(_additional::MappedReader& reader, Program& program)
+		{
+			while (!reader.finished())
+			{
+				program.code.push_back(instructionFromFile(reader));
+			}
+		}
+
+		Program load(const char* filename)
+		{
+			auto file = std::make_unique<FileWork::MappedBinaryFile>(filename, true);
+
+			Program program{};
+
+			try
+			{
+				_additional::MappedReader reader{file->data(), file->size()};
+
+				if (reader.get<MyStd1::MagicNum_t>() != MyStd1::MAGIC_NUM)
+				{
+					throw Exception("Unknown file format", filename, "-", 0);
+				}
+
+				MyStd1::StdNum_t std = reader.get<MyStd1::StdNum_t>();
+
+				// Standard 2 keeps doubles
+				bool doubles = !MyStd1::_values::INTEGER;
+
+				if      (std == MyStd1::STD_NUM)              adoptStd3(std::move(file), program, filename);
+				else if (std == MyStd1::STD_NUM_2 && doubles) decodeStd2(reader, program);
+				else if (std == MyStd1::STD_NUM_2 || std == MyStd1::STD_NUM_DOUBLE || std == MyStd1::STD_NUM_I64)
+				{
+					throw Exception(MyStd1::OTHER_VALUE_TYPE, filename, "-", 0);
+				}
+				else throw Exception("Unknown standard", filename, "-", 0);
+
+				// Same entry point rule as in _command::commandFromFile
+				for (size_t cmd = 0; cmd < program.code.size(); ++cmd)
+				{
+					if (program.code[cmd].cmd == MyStd1::_command::CMD_BEG && program.entry == 0) program.entry = cmd;
+				}
+			}
+			catch (Exception& exc)
+			{
+				throw Exception("Unable to read file", filename, "-", 0, exc);
+			}
+
+			return program;
+		}
+
+		// Every jump must land inside the programme or right after its end
+		void checkJumpTargets(const Program& program)
 		{
-			using namespace _value;
-			using namespace _address;
-			using namespace _commandNumber;
 			using namespace MyStd1::_command;
 
-			switch (getCommand(stream))
+			for (const Instruction& instr : program.code)
 			{
-				case  0: 
+				if (instr.cmd >= COMMAND_COUNT) continue; // Superinstruction, operands are in the next slots
+				if (COMMANDS[instr.cmd].argTypes.empty()) continue;
+				if (COMMANDS[instr.cmd].argTypes[0] != ArgType::NAMETAG) continue;
+
+				if (instr.arg.cmdNum > program.code.size())
 				{
-					if (cpu.curCmd == 0) cpu.curCmd = cpu.cmdArr.size();
-					return new CmdBeg();
+					throw Exception("Jump target is out of the program", "", COMMANDS[instr.cmd].name.word, 0);
 				}
-				case  1: return new CmdEnd();
-				case  2: return new CmdPush (getValue(stream));
-				case  3: return new CmdPushR(getAddress(stream));
-				case  4: return new CmdPop();
-				case  5: return new CmdPopR (getAddress(stream));
-				case  6: return new CmdAdd();                        
-				case  7: return new CmdSub();                        
-				case  8: return new CmdMul();                        
-				case  9: return new CmdDiv();                        
-				case 10: return new CmdSqrt(); 
-				case 11: return new CmdOut();                       
-				case 12: return new CmdIn();                        
-				case 13: return new CmdJmp (getCommandNumber(stream));
-				case 14: return new CmdJe  (getCommandNumber(stream));
-				case 15: return new CmdJne (getCommandNumber(stream));
-				case 16: return new CmdJa  (getCommandNumber(stream));
-				case 17: return new CmdJae (getCommandNumber(stream));
-				case 18: return new CmdJb  (getCommandNumber(stream));
-				case 19: return new CmdJbe (getCommandNumber(stream));
-				case 20: return new CmdCall(getCommandNumber(stream));
-				case 21: return new CmdRet();
-				case 22: return new CmdDump();
-				case 23: return new CmdPrint();
-				case 24: return new CmdIsL();
-				case 25: return new CmdIsLE();
-				case 26: return new CmdIsM();
-				case 27: return new CmdIsME();
-				case 28: return new CmdIsE();
-				case 29: return new CmdIsNE();
-				case 30: return new CmdAnd();
-				case 31: return new CmdOr(); 
-				case 32: return new CmdPushMem(_memory::getMemoryAddress(stream));
-				case 33: return new  CmdPopMem(_memory::getMemoryAddress(stream));                   
-				default: throw Exception("Unknown command number", PROGRAM_POS);
 			}
 		}
 
-	} // namespace _command
+	} // namespace _program
 
-	void execute(const char* filename)
+	namespace _command
 	{
-		FileWork::ReadBinaryFile stream{filename};
+		// Constructs the command in the next slot of the buffer, no heap allocation per command
+		void commandFromInstruction(MyStd1::_command::CommandBuffer& buffer, const _program::Instruction& instr)
+		{
+			using namespace MyStd1::_command;
 
-		MyStd1::_command::CPU cpu{};
+			switch (instr.cmd)
+			{
+				case CMD_BEG:   buffer.emplace<CmdBeg>();                        return;
+				case CMD_END:   buffer.emplace<CmdEnd>();                        return;
+				case CMD_PUSH:  buffer.emplace<CmdPush>   (instr.arg.value);     return;
+				case CMD_PUSHR: buffer.emplace<CmdPushR>  (instr.arg.regAdr);    return;
+				case CMD_POP:   buffer.emplace<CmdPop>();                        return;
+				case CMD_POPR:  buffer.emplace<CmdPopR>   (instr.arg.regAdr);    return;
+				case CMD_ADD:   buffer.emplace<CmdAdd>();                        return;
+				case CMD_SUB:   buffer.emplace<CmdSub>();                        return;
+				case CMD_MUL:   buffer.emplace<CmdMul>();                        return;
+				case CMD_DIV:   buffer.emplace<CmdDiv>();                        return;
+				case CMD_SQRT:  buffer.emplace<CmdSqrt>();                       return;
+				case CMD_OUT:   buffer.emplace<CmdOut>();                        return;
+				case CMD_IN:    buffer.emplace<CmdIn>();                         return;
+				case CMD_JMP:   buffer.emplace<CmdJmp>    (instr.arg.cmdNum);    return;
+				case CMD_JE:    buffer.emplace<CmdJe>     (instr.arg.cmdNum);    return;
+				case CMD_JNE:   buffer.emplace<CmdJne>    (instr.arg.cmdNum);    return;
+				case CMD_JA:    buffer.emplace<CmdJa>     (instr.arg.cmdNum);    return;
+				case CMD_JAE:   buffer.emplace<CmdJae>    (instr.arg.cmdNum);    return;
+				case CMD_JB:    buffer.emplace<CmdJb>     (instr.arg.cmdNum);    return;
+				case CMD_JBE:   buffer.emplace<CmdJbe>    (instr.arg.cmdNum);    return;
+				case CMD_CALL:  buffer.emplace<CmdCall>   (instr.arg.cmdNum);    return;
+				case CMD_RET:   buffer.emplace<CmdRet>();                        return;
+				case CMD_DUMP:  buffer.emplace<CmdDump>();                       return;
+				case CMD_PRINT: buffer.emplace<CmdPrint>();                      return;
+				case CMD_IS_L:  buffer.emplace<CmdIsL>();                        return;
+				case CMD_IS_LE: buffer.emplace<CmdIsLE>();                       return;
+				case CMD_IS_M:  buffer.emplace<CmdIsM>();                        return;
+				case CMD_IS_ME: buffer.emplace<CmdIsME>();                       return;
+				case CMD_IS_E:  buffer.emplace<CmdIsE>();                        return;
+				case CMD_IS_NE: buffer.emplace<CmdIsNE>();                       return;
+				case CMD_AND:   buffer.emplace<CmdAnd>();                        return;
+				case CMD_OR:    buffer.emplace<CmdOr>();                         return;
+				case CMD_PUSHM: buffer.emplace<CmdPushMem>(instr.arg.memAdr);    return;
+				case CMD_POPM:  buffer.emplace<CmdPopMem> (instr.arg.memAdr);    return;
+				case CMD_TAILCALL: buffer.emplace<CmdTailCall>(instr.arg.memAdr); return;
+				case CMD_ALLOCM: buffer.emplace<CmdAllocMem>      (instr.arg.memAdr); return;
+				case CMD_PUSHMI: buffer.emplace<CmdPushMemIndexed>(instr.arg.memAdr); return;
+				case CMD_POPMI:  buffer.emplace<CmdPopMemIndexed> (instr.arg.memAdr); return;
+				case CMD_NEWARR: buffer.emplace<CmdNewArray>      (instr.arg.memAdr); return;
+				case CMD_LOADA:  buffer.emplace<CmdLoadArray>     (instr.arg.memAdr); return;
+				case CMD_STOREA: buffer.emplace<CmdStoreArray>    (instr.arg.memAdr); return;
+				case CMD_REFM:   buffer.emplace<CmdRefMem>        (instr.arg.memAdr); return;
+				case CMD_VADD:   buffer.emplace<CmdVAdd>();                           return;
+				case CMD_VSUB:   buffer.emplace<CmdVSub>();                           return;
+				case CMD_VMUL:   buffer.emplace<CmdVMul>();                           return;
+				case CMD_VDIV:   buffer.emplace<CmdVDiv>();                           return;
+				case CMD_VFMA:   buffer.emplace<CmdVFma>();                           return;
+				case CMD_VDOT:   buffer.emplace<CmdVDot>();                           return;
+				case CMD_VSUM:   buffer.emplace<CmdVSum>();                           return;
+				case CMD_VMIN:   buffer.emplace<CmdVMin>();                           return;
+				case CMD_VMAX:   buffer.emplace<CmdVMax>();                           return;
+				case CMD_SIN:    buffer.emplace<CmdSin>();                            return;
+				case CMD_COS:    buffer.emplace<CmdCos>();                            return;
+				case CMD_EXP:    buffer.emplace<CmdExp>();                            return;
+				case CMD_LOG:    buffer.emplace<CmdLog>();                            return;
+				case CMD_POW:    buffer.emplace<CmdPow>();                            return;
+				case CMD_ABS:    buffer.emplace<CmdAbs>();                            return;
+				case CMD_FLOOR:  buffer.emplace<CmdFloor>();                          return;
+				case CMD_MIN:    buffer.emplace<CmdMin>();                            return;
+				case CMD_MAX:    buffer.emplace<CmdMax>();                            return;
+				default: throw Exception("Unknown command number", PROGRAM_POS);
+			}
+		}
 
-		try
+		void buildCommands(_program::Program& program)
 		{
-			if (_additional::getFromBinaryFile<MyStd1::MagicNum_t>(stream) != MyStd1::MAGIC_NUM)
+			program.commands.reserve(program.code.size());
+
+			for (const _program::Instruction& instr : program.code)
 			{
-				throw Exception("Unknown file format", filename, "-", 0);
+				commandFromInstruction(program.commands, instr);
 			}
+		}
+
+		// Resumed CPUs start where the snapshot was taken, the others at the entry point
+		void start(const _program::Program& program, MyStd1::_command::CPU& cpu,
+		           const _snapshot::Options& snapshots, _snapshot::Identity identity)
+		{
+			cpu.curCmd = program.entry;
 
-			if (_additional::getFromBinaryFile<MyStd1::StdNum_t>(stream) != MyStd1::STD_NUM)
+			if (snapshots.resume != nullptr) _snapshot::restore(snapshots.resume, cpu, identity);
+		}
+
+		// Runs from cpu.curCmd, the schedule is there when snapshots are taken
+		void run(const _program::Program& program, MyStd1::_command::CPU& cpu, _snapshot::Schedule* schedule = nullptr)
+		{
+			const size_t size = program.commands.size();
+
+			if (schedule == nullptr)
 			{
-				throw Exception("Unknown standard", filename, "-", 0);
+				for (; !cpu.halted && cpu.curCmd < size; ++cpu.curCmd) program.commands[cpu.curCmd].execute(cpu);
+				return;
 			}
 
-			while (!stream.finished())
+			size_t budget = schedule->budget();
+			for (; !cpu.halted && cpu.curCmd < size; ++cpu.curCmd)
 			{
-				cpu.cmdArr.push_back(_command::commandFromFile(stream, cpu));
+				if (--budget == 0) budget = schedule->poll(cpu);
+
+				program.commands[cpu.curCmd].execute(cpu);
 			}
 		}
-		catch (Exception& exc)
-		{
-			throw Exception("Unable to read file", filename, "-", 0, exc);
-		}
+
+	} // namespace _command
+
+	// A runtime error points at the source of cpu.curCmd when the file has a debug section,
+	// the section is read here only
+	[[noreturn]] void rethrowRuntimeError(const char* filename, const _program::Program& program,
+	                                      MyStd1::_command::CPU& cpu, const Exception& cause)
+	{
+		cpu.out.flush();
+
+		const MyStd1::_debug::ErrorPosition& at = MyStd1::_debug::locateError(filename, cpu.curCmd, program.code.size());
+		throw Exception(at.message.c_str(), at.file.c_str(), at.function.c_str(), at.line, cause);
+	}
+
+	void execute(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	             MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, MyStd1::_input::Source input = {},
+	             _snapshot::Options snapshots = {}, unsigned sampleRate = 0)
+	{
+		_program::Program program{_program::load(filename)};
+
+		_snapshot::Identity identity{};
+		if (snapshots.any()) identity = _snapshot::identify(program.code.data(), program.code.size());
+
+		_command::buildCommands(program);
+
+		MyStd1::_command::CPU cpu{sizes, format, input};
+		_command::start(program, cpu, snapshots, identity);
+
+		std::unique_ptr<_snapshot::Schedule> schedule;
+		if (snapshots.filename != nullptr) schedule = std::make_unique<_snapshot::Schedule>(snapshots, identity);
 
 		try
 		{
-			for (; cpu.curCmd < cpu.cmdArr.size(); ++cpu.curCmd)
+			_sampler::runSampled(sampleRate, filename, cpu, [&]()
 			{
-				cpu.cmdArr.at(cpu.curCmd)->execute(cpu);
-			}
+				_command::run(program, cpu, schedule.get());
+			});
 		}
 		catch (Exception& exc)
 		{
-			throw Exception("Runtime error", filename, "-", 0, exc);
+			rethrowRuntimeError(filename, program, cpu, exc);
 		}
 	}
 
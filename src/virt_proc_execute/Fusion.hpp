@@ -0,0 +1,141 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_FUSION_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_FUSION_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+
+#include "CPU.hpp"
+
+// Defines:
+
+#define FILENAME "std1/Fusion.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+namespace EmulatedProcessorStd1
+{
+	// Superinstructions: sequences the translator emits all the time run with one dispatch.
+	// The fused command replaces the first command of a sequence only, it takes operands from
+	// the following slots and skips them. Those slots are left as they were, so jumps into
+	// the middle of a sequence still work.
+	namespace _fusion
+	{
+		using namespace MyStd1::_command;
+
+		enum FusedCode : MyStd1::Cmd_t
+		{
+			FUSED_PUSHM_PUSHM_ADD = COMMAND_COUNT, // pushm a / pushm b / add
+			FUSED_PUSHM_PUSHM_SUB,                 // pushm a / pushm b / sub
+			FUSED_PUSHM_PUSHM_MUL,                 // pushm a / pushm b / mul
+			FUSED_IF,                              // push 0 / ja then / jmp else
+			FUSED_WHILE,                           // push 0 / jb end
+			FUSED_NEW_FRAME,                       // pushr SP / push argc / sub / popr BP
+			FUSED_DROP_FRAME                       // loop: pushr SP / pushr BP / jbe end / pop / jmp loop
+		};
+
+		const MyStd1::Cmd_t FUSED_COMMAND_COUNT = FUSED_DROP_FRAME + 1;
+
+		//-----------------------------------------------------------------------------
+
+		using Instruction = _program::Instruction;
+
+		struct Pattern
+		{
+		public:
+			// Variables:
+				MyStd1::Cmd_t fused;
+				std::vector<MyStd1::Cmd_t> cmds;
+				bool (*operandsMatch)(const Instruction* seq, size_t pc); // nullptr if any operands do
+		};
+
+		namespace _operands
+		{
+			bool pushZero(const Instruction* seq, size_t)
+			{
+				return seq[0].arg.value == 0;
+			}
+
+			bool newFrame(const Instruction* seq, size_t)
+			{
+				using namespace MyStd1::_registers;
+
+				return seq[0].arg.regAdr == SP_REGISTER_I &&
+				       seq[3].arg.regAdr == BP_REGISTER_I;
+			}
+
+			bool dropFrameLoop(const Instruction* seq, size_t pc)
+			{
+				using namespace MyStd1::_registers;
+
+				return seq[0].arg.regAdr == SP_REGISTER_I &&
+				       seq[1].arg.regAdr == BP_REGISTER_I &&
+				       seq[4].arg.cmdNum == pc;
+			}
+
+		} // namespace _operands
+
+		// Tried in order at every position, so longer sequences go first.
+		// To add a superinstruction: a code above, a line here and a handler in ThreadedCPU.hpp
+		const Pattern PATTERNS[] =
+		{
+			{FUSED_DROP_FRAME,      {CMD_PUSHR, CMD_PUSHR, CMD_JBE, CMD_POP, CMD_JMP}, _operands::dropFrameLoop},
+			{FUSED_NEW_FRAME,       {CMD_PUSHR, CMD_PUSH,  CMD_SUB, CMD_POPR},         _operands::newFrame},
+			{FUSED_PUSHM_PUSHM_ADD, {CMD_PUSHM, CMD_PUSHM, CMD_ADD},                   nullptr},
+			{FUSED_PUSHM_PUSHM_SUB, {CMD_PUSHM, CMD_PUSHM, CMD_SUB},                   nullptr},
+			{FUSED_PUSHM_PUSHM_MUL, {CMD_PUSHM, CMD_PUSHM, CMD_MUL},                   nullptr},
+			{FUSED_IF,              {CMD_PUSH,  CMD_JA,    CMD_JMP},                   _operands::pushZero},
+			{FUSED_WHILE,           {CMD_PUSH,  CMD_JB},                               _operands::pushZero}
+		};
+
+		//-----------------------------------------------------------------------------
+
+		bool matches(const _program::Code& code, size_t pc, const Pattern& pattern)
+		{
+			if (pc + pattern.cmds.size() > code.size()) return false;
+
+			for (size_t i = 0; i < pattern.cmds.size(); ++i)
+			{
+				if (code[pc + i].cmd != pattern.cmds[i]) return false;
+			}
+
+			return pattern.operandsMatch == nullptr || pattern.operandsMatch(&code[pc], pc);
+		}
+
+		// Fusion only looks at the original commands, so sequences may overlap
+		void fuse(_program::Program& program)
+		{
+			_program::Code& code = program.code;
+
+			std::vector<MyStd1::Cmd_t> fusedCmds(code.size());
+
+			for (size_t pc = 0; pc < code.size(); ++pc)
+			{
+				fusedCmds[pc] = code[pc].cmd;
+
+				for (const Pattern& pattern : PATTERNS)
+				{
+					if (!matches(code, pc, pattern)) continue;
+
+					fusedCmds[pc] = pattern.fused;
+					break;
+				}
+			}
+
+			// A mapped programme gets private copies of the pages written here only
+			for (size_t pc = 0; pc < code.size(); ++pc)
+			{
+				if (code[pc].cmd != fusedCmds[pc]) code[pc].cmd = fusedCmds[pc];
+			}
+		}
+
+	} // namespace _fusion
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_FUSION_HPP_INCLUDED*/
@@ -0,0 +1,1245 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_JIT_CPU_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_JIT_CPU_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <limits>
+#include <cmath>
+
+#include "CPU.hpp"
+#include "ThreadedCPU.hpp"
+
+// Native code generation is only done for x86-64 unix-likes and double values, everything else runs threaded
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && !defined(VALUE_TYPE_I64)
+	#define JIT_CPU_X86_64
+	#include <sys/mman.h>
+#endif
+
+// Defines:
+
+#define FILENAME "std1/JitCPU.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+#ifdef JIT_CPU_X86_64
+
+	namespace _jit
+	{
+		using MyStd1::Val_t;
+
+		const MyStd1::MemAdr_t MAX_TAILCALL_ARGS = 64; // TAILCALL moves are unrolled up to that
+
+		// Machine state the native code works on:
+		struct JitState
+		{
+		public:
+			// Variables:
+				Val_t*    valBase;
+				Val_t*    valTop;
+				Val_t*    valLimit;
+				uint32_t* callBase;
+				uint32_t* callTop;
+				uint32_t* callLimit;
+				const void* const* nativeAddr; // Native address of every command, the last one stops
+				const MyStd1::_arrays::View* arrays; // Table of the array heap, NEWARR may move it
+				uint64_t  arrayCount;
+				Val_t     regs[MyStd1::_registers::REGISTER_COUNT];
+				uint32_t  pc;
+				uint32_t  error;
+		};
+
+		enum ExitCode : uint32_t
+		{
+			EXIT_HALT,      // Ran past the last command
+			EXIT_END,       // END reached
+			EXIT_INTERPRET, // Interpreter goes on at pc: the command is not compiled or a trace left its path
+			EXIT_ERROR      // Runtime check failed at pc
+		};
+
+		enum ErrorCode : uint32_t
+		{
+			ERR_VAL_ST_EMPTY,
+			ERR_VAL_ST_FULL,
+			ERR_INVALID_REG,
+			ERR_DIV_BY_ZERO,
+			ERR_ACCESS_OUT,
+			ERR_CALL_OVERFLOW,
+			ERR_RET_EMPTY,
+			ERR_INDEX_OUT,
+			ERR_NOT_ARRAY,
+			ERR_SQRT_DOMAIN,
+			ERR_LOG_DOMAIN,
+			ERR_POW_DOMAIN
+		};
+
+		// Built-in functions the native code calls, the interpreters compute the same
+		namespace _math
+		{
+			Val_t sin  (Val_t x) { return std::sin(x);   }
+			Val_t cos  (Val_t x) { return std::cos(x);   }
+			Val_t exp  (Val_t x) { return std::exp(x);   }
+			Val_t log  (Val_t x) { return std::log(x);   }
+			Val_t floor(Val_t x) { return std::floor(x); }
+
+			Val_t pow(Val_t x, Val_t y) { return std::pow(x, y);  }
+			Val_t min(Val_t x, Val_t y) { return std::fmin(x, y); }
+			Val_t max(Val_t x, Val_t y) { return std::fmax(x, y); }
+		}
+
+		static_assert(sizeof(MyStd1::_arrays::View) == 16, "Views are indexed with a shift by 4");
+
+		//-----------------------------------------------------------------------------
+
+		// Just enough of x86-64 encoding for the commands of the standard
+		class Emitter
+		{
+		public:
+			// Registers:
+				enum Reg : int
+				{
+					RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+					R8  = 8, R9  = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+				};
+
+			// Condition codes:
+				enum Cond : uint8_t
+				{
+					CC_B  = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5,
+					CC_BE = 0x6, CC_A  = 0x7, CC_P = 0xA, CC_NP = 0xB
+				};
+
+			// Variables:
+				std::vector<unsigned char> bytes;
+
+			// Raw output:
+				size_t size() const { return bytes.size(); }
+
+				void byte(uint8_t b) { bytes.push_back(b); }
+
+				void dword(uint32_t d)
+				{
+					for (size_t i = 0; i < 4; ++i) byte(static_cast<uint8_t>(d >> (8 * i)));
+				}
+
+				void qword(uint64_t q)
+				{
+					for (size_t i = 0; i < 8; ++i) byte(static_cast<uint8_t>(q >> (8 * i)));
+				}
+
+				void patchRel32(size_t at, size_t target)
+				{
+					int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+
+					std::memcpy(bytes.data() + at, &rel, sizeof(rel));
+				}
+
+			// Encoding helpers:
+				void rex(bool w, int reg, int index, int base)
+				{
+					uint8_t prefix = 0x40 | (w << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+
+					if (prefix != 0x40) byte(prefix);
+				}
+
+				void modrmReg(int reg, int rm)
+				{
+					byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+				}
+
+				// [base + disp32]
+				void modrmMem(int reg, int base, int32_t disp)
+				{
+					byte(0x80 | ((reg & 7) << 3) | (base & 7));
+					if ((base & 7) == RSP) byte(0x24);
+
+					dword(static_cast<uint32_t>(disp));
+				}
+
+				// [base + index * 8 + disp32]
+				void modrmMemIndex(int reg, int base, int index, int32_t disp)
+				{
+					byte(0x80 | ((reg & 7) << 3) | 4);
+					byte(0xC0 | ((index & 7) << 3) | (base & 7));
+
+					dword(static_cast<uint32_t>(disp));
+				}
+
+			// General purpose instructions:
+				void push(int r) { rex(false, 0, 0, r); byte(0x50 | (r & 7)); }
+				void pop (int r) { rex(false, 0, 0, r); byte(0x58 | (r & 7)); }
+				void ret()       { byte(0xC3); }
+
+				void movRegReg(int dst, int src)                { rex(true, src, 0, dst); byte(0x89); modrmReg(src, dst); }
+				void movRegMem(int dst, int base, int32_t disp) { rex(true, dst, 0, base); byte(0x8B); modrmMem(dst, base, disp); }
+				void movMemReg(int base, int32_t disp, int src) { rex(true, src, 0, base); byte(0x89); modrmMem(src, base, disp); }
+				void movRegImm64(int dst, uint64_t imm)         { rex(true, 0, 0, dst); byte(0xB8 | (dst & 7)); qword(imm); }
+
+				void mov32RegImm(int dst, uint32_t imm)                 { rex(false, 0, 0, dst); byte(0xB8 | (dst & 7)); dword(imm); }
+				void mov32RegMem(int dst, int base, int32_t disp)       { rex(false, dst, 0, base); byte(0x8B); modrmMem(dst, base, disp); }
+				void mov32MemImm(int base, int32_t disp, uint32_t imm)  { rex(false, 0, 0, base); byte(0xC7); modrmMem(0, base, disp); dword(imm); }
+
+				void leaRegMem(int dst, int base, int32_t disp) { rex(true, dst, 0, base); byte(0x8D); modrmMem(dst, base, disp); }
+
+				// Flags of a - b
+				void cmpRegReg(int a, int b)                    { rex(true, b, 0, a); byte(0x39); modrmReg(b, a); }
+				void cmpRegMem(int a, int base, int32_t disp)   { rex(true, a, 0, base); byte(0x3B); modrmMem(a, base, disp); }
+
+				void addRegImm(int r, int32_t imm)   { rex(true, 0, 0, r); byte(0x81); modrmReg(0, r); dword(static_cast<uint32_t>(imm)); }
+				void subRegImm(int r, int32_t imm)   { rex(true, 0, 0, r); byte(0x81); modrmReg(5, r); dword(static_cast<uint32_t>(imm)); }
+				void addRegReg(int dst, int src)     { rex(true, src, 0, dst); byte(0x01); modrmReg(src, dst); }
+				void subRegReg(int dst, int src)     { rex(true, src, 0, dst); byte(0x29); modrmReg(src, dst); }
+				void shrRegImm(int r, uint8_t imm)   { rex(true, 0, 0, r); byte(0xC1); modrmReg(5, r); byte(imm); }
+				void shlRegImm(int r, uint8_t imm)   { rex(true, 0, 0, r); byte(0xC1); modrmReg(4, r); byte(imm); }
+
+				void add32RegReg(int dst, int src)   { rex(false, src, 0, dst); byte(0x01); modrmReg(src, dst); }
+				void sub32RegImm(int r, int8_t imm)  { rex(false, 0, 0, r); byte(0x83); modrmReg(5, r); byte(static_cast<uint8_t>(imm)); }
+
+				void movzx32Reg8 (int dst, int src)  { byte(0x0F); byte(0xB6); modrmReg(dst, src); } // al, cl, dl, bl only
+
+				void setcc(Cond cc, int r8)          { byte(0x0F); byte(0x90 | cc); modrmReg(0, r8); } // al, cl, dl, bl only
+				void and8RegReg(int dst, int src)    { byte(0x20); modrmReg(src, dst); }
+				void or8RegReg (int dst, int src)    { byte(0x08); modrmReg(src, dst); }
+
+				// Return position of the rel32 to patch
+				size_t jmpRel32()        { byte(0xE9); size_t at = size(); dword(0); return at; }
+				size_t jccRel32(Cond cc) { byte(0x0F); byte(0x80 | cc); size_t at = size(); dword(0); return at; }
+
+				void jmpReg(int r)                                { rex(false, 0, 0, r); byte(0xFF); modrmReg(4, r); }
+				void callReg(int r)                               { rex(false, 0, 0, r); byte(0xFF); modrmReg(2, r); }
+				void jmpMemIndex(int base, int index, int32_t disp) { rex(false, 0, index, base); byte(0xFF); modrmMemIndex(4, base, index, disp); }
+
+			// SSE2 instructions (xmm0-xmm7 only):
+				void movsdXmmMem(int x, int base, int32_t disp)                { byte(0xF2); rex(false, x, 0, base); byte(0x0F); byte(0x10); modrmMem(x, base, disp); }
+				void movsdMemXmm(int base, int32_t disp, int x)                { byte(0xF2); rex(false, x, 0, base); byte(0x0F); byte(0x11); modrmMem(x, base, disp); }
+				void movsdXmmMemIndex(int x, int base, int index, int32_t disp) { byte(0xF2); rex(false, x, index, base); byte(0x0F); byte(0x10); modrmMemIndex(x, base, index, disp); }
+				void movsdMemIndexXmm(int base, int index, int32_t disp, int x) { byte(0xF2); rex(false, x, index, base); byte(0x0F); byte(0x11); modrmMemIndex(x, base, index, disp); }
+
+				void sse(uint8_t prefix, uint8_t op, int dst, int src) { byte(prefix); byte(0x0F); byte(op); modrmReg(dst, src); }
+
+				void movsdXmmXmm(int dst, int src) { sse(0xF2, 0x10, dst, src); }
+				void addsd  (int dst, int src)     { sse(0xF2, 0x58, dst, src); }
+				void subsd  (int dst, int src)     { sse(0xF2, 0x5C, dst, src); }
+				void mulsd  (int dst, int src)     { sse(0xF2, 0x59, dst, src); }
+				void divsd  (int dst, int src)     { sse(0xF2, 0x5E, dst, src); }
+				void sqrtsd (int dst, int src)     { sse(0xF2, 0x51, dst, src); }
+				void andpd  (int dst, int src)     { sse(0x66, 0x54, dst, src); }
+				void xorpd  (int dst, int src)     { sse(0x66, 0x57, dst, src); }
+				void ucomisd(int a,   int b)       { sse(0x66, 0x2E, a,   b);   } // Flags of a compared to b
+
+				void cvtsi2sd64(int x, int r)   { byte(0xF2); rex(true,  x, 0, r); byte(0x0F); byte(0x2A); modrmReg(x, r); }
+				void cvtsi2sd32(int x, int r)   { byte(0xF2); rex(false, x, 0, r); byte(0x0F); byte(0x2A); modrmReg(x, r); }
+				void cvttsd2si32(int r, int x)  { byte(0xF2); rex(false, r, 0, x); byte(0x0F); byte(0x2C); modrmReg(r, x); }
+				void movqXmmReg(int x, int r)   { byte(0x66); rex(true,  x, 0, r); byte(0x0F); byte(0x6E); modrmReg(x, r); }
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// Executable memory: written while mapped RW, then switched to RX
+		class ExecutableBuffer
+		{
+		public:
+			// Ctors && dtor:
+				explicit ExecutableBuffer(const std::vector<unsigned char>& code) :
+					memory_ (nullptr),
+					size_   (code.size())
+				{
+					memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+					if (memory_ == MAP_FAILED)
+					{
+						memory_ = nullptr;
+						throw Exception("Unable to map memory for native code", PROGRAM_POS);
+					}
+
+					std::memcpy(memory_, code.data(), size_);
+
+					if (mprotect(memory_, size_, PROT_READ | PROT_EXEC) != 0)
+					{
+						munmap(memory_, size_);
+						memory_ = nullptr;
+						throw Exception("Unable to make native code executable", PROGRAM_POS);
+					}
+				}
+
+				ExecutableBuffer(const ExecutableBuffer& that) = delete;
+				ExecutableBuffer& operator=(const ExecutableBuffer& that) = delete;
+
+				~ExecutableBuffer()
+				{
+					if (memory_ != nullptr) munmap(memory_, size_);
+				}
+
+			// Functions:
+				const unsigned char* data() const
+				{
+					return static_cast<const unsigned char*>(memory_);
+				}
+
+		private:
+			// Variables:
+				void*  memory_;
+				size_t size_;
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// Native code of single commands on JitState. The compilers add the control flow: the whole programme
+		// one (Compiler) and the one of the hot loops (see TraceJitCPU.hpp).
+		class CodeGen
+		{
+		protected:
+			// Types:
+				using E = Emitter;
+
+				struct ErrorFixup { size_t at; uint32_t pc; uint32_t error; };
+
+			// Register roles:
+				static const int STATE     = E::RBX;
+				static const int VAL_BASE  = E::R12;
+				static const int VAL_TOP   = E::R13;
+				static const int VAL_LIMIT = E::R14;
+				static const int CALL_TOP  = E::R15;
+
+			// Ctor:
+				explicit CodeGen(const _program::Program& program) :
+					program_        (program),
+					e_              (),
+					errorFixups_    (),
+					epilogueFixups_ (),
+					epilogue_       (0)
+				{}
+
+			// Variables:
+				const _program::Program& program_;
+				Emitter e_;
+				std::vector<ErrorFixup> errorFixups_;
+				std::vector<size_t>     epilogueFixups_;
+				size_t epilogue_;
+
+			// Layout of JitState:
+				static int32_t regOff(size_t reg)
+				{
+					return static_cast<int32_t>(offsetof(JitState, regs) + reg * sizeof(Val_t));
+				}
+
+			// Entry and exit:
+				// uint32_t entry(JitState* state, const void* nativeAddr)
+				void emitPrologue()
+				{
+					e_.push(E::RBP);
+					e_.push(E::RBX);
+					e_.push(E::R12);
+					e_.push(E::R13);
+					e_.push(E::R14);
+					e_.push(E::R15);
+
+					e_.movRegReg(STATE, E::RDI);
+					e_.movRegMem(VAL_BASE,  STATE, offsetof(JitState, valBase));
+					e_.movRegMem(VAL_TOP,   STATE, offsetof(JitState, valTop));
+					e_.movRegMem(VAL_LIMIT, STATE, offsetof(JitState, valLimit));
+					e_.movRegMem(CALL_TOP,  STATE, offsetof(JitState, callTop));
+
+					e_.jmpReg(E::RSI);
+				}
+
+				// Exit code is in eax
+				void emitEpilogue()
+				{
+					e_.movMemReg(STATE, offsetof(JitState, valTop),  VAL_TOP);
+					e_.movMemReg(STATE, offsetof(JitState, callTop), CALL_TOP);
+
+					e_.pop(E::R15);
+					e_.pop(E::R14);
+					e_.pop(E::R13);
+					e_.pop(E::R12);
+					e_.pop(E::RBX);
+					e_.pop(E::RBP);
+					e_.ret();
+				}
+
+				void emitExit(ExitCode exitCode, size_t pc, uint32_t error = 0)
+				{
+					e_.mov32MemImm(STATE, offsetof(JitState, pc),    static_cast<uint32_t>(pc));
+					e_.mov32MemImm(STATE, offsetof(JitState, error), error);
+					e_.mov32RegImm(E::RAX, exitCode);
+					e_.patchRel32(e_.jmpRel32(), epilogue_);
+				}
+
+				// Goes after the epilogue
+				void emitErrorExits()
+				{
+					for (size_t at : epilogueFixups_) e_.patchRel32(at, epilogue_);
+
+					for (const auto& fixup : errorFixups_)
+					{
+						e_.patchRel32(fixup.at, e_.size());
+						emitExit(EXIT_ERROR, fixup.pc, fixup.error);
+					}
+				}
+
+			// Checks:
+				void errorIf(E::Cond cc, size_t pc, ErrorCode error)
+				{
+					errorFixups_.push_back({e_.jccRel32(cc), static_cast<uint32_t>(pc), error});
+				}
+
+				void errorAlways(size_t pc, ErrorCode error)
+				{
+					errorFixups_.push_back({e_.jmpRel32(), static_cast<uint32_t>(pc), error});
+				}
+
+				// Value stack holds at least count values
+				void checkFilled(size_t pc, int32_t count)
+				{
+					e_.leaRegMem(E::RAX, VAL_BASE, count * static_cast<int32_t>(sizeof(Val_t)));
+					e_.cmpRegReg(VAL_TOP, E::RAX);
+					errorIf(E::CC_B, pc, ERR_VAL_ST_EMPTY);
+				}
+
+				void checkNotFull(size_t pc)
+				{
+					e_.cmpRegReg(VAL_TOP, VAL_LIMIT);
+					errorIf(E::CC_AE, pc, ERR_VAL_ST_FULL);
+				}
+
+			// Value stack:
+				void pushXmm(int x)
+				{
+					e_.movsdMemXmm(VAL_TOP, 0, x);
+					e_.addRegImm(VAL_TOP, sizeof(Val_t));
+				}
+
+				void popXmm(int x)
+				{
+					e_.subRegImm(VAL_TOP, sizeof(Val_t));
+					e_.movsdXmmMem(x, VAL_TOP, 0);
+				}
+
+				// r = filled size of the value stack
+				void filledSize(int r)
+				{
+					e_.movRegReg(r, VAL_TOP);
+					e_.subRegReg(r, VAL_BASE);
+					e_.shrRegImm(r, 3);
+				}
+
+				void loadConst(int x, Val_t value)
+				{
+					uint64_t bits = 0;
+					std::memcpy(&bits, &value, sizeof(bits));
+
+					e_.movRegImm64(E::RAX, bits);
+					e_.movqXmmReg(x, E::RAX);
+				}
+
+				void absXmm(int x, int tmp)
+				{
+					e_.movRegImm64(E::RAX, 0x7FFFFFFFFFFFFFFFull);
+					e_.movqXmmReg(tmp, E::RAX);
+					e_.andpd(x, tmp);
+				}
+
+				// xmm0 = function(xmm0, xmm1). The registers of the roles are callee-saved and
+				// the pushes of the prologue leave RSP 8 bytes off the alignment of a call.
+				void callMath(const void* function)
+				{
+					e_.movRegImm64(E::RAX, reinterpret_cast<uint64_t>(function));
+					e_.subRegImm(E::RSP, 8);
+					e_.callReg(E::RAX);
+					e_.addRegImm(E::RSP, 8);
+				}
+
+				// Top of the stack = function(top)
+				void emitUnaryMath(size_t pc, Val_t (*function)(Val_t))
+				{
+					checkFilled(pc, 1);
+					e_.movsdXmmMem(0, VAL_TOP, -8);
+					callMath(reinterpret_cast<const void*>(function));
+					e_.movsdMemXmm(VAL_TOP, -8, 0);
+				}
+
+				// xmm1 = r, xmm0 = l, both popped
+				void popTwo(size_t pc)
+				{
+					checkFilled(pc, 2);
+					e_.movsdXmmMem(1, VAL_TOP, -8);
+					e_.movsdXmmMem(0, VAL_TOP, -16);
+					e_.subRegImm(VAL_TOP, 2 * sizeof(Val_t));
+				}
+
+				// Pushes (al != 0)? 1 : -1
+				void pushBool()
+				{
+					e_.movzx32Reg8(E::RAX, E::RAX);
+					e_.add32RegReg(E::RAX, E::RAX);
+					e_.sub32RegImm(E::RAX, 1);
+					e_.cvtsi2sd32(0, E::RAX);
+					pushXmm(0);
+				}
+
+				// rax = BP + memAdr
+				void frameAddress(MyStd1::MemAdr_t memAdr)
+				{
+					e_.movsdXmmMem(3, STATE, regOff(MyStd1::_registers::BP_REGISTER_I));
+					e_.cvttsd2si32(E::RAX, 3); // Upper half is cleared, just like MemAdr_t bp = regs[BP]
+					e_.mov32RegImm(E::RCX, memAdr);
+					e_.addRegReg(E::RAX, E::RCX);
+				}
+
+			// Arrays:
+				// The constants of checkIndex, loadConst clobbers rax so they go first
+				void loadIndexLimits()
+				{
+					loadConst(2, -1);
+					loadConst(4, static_cast<Val_t>(MyStd1::_arrays::MAX_ARRAY_SIZE));
+				}
+
+				// rdx = index in xmm0 for the length in xmm1, as _arrays::toIndex
+				void checkIndex(size_t pc)
+				{
+					e_.ucomisd(1, 0);
+					errorIf(E::CC_BE, pc, ERR_INDEX_OUT); // Unordered too
+					e_.ucomisd(0, 2);
+					errorIf(E::CC_BE, pc, ERR_INDEX_OUT);
+					e_.ucomisd(4, 0);
+					errorIf(E::CC_BE, pc, ERR_INDEX_OUT);
+
+					e_.cvttsd2si32(E::RDX, 0);
+				}
+
+				// rcx = elements and xmm1 = length of the array, its handle is in the slot memAdr
+				void findArray(size_t pc, MyStd1::MemAdr_t memAdr)
+				{
+					frameAddress(memAdr);
+					filledSize(E::RCX);
+					e_.cmpRegReg(E::RAX, E::RCX);
+					errorIf(E::CC_AE, pc, ERR_ACCESS_OUT);
+
+					// Handles are from 1, too big ones and NaN become 0x80000000
+					e_.movsdXmmMemIndex(1, VAL_BASE, E::RAX, 0);
+					e_.cvttsd2si32(E::RAX, 1);
+					e_.subRegImm(E::RAX, 1);
+					e_.cmpRegMem(E::RAX, STATE, offsetof(JitState, arrayCount));
+					errorIf(E::CC_AE, pc, ERR_NOT_ARRAY);
+
+					e_.shlRegImm(E::RAX, 4);
+					e_.movRegMem(E::RCX, STATE, offsetof(JitState, arrays));
+					e_.addRegReg(E::RAX, E::RCX);
+					e_.movRegMem(E::RCX, E::RAX, offsetof(MyStd1::_arrays::View, data));
+					e_.movRegMem(E::RDX, E::RAX, offsetof(MyStd1::_arrays::View, size));
+					e_.cvtsi2sd64(1, E::RDX);
+				}
+
+				// rax = address and xmm1 = length of the frame array at the slot memAdr,
+				// rcx = the end of the slots it may use: the stack without its operands
+				void findFrameArray(size_t pc, MyStd1::MemAdr_t memAdr, int32_t operands)
+				{
+					frameAddress(memAdr);
+					filledSize(E::RCX);
+					if (operands != 0) e_.subRegImm(E::RCX, operands);
+					e_.cmpRegReg(E::RAX, E::RCX);
+					errorIf(E::CC_AE, pc, ERR_ACCESS_OUT);
+
+					e_.movsdXmmMemIndex(1, VAL_BASE, E::RAX, 0);
+				}
+
+				// rdx = address of the element rdx of the frame array at rax, below rcx
+				void frameElement(size_t pc)
+				{
+					e_.addRegReg(E::RDX, E::RAX);
+					e_.addRegImm(E::RDX, 1);
+					e_.cmpRegReg(E::RDX, E::RCX);
+					errorIf(E::CC_AE, pc, ERR_ACCESS_OUT);
+				}
+
+			// Commands:
+				// Pops the operands of the conditional jump at pc, the jump is taken on the returned condition
+				E::Cond emitJumpCondition(size_t pc)
+				{
+					using namespace MyStd1::_command;
+
+					popTwo(pc);
+
+					switch (program_.code[pc].cmd)
+					{
+						case CMD_JE:
+						case CMD_JNE:
+						{
+							// |l - r| compared to 5 * |l + r| * epsilon
+							e_.movsdXmmXmm(2, 0);
+							e_.addsd(2, 1);
+							absXmm(2, 3);
+							loadConst(3, 5);
+							e_.mulsd(2, 3);
+							loadConst(3, std::numeric_limits<Val_t>::epsilon());
+							e_.mulsd(2, 3);
+							e_.subsd(0, 1);
+							absXmm(0, 3);
+
+							// JNE is the inverse of JE, so NaNs take it as in the interpreters (unordered sets CF)
+							e_.ucomisd(2, 0);
+							return (program_.code[pc].cmd == CMD_JE)? E::CC_AE : E::CC_B;
+						}
+
+						case CMD_JA:  e_.ucomisd(0, 1); return E::CC_A;
+						case CMD_JAE: e_.ucomisd(0, 1); return E::CC_AE;
+						case CMD_JB:  e_.ucomisd(1, 0); return E::CC_A;
+						case CMD_JBE: e_.ucomisd(1, 0); return E::CC_AE;
+
+						default: throw Exception("Not a conditional jump", PROGRAM_POS);
+					}
+				}
+
+				// Commands that go on to the next one, false for the jumps, calls and the ones left to the interpreter
+				bool emitOperation(size_t pc)
+				{
+					using namespace MyStd1::_command;
+					using MyStd1::_registers::REGISTER_COUNT;
+					using MyStd1::_registers::SP_REGISTER_I;
+
+					const _program::Instruction& instr = program_.code[pc];
+					const Val_t divLimit = std::numeric_limits<Val_t>::epsilon() * 5;
+
+					switch (instr.cmd)
+					{
+						case CMD_BEG: return true;
+
+						case CMD_PUSH:
+						{
+							checkNotFull(pc);
+							uint64_t bits = 0;
+							std::memcpy(&bits, &instr.arg.value, sizeof(bits));
+							e_.movRegImm64(E::RAX, bits);
+							e_.movMemReg(VAL_TOP, 0, E::RAX);
+							e_.addRegImm(VAL_TOP, sizeof(Val_t));
+							return true;
+						}
+
+						case CMD_PUSHR:
+						{
+							checkNotFull(pc);
+							if (instr.arg.regAdr >= REGISTER_COUNT) { errorAlways(pc, ERR_INVALID_REG); return true; }
+
+							if (instr.arg.regAdr == SP_REGISTER_I)
+							{
+								filledSize(E::RAX);
+								e_.cvtsi2sd64(0, E::RAX);
+							}
+							else e_.movsdXmmMem(0, STATE, regOff(instr.arg.regAdr));
+
+							pushXmm(0);
+							return true;
+						}
+
+						case CMD_POP:
+						{
+							checkFilled(pc, 1);
+							e_.subRegImm(VAL_TOP, sizeof(Val_t));
+							return true;
+						}
+
+						case CMD_POPR:
+						{
+							checkFilled(pc, 1);
+							if (instr.arg.regAdr >= REGISTER_COUNT) { errorAlways(pc, ERR_INVALID_REG); return true; }
+
+							popXmm(0);
+							e_.movsdMemXmm(STATE, regOff(instr.arg.regAdr), 0);
+							return true;
+						}
+
+						case CMD_ADD: popTwo(pc); e_.addsd(0, 1); pushXmm(0); return true;
+						case CMD_SUB: popTwo(pc); e_.subsd(0, 1); pushXmm(0); return true;
+						case CMD_MUL: popTwo(pc); e_.mulsd(0, 1); pushXmm(0); return true;
+
+						case CMD_DIV:
+						{
+							// Divisor is checked before the dividend is popped
+							checkFilled(pc, 1);
+							e_.movsdXmmMem(1, VAL_TOP, -8);
+							e_.movsdXmmXmm(2, 1);
+							absXmm(2, 3);
+							loadConst(3, divLimit);
+							e_.ucomisd(3, 2);
+							errorIf(E::CC_AE, pc, ERR_DIV_BY_ZERO);
+
+							checkFilled(pc, 2);
+							e_.movsdXmmMem(0, VAL_TOP, -16);
+							e_.subRegImm(VAL_TOP, 2 * sizeof(Val_t));
+							e_.divsd(0, 1);
+							pushXmm(0);
+							return true;
+						}
+
+						case CMD_SQRT:
+						{
+							// NaN passes as in the interpreters
+							checkFilled(pc, 1);
+							e_.movsdXmmMem(0, VAL_TOP, -8);
+							e_.xorpd(1, 1);
+							e_.ucomisd(1, 0);
+							errorIf(E::CC_A, pc, ERR_SQRT_DOMAIN);
+
+							e_.sqrtsd(0, 0);
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_SIN:   emitUnaryMath(pc, _math::sin);   return true;
+						case CMD_COS:   emitUnaryMath(pc, _math::cos);   return true;
+						case CMD_EXP:   emitUnaryMath(pc, _math::exp);   return true;
+						case CMD_FLOOR: emitUnaryMath(pc, _math::floor); return true;
+
+						case CMD_ABS:
+						{
+							checkFilled(pc, 1);
+							e_.movsdXmmMem(0, VAL_TOP, -8);
+							absXmm(0, 1);
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_LOG:
+						{
+							// Not above 0 or NaN
+							checkFilled(pc, 1);
+							e_.movsdXmmMem(0, VAL_TOP, -8);
+							e_.xorpd(1, 1);
+							e_.ucomisd(0, 1);
+							errorIf(E::CC_BE, pc, ERR_LOG_DOMAIN);
+
+							callMath(reinterpret_cast<const void*>(_math::log));
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_POW:
+						{
+							// Operands stay on the stack until the power is known to be a number
+							checkFilled(pc, 2);
+							e_.movsdXmmMem(0, VAL_TOP, -16);
+							e_.movsdXmmMem(1, VAL_TOP, -8);
+							callMath(reinterpret_cast<const void*>(_math::pow));
+							e_.ucomisd(0, 0);
+							errorIf(E::CC_P, pc, ERR_POW_DOMAIN);
+
+							e_.subRegImm(VAL_TOP, sizeof(Val_t));
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_MIN: popTwo(pc); callMath(reinterpret_cast<const void*>(_math::min)); pushXmm(0); return true;
+						case CMD_MAX: popTwo(pc); callMath(reinterpret_cast<const void*>(_math::max)); pushXmm(0); return true;
+
+						case CMD_IS_L:  popTwo(pc); e_.ucomisd(1, 0); e_.setcc(E::CC_A,  E::RAX); pushBool(); return true;
+						case CMD_IS_LE: popTwo(pc); e_.ucomisd(1, 0); e_.setcc(E::CC_AE, E::RAX); pushBool(); return true;
+						case CMD_IS_M:  popTwo(pc); e_.ucomisd(0, 1); e_.setcc(E::CC_A,  E::RAX); pushBool(); return true;
+						case CMD_IS_ME: popTwo(pc); e_.ucomisd(0, 1); e_.setcc(E::CC_AE, E::RAX); pushBool(); return true;
+
+						case CMD_IS_E:
+						case CMD_IS_NE:
+						{
+							popTwo(pc);
+							e_.ucomisd(0, 1);
+
+							// Unordered operands are never equal
+							if (instr.cmd == CMD_IS_E)
+							{
+								e_.setcc(E::CC_E,  E::RAX);
+								e_.setcc(E::CC_NP, E::RCX);
+								e_.and8RegReg(E::RAX, E::RCX);
+							}
+							else
+							{
+								e_.setcc(E::CC_NE, E::RAX);
+								e_.setcc(E::CC_P,  E::RCX);
+								e_.or8RegReg(E::RAX, E::RCX);
+							}
+
+							pushBool();
+							return true;
+						}
+
+						case CMD_AND:
+						case CMD_OR:
+						{
+							popTwo(pc);
+							e_.xorpd(2, 2);
+							e_.ucomisd(0, 2);
+							e_.setcc(E::CC_A, E::RAX);
+							e_.ucomisd(1, 2);
+							e_.setcc(E::CC_A, E::RCX);
+
+							if (instr.cmd == CMD_AND) e_.and8RegReg(E::RAX, E::RCX);
+							else                      e_.or8RegReg (E::RAX, E::RCX);
+
+							pushBool();
+							return true;
+						}
+
+						case CMD_PUSHM:
+						{
+							checkNotFull(pc);
+							frameAddress(instr.arg.memAdr);
+							filledSize(E::RCX);
+							e_.cmpRegReg(E::RAX, E::RCX);
+							errorIf(E::CC_AE, pc, ERR_ACCESS_OUT);
+
+							e_.movsdXmmMemIndex(0, VAL_BASE, E::RAX, 0);
+							pushXmm(0);
+							return true;
+						}
+
+						case CMD_POPM:
+						{
+							checkFilled(pc, 1);
+							frameAddress(instr.arg.memAdr);
+							filledSize(E::RCX);
+							e_.cmpRegReg(E::RAX, E::RCX);
+							errorIf(E::CC_AE, pc, ERR_ACCESS_OUT);
+
+							// Storing to the top of the stack leaves the value where it is
+							e_.subRegImm(E::RCX, 1);
+							e_.cmpRegReg(E::RAX, E::RCX);
+							size_t skip = e_.jccRel32(E::CC_AE);
+
+							popXmm(0);
+							e_.movsdMemIndexXmm(VAL_BASE, E::RAX, 0, 0);
+
+							e_.patchRel32(skip, e_.size());
+							return true;
+						}
+
+						case CMD_TAILCALL:
+						{
+							if (instr.arg.memAdr > MAX_TAILCALL_ARGS) return false;
+
+							// rax = BP + argCount, the arguments go right under it
+							const int32_t argCount = static_cast<int32_t>(instr.arg.memAdr);
+
+							frameAddress(instr.arg.memAdr);
+							filledSize(E::RCX);
+							e_.cmpRegReg(E::RAX, E::RCX);
+							errorIf(E::CC_A, pc, ERR_ACCESS_OUT);
+
+							for (int32_t i = argCount; i > 0; --i)
+							{
+								e_.movsdXmmMem(0, VAL_TOP, -i * static_cast<int32_t>(sizeof(Val_t)));
+								e_.movsdMemIndexXmm(VAL_BASE, E::RAX, -i * static_cast<int32_t>(sizeof(Val_t)), 0);
+							}
+
+							e_.movRegReg(VAL_TOP, E::RAX);
+							e_.shlRegImm(VAL_TOP, 3);
+							e_.addRegReg(VAL_TOP, VAL_BASE);
+							return true;
+						}
+
+						// ALLOCM and NEWARR are left to the interpreter, they run once per array
+
+						case CMD_PUSHMI:
+						{
+							checkFilled(pc, 1);
+							loadIndexLimits();
+
+							findFrameArray(pc, instr.arg.memAdr, 1);
+
+							e_.movsdXmmMem(0, VAL_TOP, -8);
+							checkIndex(pc);
+							frameElement(pc);
+
+							e_.movsdXmmMemIndex(0, VAL_BASE, E::RDX, 0);
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_POPMI:
+						{
+							checkFilled(pc, 2);
+							loadIndexLimits();
+
+							e_.movsdXmmMem(5, VAL_TOP, -8);
+							e_.movsdXmmMem(0, VAL_TOP, -16);
+							e_.subRegImm(VAL_TOP, 2 * sizeof(Val_t));
+
+							findFrameArray(pc, instr.arg.memAdr, 0);
+							checkIndex(pc);
+							frameElement(pc);
+
+							e_.movsdMemIndexXmm(VAL_BASE, E::RDX, 0, 5);
+							return true;
+						}
+
+						case CMD_LOADA:
+						{
+							checkFilled(pc, 1);
+							loadIndexLimits();
+							findArray(pc, instr.arg.memAdr);
+
+							e_.movsdXmmMem(0, VAL_TOP, -8);
+							checkIndex(pc);
+
+							e_.movsdXmmMemIndex(0, E::RCX, E::RDX, 0);
+							e_.movsdMemXmm(VAL_TOP, -8, 0);
+							return true;
+						}
+
+						case CMD_STOREA:
+						{
+							checkFilled(pc, 2);
+							loadIndexLimits();
+
+							e_.movsdXmmMem(5, VAL_TOP, -8);
+							e_.movsdXmmMem(0, VAL_TOP, -16);
+							e_.subRegImm(VAL_TOP, 2 * sizeof(Val_t));
+
+							findArray(pc, instr.arg.memAdr);
+							checkIndex(pc);
+
+							e_.movsdMemIndexXmm(E::RCX, E::RDX, 0, 5);
+							return true;
+						}
+
+						default: return false;
+					}
+				}
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// Whole programme is translated at once, one native block per command.
+		// Commands without native implementation exit to the interpreter.
+		class Compiler : private CodeGen
+		{
+		public:
+			// Functions:
+				explicit Compiler(const _program::Program& program) :
+					CodeGen     (program),
+					nativeOffs_ (program.code.size() + 1, 0),
+					jumpFixups_ ()
+				{}
+
+				// Returns the code, offsets of commands go to nativeOffs
+				std::vector<unsigned char> compile(std::vector<size_t>& nativeOffs)
+				{
+					using namespace MyStd1::_command;
+
+					emitPrologue();
+
+					for (size_t pc = 0; pc < program_.code.size(); ++pc)
+					{
+						nativeOffs_[pc] = e_.size();
+						emitCommand(pc);
+					}
+
+					// Falling off the programme stops the machine
+					nativeOffs_[program_.code.size()] = e_.size();
+					e_.mov32RegImm(Emitter::RAX, EXIT_HALT);
+					size_t toEpilogue = e_.jmpRel32();
+
+					epilogue_ = e_.size();
+					emitEpilogue();
+					e_.patchRel32(toEpilogue, epilogue_);
+
+					emitErrorExits();
+
+					for (const auto& fixup : jumpFixups_)
+					{
+						e_.patchRel32(fixup.at, nativeOffs_[fixup.target]);
+					}
+
+					nativeOffs = nativeOffs_;
+					return e_.bytes;
+				}
+
+		private:
+			// Types:
+				struct JumpFixup { size_t at; size_t target; };
+
+			// Variables:
+				std::vector<size_t> nativeOffs_;
+				std::vector<JumpFixup> jumpFixups_;
+
+			// Functions:
+				void jumpTo(size_t target)
+				{
+					jumpFixups_.push_back({e_.jmpRel32(), target});
+				}
+
+				void jumpIf(E::Cond cc, size_t target)
+				{
+					jumpFixups_.push_back({e_.jccRel32(cc), target});
+				}
+
+				void emitCommand(size_t pc)
+				{
+					using namespace MyStd1::_command;
+
+					const _program::Instruction& instr = program_.code[pc];
+
+					switch (instr.cmd)
+					{
+						case CMD_JMP: jumpTo(instr.arg.cmdNum); return;
+
+						case CMD_JE:
+						case CMD_JNE:
+						case CMD_JA:
+						case CMD_JAE:
+						case CMD_JB:
+						case CMD_JBE:
+						{
+							jumpIf(emitJumpCondition(pc), instr.arg.cmdNum);
+							return;
+						}
+
+						case CMD_CALL:
+						{
+							e_.cmpRegMem(CALL_TOP, STATE, offsetof(JitState, callLimit));
+							errorIf(E::CC_AE, pc, ERR_CALL_OVERFLOW);
+
+							e_.mov32MemImm(CALL_TOP, 0, static_cast<uint32_t>(pc));
+							e_.addRegImm(CALL_TOP, sizeof(uint32_t));
+							jumpTo(instr.arg.cmdNum);
+							return;
+						}
+
+						case CMD_RET:
+						{
+							e_.cmpRegMem(CALL_TOP, STATE, offsetof(JitState, callBase));
+							errorIf(E::CC_BE, pc, ERR_RET_EMPTY);
+
+							e_.subRegImm(CALL_TOP, sizeof(uint32_t));
+							e_.mov32RegMem(E::RAX, CALL_TOP, 0);
+							e_.movRegMem(E::RCX, STATE, offsetof(JitState, nativeAddr));
+							e_.jmpMemIndex(E::RCX, E::RAX, sizeof(void*)); // Command after the CALL
+							return;
+						}
+
+						default:
+						{
+							if (emitOperation(pc)) return;
+
+							// END and the rest (IO, DUMP) are left to the interpreter
+							e_.mov32MemImm(STATE, offsetof(JitState, pc), static_cast<uint32_t>(pc));
+							e_.mov32RegImm(E::RAX, instr.cmd == CMD_END? EXIT_END : EXIT_INTERPRET);
+							epilogueFixups_.push_back(e_.jmpRel32());
+							return;
+						}
+					}
+				}
+		};
+
+		//-----------------------------------------------------------------------------
+
+		class JitCode
+		{
+		public:
+			// Ctors:
+				explicit JitCode(const _program::Program& program) :
+					nativeOffs_ (),
+					buffer_     (compile(program, nativeOffs_)),
+					nativeAddr_ (nativeOffs_.size(), nullptr)
+				{
+					for (size_t i = 0; i < nativeOffs_.size(); ++i) nativeAddr_[i] = buffer_.data() + nativeOffs_[i];
+				}
+
+			// Functions:
+				const void* const* nativeAddresses() const
+				{
+					return nativeAddr_.data();
+				}
+
+				ExitCode run(JitState& state, size_t pc) const
+				{
+					using EntryFunc = uint32_t (*)(JitState*, const void*);
+
+					EntryFunc entry = reinterpret_cast<EntryFunc>(const_cast<unsigned char*>(buffer_.data()));
+
+					return static_cast<ExitCode>(entry(&state, nativeAddr_[pc]));
+				}
+
+		private:
+			// Variables:
+				std::vector<size_t> nativeOffs_;
+				ExecutableBuffer buffer_;
+				std::vector<const void*> nativeAddr_;
+
+			// Functions:
+				static std::vector<unsigned char> compile(const _program::Program& program, std::vector<size_t>& nativeOffs)
+				{
+					Compiler compiler{program};
+
+					std::vector<unsigned char> code = compiler.compile(nativeOffs);
+
+					return code;
+				}
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// Native code runs on the stacks of the CPU, only their sizes and the registers are synced
+		void storeState(const JitState& state, MyStd1::_command::CPU& cpu)
+		{
+			cpu.valSt .setFilledSize(state.valTop  - state.valBase);
+			cpu.callSt.setFilledSize(state.callTop - state.callBase);
+
+			for (size_t i = 0; i < MyStd1::_registers::REGISTER_COUNT; ++i) cpu.regs[i] = state.regs[i];
+			cpu.updateSp();
+		}
+
+		void loadState(MyStd1::_command::CPU& cpu, JitState& state)
+		{
+			state.valTop  = state.valBase  + cpu.valSt .filledSize();
+			state.callTop = state.callBase + cpu.callSt.filledSize();
+
+			for (size_t i = 0; i < MyStd1::_registers::REGISTER_COUNT; ++i) state.regs[i] = cpu.regs[i];
+
+			state.arrays     = cpu.arrays.views();
+			state.arrayCount = cpu.arrays.tableSize();
+		}
+
+		// Same messages as the interpreters give
+		[[noreturn]] void throwRuntimeError(const JitState& state, const _program::Program& program)
+		{
+			using namespace MyStd1::_command;
+
+			const char* cmdName = COMMANDS[program.code[state.pc].cmd].name.word;
+
+			switch (state.error)
+			{
+				case ERR_VAL_ST_EMPTY:  throw Exception("Value stack is empty!",       "", cmdName, 0);
+				case ERR_VAL_ST_FULL:   throw Exception("Value stack is full!",        "", cmdName, 0);
+				case ERR_INVALID_REG:   throw Exception("Unable to find the register!", "", cmdName, 0);
+				case ERR_DIV_BY_ZERO:   throw Exception("Unable to divide by 0!",      "", cmdName, 0);
+				case ERR_ACCESS_OUT:    throw Exception("Access out of stack",         "", cmdName, 0);
+				case ERR_CALL_OVERFLOW: throw Exception("CALL: Stack overflow",        "", "", 0);
+				case ERR_RET_EMPTY:     throw Exception("RET: Call stack is empty",    "", "", 0);
+				case ERR_INDEX_OUT:     throw Exception("Index out of array",          "", cmdName, 0);
+				case ERR_NOT_ARRAY:     throw Exception("Not an array",                "", cmdName, 0);
+				case ERR_SQRT_DOMAIN:   throw Exception("Root of negative number doesn't exist", "", cmdName, 0);
+				case ERR_LOG_DOMAIN:    throw Exception("Logarithm of non-positive number doesn't exist", "", cmdName, 0);
+				case ERR_POW_DOMAIN:    throw Exception("Power is not a real number",  "", cmdName, 0);
+				default:                throw Exception("Unknown native error", PROGRAM_POS);
+			}
+		}
+
+		void run(const _program::Program& program, MyStd1::_command::CPU& cpu)
+		{
+			using MyStd1::_command::CmdEnd;
+
+			_program::checkJumpTargets(program);
+
+			JitCode jitCode{program};
+
+			// Native code compares with the maximal sizes, the stacks commit their memory when it is touched
+			JitState state{};
+			state.valBase    = cpu.valSt.data();
+			state.valLimit   = state.valBase + cpu.valSt.maxSize();
+			state.callBase   = cpu.callSt.data();
+			state.callLimit  = state.callBase + cpu.callSt.maxSize();
+			state.nativeAddr = jitCode.nativeAddresses();
+			loadState(cpu, state);
+
+			size_t pc = cpu.curCmd;
+
+			while (true)
+			{
+				switch (jitCode.run(state, pc))
+				{
+					case EXIT_HALT:
+					{
+						storeState(state, cpu);
+						return;
+					}
+
+					case EXIT_END:
+					{
+						storeState(state, cpu);
+						CmdEnd{}.execute(cpu);
+						return;
+					}
+
+					case EXIT_INTERPRET:
+					{
+						storeState(state, cpu);
+
+						cpu.curCmd = static_cast<MyStd1::CmdNum_t>(state.pc);
+						program.commands[cpu.curCmd].execute(cpu);
+						pc = cpu.curCmd + 1;
+
+						loadState(cpu, state);
+						break;
+					}
+
+					case EXIT_ERROR:
+					{
+						storeState(state, cpu);
+						cpu.curCmd = static_cast<MyStd1::CmdNum_t>(state.pc);
+						throwRuntimeError(state, program);
+					}
+
+					default: throw Exception("Unknown native exit code", PROGRAM_POS);
+				}
+			}
+		}
+
+	} // namespace _jit
+
+#endif // JIT_CPU_X86_64
+
+	// Falls back to the threaded interpreter where native code can't be generated and for taking
+	// snapshots or samples, native code neither counts commands nor keeps cpu.curCmd.
+	// Resumed runs are compiled as usual.
+	void executeJit(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	                MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, MyStd1::_input::Source input = {},
+	                _snapshot::Options snapshots = {}, unsigned sampleRate = 0)
+	{
+	#ifdef JIT_CPU_X86_64
+
+		if (snapshots.filename != nullptr || sampleRate != 0)
+		{
+			executeThreaded(filename, sizes, format, input, snapshots, sampleRate);
+			return;
+		}
+
+		_program::Program program{_program::load(filename)};
+
+		_snapshot::Identity identity{};
+		if (snapshots.any()) identity = _snapshot::identify(program.code.data(), program.code.size());
+
+		// Commands the JIT leaves to the interpreter
+		_command::buildCommands(program);
+
+		MyStd1::_command::CPU cpu{sizes, format, input};
+		_command::start(program, cpu, snapshots, identity);
+
+		try
+		{
+			_jit::run(program, cpu);
+		}
+		catch (Exception& exc)
+		{
+			rethrowRuntimeError(filename, program, cpu, exc);
+		}
+
+	#else
+
+		executeThreaded(filename, sizes, format, input, snapshots, sampleRate);
+
+	#endif
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_JIT_CPU_HPP_INCLUDED*/
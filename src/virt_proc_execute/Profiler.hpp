@@ -0,0 +1,285 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_PROFILER_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_PROFILER_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+
+#include "CPU.hpp"
+#include "../assembler_std/DebugInfo.hpp"
+
+// Time stamp counter where there is one, a clock everywhere else
+#if defined(__x86_64__) || defined(__i386__)
+	#define PROFILER_TSC
+	#include <x86intrin.h>
+#endif
+
+// Defines:
+
+#define FILENAME "std1/Profiler.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// --profile: the classic engine counts the runs and the time of every command of the programme,
+// then they are summed up by the functions and the source lines of the debug section.
+// Every command is timed, so the times include the cost of timing and only compare with each other.
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _profile
+	{
+	#ifdef PROFILER_TSC
+		const char* TICKS = "cycles";
+
+		inline uint64_t now()
+		{
+			return __rdtsc();
+		}
+	#else
+		const char* TICKS = "ns";
+
+		inline uint64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	#endif
+
+		const size_t HOT_LINES    = 20;
+		const size_t HOT_COMMANDS = 10;
+
+		// Per command of the programme
+		struct Counters
+		{
+		public:
+			// Ctor:
+				explicit Counters(size_t commandCount) :
+					runs  (commandCount, 0),
+					ticks (commandCount, 0)
+				{}
+
+			// Variables:
+				std::vector<uint64_t> runs;
+				std::vector<uint64_t> ticks;
+		};
+
+		// Same as _command::run, a command gets the time till the next one starts
+		void run(const _program::Program& program, MyStd1::_command::CPU& cpu, Counters& counters)
+		{
+			const size_t size = program.commands.size();
+
+			uint64_t last = now();
+			for (; !cpu.halted && cpu.curCmd < size; ++cpu.curCmd)
+			{
+				MyStd1::CmdNum_t pc = cpu.curCmd;
+
+				program.commands[pc].execute(cpu);
+
+				uint64_t current = now();
+				counters.runs[pc]  += 1;
+				counters.ticks[pc] += current - last;
+				last = current;
+			}
+		}
+
+		//-----------------------------------------------------------------------------
+
+		struct Hotspot
+		{
+		public:
+			// Variables:
+				uint64_t runs  = 0;
+				uint64_t ticks = 0;
+		};
+
+		double percent(uint64_t part, uint64_t whole)
+		{
+			return (whole == 0)? 0.0 : 100.0 * part / whole;
+		}
+
+		template <class Key>
+		std::vector<std::pair<Key, Hotspot>> byTicks(const std::map<Key, Hotspot>& hotspots)
+		{
+			std::vector<std::pair<Key, Hotspot>> sorted(hotspots.begin(), hotspots.end());
+
+			std::stable_sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right)
+			{
+				return left.second.ticks > right.second.ticks;
+			});
+
+			return sorted;
+		}
+
+		// Source file and line
+		using Line = std::pair<uint32_t, uint32_t>;
+
+		const uint32_t NO_FILE = UINT32_MAX;
+
+		// Annotated listing of a source the programme was translated from, if it is still there
+		void listSource(std::FILE* stream, const std::map<Line, Hotspot>& lines, uint64_t ticks,
+		                uint32_t fileIndex, const std::string& source)
+		{
+			std::ifstream file{source};
+			if (!file.is_open())
+			{
+				std::fprintf(stream, "\nSource %s is not found, no listing\n", source.c_str());
+				return;
+			}
+
+			std::fprintf(stream, "\nSource %s:\n", source.c_str());
+
+			std::string text{};
+			for (uint32_t line = 1; std::getline(file, text); ++line)
+			{
+				auto hotspot = lines.find({fileIndex, line});
+
+				if (hotspot == lines.end()) std::fprintf(stream, "%8s %12s | %5u | %s\n", "", "", line, text.c_str());
+				else
+				{
+					std::fprintf(stream, "%7.2f%% %12llu | %5u | %s\n", percent(hotspot->second.ticks, ticks),
+					             static_cast<unsigned long long>(hotspot->second.runs), line, text.c_str());
+				}
+			}
+		}
+
+		void report(std::FILE* stream, const _program::Program& program, const Counters& counters,
+		            const MyStd1::_debug::DebugInfo& debug)
+		{
+			using namespace MyStd1::_command;
+
+			Hotspot total{};
+			std::map<std::string, Hotspot> functions{};
+			std::map<Line, Hotspot>        lines{};
+
+			auto functionOf = [&debug](MyStd1::CmdNum_t cmd) -> std::string
+			{
+				const MyStd1::_debug::Function* function = debug.functionOf(cmd);
+				return (function == nullptr)? "?" : debug.function(function->name);
+			};
+
+			auto lineOf = [&debug](MyStd1::CmdNum_t cmd) -> Line
+			{
+				const MyStd1::_debug::Row* row = debug.rowOf(cmd);
+				return (row == nullptr)? Line{NO_FILE, 0} : Line{row->file, row->line};
+			};
+
+			auto printLine = [stream, &debug](Line line)
+			{
+				if (line.first == NO_FILE) std::fprintf(stream, "?\n");
+				else                       std::fprintf(stream, "%s:%u\n", debug.file(line.first).c_str(), line.second);
+			};
+
+			for (MyStd1::CmdNum_t cmd = 0; cmd < counters.runs.size(); ++cmd)
+			{
+				if (counters.runs[cmd] == 0) continue;
+
+				for (Hotspot* hotspot : {&total, &functions[functionOf(cmd)], &lines[lineOf(cmd)]})
+				{
+					hotspot->runs  += counters.runs[cmd];
+					hotspot->ticks += counters.ticks[cmd];
+				}
+			}
+
+			std::fprintf(stream, "\nProfile: %llu commands run, %llu %s\n",
+			             static_cast<unsigned long long>(total.runs), static_cast<unsigned long long>(total.ticks), TICKS);
+
+			if (debug.empty())
+			{
+				std::fprintf(stream, "No debug section: the programme was assembled with --std=2 or --strip-debug\n");
+			}
+
+			std::fprintf(stream, "\nFunctions:\n%8s %12s   %s\n", TICKS, "commands", "function");
+			for (const auto& [name, hotspot] : byTicks(functions))
+			{
+				std::fprintf(stream, "%7.2f%% %12llu   %s\n", percent(hotspot.ticks, total.ticks),
+				             static_cast<unsigned long long>(hotspot.runs), name.c_str());
+			}
+
+			std::fprintf(stream, "\nHot lines:\n%8s %12s   %s\n", TICKS, "commands", "line");
+			std::vector<std::pair<Line, Hotspot>> hotLines{byTicks(lines)};
+			for (size_t i = 0; i < hotLines.size() && i < HOT_LINES; ++i)
+			{
+				std::fprintf(stream, "%7.2f%% %12llu   ", percent(hotLines[i].second.ticks, total.ticks),
+				             static_cast<unsigned long long>(hotLines[i].second.runs));
+
+				printLine(hotLines[i].first);
+			}
+
+			std::vector<MyStd1::CmdNum_t> hotCommands{};
+			for (MyStd1::CmdNum_t cmd = 0; cmd < counters.runs.size(); ++cmd)
+			{
+				if (counters.runs[cmd] != 0) hotCommands.push_back(cmd);
+			}
+
+			std::stable_sort(hotCommands.begin(), hotCommands.end(), [&counters](MyStd1::CmdNum_t left, MyStd1::CmdNum_t right)
+			{
+				return counters.ticks[left] > counters.ticks[right];
+			});
+
+			std::fprintf(stream, "\nHot commands:\n%8s %12s   %8s %-8s %s\n", TICKS, "commands", "address", "command", "line");
+			for (size_t i = 0; i < hotCommands.size() && i < HOT_COMMANDS; ++i)
+			{
+				MyStd1::CmdNum_t cmd = hotCommands[i];
+
+				std::fprintf(stream, "%7.2f%% %12llu   %8u %-8s ", percent(counters.ticks[cmd], total.ticks),
+				             static_cast<unsigned long long>(counters.runs[cmd]), cmd, COMMANDS[program.code[cmd].cmd].name.word);
+
+				printLine(lineOf(cmd));
+			}
+
+			for (uint32_t file = 0; file < debug.fileCount(); ++file)
+			{
+				if (!debug.file(file).empty()) listSource(stream, lines, total.ticks, file, debug.file(file));
+			}
+		}
+
+	} // namespace _profile
+
+	// The report goes to stderr when the programme is over or stopped by a runtime error
+	void executeProfiled(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	                     MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, MyStd1::_input::Source input = {})
+	{
+		_program::Program program{_program::load(filename)};
+		_command::buildCommands(program);
+
+		MyStd1::_debug::DebugInfo debug{MyStd1::_debug::read(filename)};
+
+		_profile::Counters counters{program.code.size()};
+
+		MyStd1::_command::CPU cpu{sizes, format, input};
+		cpu.curCmd = program.entry;
+
+		try
+		{
+			runCatchingOverflow([&]()
+			{
+				_profile::run(program, cpu, counters);
+			});
+		}
+		catch (Exception& exc)
+		{
+			cpu.out.flush();
+			_profile::report(stderr, program, counters, debug);
+
+			rethrowRuntimeError(filename, program, cpu, exc);
+		}
+
+		cpu.out.flush();
+		_profile::report(stderr, program, counters, debug);
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_PROFILER_HPP_INCLUDED*/
@@ -0,0 +1,383 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_REG_CPU_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_REG_CPU_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+#include "CPU.hpp"
+#include "../assembler_std/RegStandard.hpp"
+
+// Defines:
+
+#define FILENAME "reg/RegCPU.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+namespace EmulatedProcessorReg
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	using EmulatedProcessorStd1::_additional::MappedReader;
+
+	namespace _program
+	{
+		struct Instruction
+		{
+		public:
+			// Variables:
+				MyRegStd::Val_t    value;
+				MyRegStd::CmdNum_t target;
+				MyRegStd::RegNum_t a, b, c; // Registers in the order of operands, ENTER keeps frame size in a
+				MyRegStd::Cmd_t    cmd;
+		};
+
+		struct Program
+		{
+		public:
+			// Variables:
+				std::vector<Instruction> code;
+				MyRegStd::CmdNum_t entry;
+		};
+
+		//-----------------------------------------------------------------------------
+
+		Instruction instructionFromFile(MappedReader& reader)
+		{
+			using namespace MyRegStd;
+
+			Instruction instr{};
+			instr.cmd = reader.get<Cmd_t>();
+
+			if (instr.cmd >= COMMAND_COUNT) throw Exception("Unknown command number", PROGRAM_POS);
+
+			MyRegStd::RegNum_t* regs[] = {&instr.a, &instr.b, &instr.c};
+			size_t regI = 0;
+
+			for (ArgType argType : COMMANDS[instr.cmd].argTypes)
+			{
+				switch (argType)
+				{
+					case ArgType::REGISTER:
+					case ArgType::COUNT:   *regs[regI++] = reader.get<RegNum_t>(); break;
+					case ArgType::VALUE:   instr.value   = reader.get<Val_t>   (); break;
+					case ArgType::NAMETAG: instr.target  = reader.get<CmdNum_t>(); break;
+					default: throw Exception("Unexpected argType", PROGRAM_POS);
+				}
+			}
+
+			return instr;
+		}
+
+		Program load(const char* filename)
+		{
+			FileWork::MappedBinaryFile file{filename};
+
+			Program program{{}, 0};
+
+			try
+			{
+				MappedReader reader{file.data(), file.size()};
+
+				if (reader.get<MyRegStd::MagicNum_t>() != MyStd1::MAGIC_NUM)
+				{
+					throw Exception("Unknown file format", filename, "-", 0);
+				}
+
+				MyRegStd::StdNum_t std = reader.get<MyRegStd::StdNum_t>();
+
+				if (std != MyRegStd::STD_NUM)
+				{
+					bool known = (std == MyRegStd::STD_NUM_DOUBLE || std == MyRegStd::STD_NUM_I64);
+					throw Exception(known? MyStd1::OTHER_VALUE_TYPE : "Unknown standard", filename, "-", 0);
+				}
+
+				while (!reader.finished())
+				{
+					// Same entry point rule as the stack machine has
+					Instruction instr = instructionFromFile(reader);
+					if (instr.cmd == MyRegStd::REG_BEG && program.entry == 0) program.entry = program.code.size();
+
+					program.code.push_back(instr);
+				}
+			}
+			catch (Exception& exc)
+			{
+				throw Exception("Unable to read file", filename, "-", 0, exc);
+			}
+
+			return program;
+		}
+
+		// Registers are checked once here instead of on every access:
+		// a function (ENTER up to the next ENTER) may use registers below its frame size only,
+		// jumps stay inside the function or go to an ENTER, calls go to an ENTER
+		void verify(const Program& program)
+		{
+			using namespace MyRegStd;
+
+			const std::vector<Instruction>& code = program.code;
+
+			std::vector<size_t> function(code.size());
+			for (size_t pc = 0, funcI = 0; pc < code.size(); ++pc)
+			{
+				if (code[pc].cmd == REG_ENTER) ++funcI;
+				function[pc] = funcI;
+			}
+
+			RegNum_t frameSize = 0;
+			for (size_t pc = 0; pc < code.size(); ++pc)
+			{
+				const Instruction& instr = code[pc];
+				const char* cmdName = COMMANDS[instr.cmd].name.word;
+
+				if (instr.cmd == REG_ENTER) frameSize = instr.a;
+
+				const RegNum_t regs[] = {instr.a, instr.b, instr.c};
+				size_t regI = 0;
+
+				for (ArgType argType : COMMANDS[instr.cmd].argTypes)
+				{
+					if (argType == ArgType::COUNT) ++regI;
+
+					if (argType == ArgType::REGISTER && regs[regI++] >= frameSize)
+					{
+						throw Exception("Register is out of the frame", "", cmdName, 0);
+					}
+
+					if (argType != ArgType::NAMETAG || instr.target == code.size()) continue;
+
+					if (instr.target > code.size()) throw Exception("Jump target is out of the program", "", cmdName, 0);
+
+					bool toFunction = code[instr.target].cmd == REG_ENTER;
+
+					if (instr.cmd == REG_CALL && !toFunction)
+					{
+						throw Exception("Function has to start with ENTER", "", cmdName, 0);
+					}
+
+					if (!toFunction && function[instr.target] != function[pc])
+					{
+						throw Exception("Jump target is out of the function", "", cmdName, 0);
+					}
+				}
+			}
+		}
+
+	} // namespace _program
+
+	namespace _machine
+	{
+		using MyRegStd::Val_t;
+		namespace _values = MyStd1::_values;
+
+		struct Frame
+		{
+		public:
+			// Variables:
+				size_t retPc;
+				size_t base;
+				MyRegStd::RegNum_t result;
+		};
+
+		void run(const _program::Program& program, MyStd1::_command::StackSizes sizes, MyStd1::_output::Output& out)
+		{
+			using namespace MyRegStd;
+
+			const _program::Instruction* code = program.code.data();
+			const size_t size = program.code.size();
+
+			// Registers of the frames are committed when they are touched, ENTER keeps them under the maximal size
+			MyStackStaticArrayRepresentation::GrowableStack<Val_t> regFile{sizes.size, sizes.maxSize, "Register file is full!"};
+			std::vector<Frame> callSt;
+			callSt.reserve(sizes.size);
+
+			size_t base = 0;
+			Val_t* regs = regFile.data();
+			Val_t  rt   = 0;
+
+			#define BINARY_OPERATOR(cmd, piece_of_code)                       \
+				case cmd:                                                     \
+				{                                                             \
+					Val_t l = regs[instr.b];                                  \
+					Val_t r = regs[instr.c];                                  \
+					regs[instr.a] = (piece_of_code);                          \
+					break;                                                    \
+				}
+
+			size_t pc = program.entry;
+			while (pc < size)
+			{
+				const _program::Instruction& instr = code[pc++];
+
+				switch (instr.cmd)
+				{
+					case REG_BEG: break;
+
+					case REG_END:
+					{
+						out.end(rt);
+						return;
+					}
+
+					case REG_ENTER:
+					{
+						if (base + instr.a > regFile.maxSize()) throw Exception("Register file is full!", "", "ENTER", 0);
+						break;
+					}
+
+					case REG_LOADK: regs[instr.a] =  instr.value;   break;
+					case REG_MOV:   regs[instr.a] =  regs[instr.b]; break;
+					case REG_NEG:   regs[instr.a] = _values::sub(0, regs[instr.b]); break;
+
+					BINARY_OPERATOR(REG_ADD, _values::add(l, r))
+					BINARY_OPERATOR(REG_SUB, _values::sub(l, r))
+					BINARY_OPERATOR(REG_MUL, _values::mul(l, r))
+
+					case REG_DIV:
+					{
+						if (_values::isZero(regs[instr.c]))
+						{
+							throw Exception("Unable to divide by 0!", "", "DIV", 0);
+						}
+
+						regs[instr.a] = _values::div(regs[instr.b], regs[instr.c]);
+						break;
+					}
+
+					BINARY_OPERATOR(REG_IS_L,  (l <  r)? 1 : -1)
+					BINARY_OPERATOR(REG_IS_LE, (l <= r)? 1 : -1)
+					BINARY_OPERATOR(REG_IS_M,  (l >  r)? 1 : -1)
+					BINARY_OPERATOR(REG_IS_ME, (l >= r)? 1 : -1)
+					BINARY_OPERATOR(REG_IS_E,  (l == r)? 1 : -1)
+					BINARY_OPERATOR(REG_IS_NE, (l != r)? 1 : -1)
+					BINARY_OPERATOR(REG_AND,   (l > 0 && r > 0)? 1 : -1)
+					BINARY_OPERATOR(REG_OR,    (l > 0 || r > 0)? 1 : -1)
+
+					case REG_JMP: pc = instr.target; break;
+					case REG_JGZ: if (regs[instr.a] > 0) pc = instr.target; break;
+					case REG_JLZ: if (regs[instr.a] < 0) pc = instr.target; break;
+
+					case REG_CALL:
+					{
+						if (callSt.size() == sizes.maxSize) throw Exception("CALL: Stack overflow", "", "", 0);
+
+						callSt.push_back({pc, base, instr.a});
+
+						base += instr.b;
+						regs = regFile.data() + base;
+						pc = instr.target;
+						break;
+					}
+
+					case REG_RET:
+					{
+						if (callSt.empty()) throw Exception("RET: Call stack is empty", "", "", 0);
+
+						rt = regs[instr.a];
+
+						Frame caller = callSt.back();
+						callSt.pop_back();
+
+						base = caller.base;
+						regs = regFile.data() + base;
+						regs[caller.result] = rt;
+						pc = caller.retPc;
+						break;
+					}
+
+					case REG_SETRT: rt = regs[instr.a]; break;
+
+					case REG_PRINT: out.value(regs[instr.a]); break;
+
+					case REG_SQRT:
+					{
+						if (regs[instr.b] < 0) throw Exception("Root of negative number doesn't exist", "", "SQRT", 0);
+
+						regs[instr.a] = _values::fromReal(std::sqrt(regs[instr.b]));
+						break;
+					}
+
+					case REG_LOG:
+					{
+						if (!(regs[instr.b] > 0)) throw Exception("Logarithm of non-positive number doesn't exist", "", "LOG", 0);
+
+						regs[instr.a] = _values::fromReal(std::log(regs[instr.b]));
+						break;
+					}
+
+					case REG_SIN:   regs[instr.a] = _values::fromReal(std::sin  (regs[instr.b])); break;
+					case REG_COS:   regs[instr.a] = _values::fromReal(std::cos  (regs[instr.b])); break;
+					case REG_EXP:   regs[instr.a] = _values::fromReal(std::exp  (regs[instr.b])); break;
+					case REG_FLOOR: regs[instr.a] = _values::fromReal(std::floor(regs[instr.b])); break;
+
+					case REG_ABS: regs[instr.a] = _values::abs(regs[instr.b]); break;
+
+					case REG_POW:
+					{
+						Val_t power = 0;
+						if (!_values::pow(regs[instr.b], regs[instr.c], power)) throw Exception("Power is not a real number", "", "POW", 0);
+
+						regs[instr.a] = power;
+						break;
+					}
+
+					BINARY_OPERATOR(REG_MIN, _values::min(l, r))
+					BINARY_OPERATOR(REG_MAX, _values::max(l, r))
+
+					default: throw Exception("Unknown command number", PROGRAM_POS);
+				}
+			}
+
+			#undef BINARY_OPERATOR
+		}
+
+	} // namespace _machine
+
+	bool isRegProgramme(const char* filename)
+	{
+		// Two bytes only, the file is mapped by the loader afterwards
+		FileWork::ReadBinaryFile stream{filename};
+
+		unsigned char start[2] = {};
+		stream.getBytes(start, sizeof(start));
+
+		return start[0] == MyStd1::MAGIC_NUM && (start[1] == MyRegStd::STD_NUM_DOUBLE || start[1] == MyRegStd::STD_NUM_I64);
+	}
+
+	// Register programmes are always verified before they run
+	void reportVerification(const char* filename)
+	{
+		_program::verify(_program::load(filename));
+
+		std::printf("Verified: register programme\n");
+	}
+
+	void execute(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	             MyStd1::_output::Format format = MyStd1::_output::Format::TEXT)
+	{
+		_program::Program program{_program::load(filename)};
+		MyStd1::_output::Output out{format};
+
+		try
+		{
+			_program::verify(program);
+			_machine::run(program, sizes, out);
+		}
+		catch (Exception& exc)
+		{
+			out.flush();
+			throw Exception("Runtime error", filename, "-", 0, exc);
+		}
+	}
+
+} // namespace EmulatedProcessorReg
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_REG_CPU_HPP_INCLUDED*/
@@ -0,0 +1,407 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_SAMPLER_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_SAMPLER_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+#include <csignal>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "../assembler_std/Standard2.hpp"
+#include "../assembler_std/DebugInfo.hpp"
+
+// Defines:
+
+#define FILENAME "std1/Sampler.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// --sample: SIGPROF comes rate times a second of CPU time, the handler copies cpu.curCmd and the top
+// of cpu.callSt into a ring buffer and a collecting thread empties the ring into the counters.
+// The engines keep running at full speed: the classic one has curCmd in memory anyway, the threaded
+// one stores its pc there at the start of every basic block (see _threaded::run), the JIT runs the threaded one.
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _sampler
+	{
+		const unsigned DEFAULT_RATE = 1000;   // Samples a second
+		const unsigned MAX_RATE     = 100000; // Timer period of 10 us
+		const size_t   MAX_FRAMES   = 16;     // Calls kept from the top of the call stack
+		const size_t   HOT_LINES    = 20;
+		const size_t   HOT_STACKS   = 10;
+
+		struct Sample
+		{
+		public:
+			// Variables:
+				MyStd1::CmdNum_t cmd;
+				uint32_t         depth;              // Of the call stack
+				MyStd1::CmdNum_t frames[MAX_FRAMES]; // CALL commands, innermost first
+		};
+
+		// One producer (the signal handler) and one consumer (the collecting thread), so the indices
+		// are the only shared state. A full ring drops the sample.
+		class SampleRing
+		{
+		public:
+			static const uint32_t CAPACITY = 1 << 12;
+
+			// Ctor:
+				SampleRing() :
+					slots_ (),
+					head_  (0),
+					tail_  (0)
+				{}
+
+			// Functions:
+				bool push(const Sample& sample)
+				{
+					uint32_t head = head_.load(std::memory_order_relaxed);
+					if (head - tail_.load(std::memory_order_acquire) == CAPACITY) return false;
+
+					slots_[head % CAPACITY] = sample;
+					head_.store(head + 1, std::memory_order_release);
+
+					return true;
+				}
+
+				bool pop(Sample& sample)
+				{
+					uint32_t tail = tail_.load(std::memory_order_relaxed);
+					if (tail == head_.load(std::memory_order_acquire)) return false;
+
+					sample = slots_[tail % CAPACITY];
+					tail_.store(tail + 1, std::memory_order_release);
+
+					return true;
+				}
+
+		private:
+			// Variables:
+				Sample slots_[CAPACITY];
+				alignas(64) std::atomic<uint32_t> head_;
+				alignas(64) std::atomic<uint32_t> tail_;
+		};
+
+		static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free &&
+		              std::atomic<MyStd1::_command::CPU*>::is_always_lock_free, "The signal handler takes no locks");
+
+		// What the signal handler sees
+		struct Shared
+		{
+		public:
+			// Variables:
+				std::atomic<MyStd1::_command::CPU*> cpu{nullptr};
+				std::atomic<uint64_t> dropped{0};
+				SampleRing ring;
+		};
+
+		Shared& shared()
+		{
+			static Shared state;
+			return state;
+		}
+
+		void onProf(int)
+		{
+			Shared& state = shared();
+
+			MyStd1::_command::CPU* cpu = state.cpu.load(std::memory_order_acquire);
+			if (cpu == nullptr) return;
+
+			Sample sample;
+			sample.cmd   = cpu->curCmd;
+			sample.depth = static_cast<uint32_t>(cpu->callSt.filledSize());
+
+			const MyStd1::CmdNum_t* calls = cpu->callSt.data();
+			for (size_t frame = 0; frame < sample.depth && frame < MAX_FRAMES; ++frame)
+			{
+				sample.frames[frame] = calls[sample.depth - 1 - frame];
+			}
+
+			if (!state.ring.push(sample)) state.dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		//-----------------------------------------------------------------------------
+
+		// Samples one CPU from the ctor to stop()
+		class Sampler
+		{
+		public:
+			// Ctor && dtor:
+				Sampler(unsigned rate, MyStd1::_command::CPU& cpu) :
+					rate_      (rate),
+					started_   (std::clock()),
+					cpuTime_   (0.0),
+					previous_  (),
+					stop_      (false),
+					collector_ (),
+					samples_   (0),
+					self_      (),
+					stacks_    ()
+				{
+					shared().dropped.store(0);
+					shared().cpu.store(&cpu, std::memory_order_release);
+
+					// SIGPROF is for the thread running the machine, the collector starts with it blocked
+					sigset_t prof, mask;
+					sigemptyset(&prof);
+					sigaddset(&prof, SIGPROF);
+
+					pthread_sigmask(SIG_BLOCK, &prof, &mask);
+					collector_ = std::thread([this]() { collect(); });
+					pthread_sigmask(SIG_SETMASK, &mask, nullptr);
+
+					struct sigaction action{};
+					action.sa_handler = onProf;
+					action.sa_flags   = SA_RESTART;
+					sigemptyset(&action.sa_mask);
+					sigaction(SIGPROF, &action, &previous_);
+
+					long period = 1000000 / static_cast<long>(rate_);
+					if (period == 0) period = 1;
+
+					struct itimerval timer{};
+					timer.it_interval.tv_sec  = period / 1000000;
+					timer.it_interval.tv_usec = period % 1000000;
+					timer.it_value = timer.it_interval;
+					setitimer(ITIMER_PROF, &timer, nullptr);
+				}
+
+				Sampler(const Sampler&) = delete;
+				Sampler& operator=(const Sampler&) = delete;
+
+				~Sampler()
+				{
+					stop();
+				}
+
+			// Functions:
+				void stop()
+				{
+					if (!collector_.joinable()) return;
+
+					struct itimerval timer{};
+					setitimer(ITIMER_PROF, &timer, nullptr);
+
+					shared().cpu.store(nullptr, std::memory_order_release);
+					sigaction(SIGPROF, &previous_, nullptr);
+
+					stop_.store(true);
+					collector_.join();
+
+					drain();
+					cpuTime_ = static_cast<double>(std::clock() - started_) / CLOCKS_PER_SEC;
+				}
+
+				// Self samples by the functions and the lines, then the hottest call stacks
+				void report(std::FILE* stream, const MyStd1::_debug::DebugInfo& debug) const
+				{
+					auto percent = [this](uint64_t count) { return (samples_ == 0)? 0.0 : 100.0 * count / samples_; };
+
+					std::map<std::string, uint64_t> functions{};
+					std::map<std::string, uint64_t> lines{};
+					std::map<std::string, uint64_t> stacks{};
+
+					for (const auto& [cmd, count] : self_)
+					{
+						functions[functionOf(debug, cmd)] += count;
+						lines[lineOf(debug, cmd)]         += count;
+					}
+
+					// Recursion is written once with its depth: f > g x3
+					for (const auto& [calls, count] : stacks_)
+					{
+						std::string stack{};
+						for (size_t frame = 0; frame < calls.size();)
+						{
+							std::string name = (calls[frame] == TRUNCATED)? "..." : functionOf(debug, calls[frame]);
+
+							size_t repeats = 1;
+							for (; frame + repeats < calls.size() && calls[frame + repeats] != TRUNCATED &&
+							       functionOf(debug, calls[frame + repeats]) == name; ++repeats) {}
+
+							if (frame != 0) stack += " > ";
+							stack += (repeats == 1)? name : name + " x" + std::to_string(repeats);
+
+							frame += repeats;
+						}
+
+						stacks[stack] += count;
+					}
+
+					// The kernel may round the period up to its tick
+					std::fprintf(stream, "\nSampled: %llu samples in %.2f s of CPU time (%u Hz asked), %llu dropped\n",
+					             static_cast<unsigned long long>(samples_), cpuTime_, rate_,
+					             static_cast<unsigned long long>(shared().dropped.load()));
+
+					if (debug.empty())
+					{
+						std::fprintf(stream, "No debug section: the programme was assembled with --std=2 or --strip-debug\n");
+					}
+
+					std::fprintf(stream, "\nFunctions:\n%8s %10s   %s\n", "self", "samples", "function");
+					for (const auto& [name, count] : byCount(functions))
+					{
+						std::fprintf(stream, "%7.2f%% %10llu   %s\n", percent(count), static_cast<unsigned long long>(count), name.c_str());
+					}
+
+					std::fprintf(stream, "\nHot lines:\n%8s %10s   %s\n", "self", "samples", "line");
+					std::vector<std::pair<std::string, uint64_t>> hotLines{byCount(lines)};
+					for (size_t i = 0; i < hotLines.size() && i < HOT_LINES; ++i)
+					{
+						std::fprintf(stream, "%7.2f%% %10llu   %s\n", percent(hotLines[i].second),
+						             static_cast<unsigned long long>(hotLines[i].second), hotLines[i].first.c_str());
+					}
+
+					std::fprintf(stream, "\nHot stacks:\n%8s %10s   %s\n", "", "samples", "calls");
+					std::vector<std::pair<std::string, uint64_t>> hotStacks{byCount(stacks)};
+					for (size_t i = 0; i < hotStacks.size() && i < HOT_STACKS; ++i)
+					{
+						std::fprintf(stream, "%7.2f%% %10llu   %s\n", percent(hotStacks[i].second),
+						             static_cast<unsigned long long>(hotStacks[i].second), hotStacks[i].first.c_str());
+					}
+				}
+
+		private:
+			// Marks a stack deeper than MAX_FRAMES
+			static constexpr MyStd1::CmdNum_t TRUNCATED = std::numeric_limits<MyStd1::CmdNum_t>::max();
+
+			// Variables:
+				unsigned rate_;
+				std::clock_t started_;
+				double cpuTime_;
+				struct sigaction previous_;
+
+				std::atomic<bool> stop_;
+				std::thread collector_;
+
+				// Written by the collector till it is joined
+				uint64_t samples_;
+				std::map<MyStd1::CmdNum_t, uint64_t> self_;
+				std::map<std::vector<MyStd1::CmdNum_t>, uint64_t> stacks_; // Outermost call first, then the command
+
+			// Functions:
+				void collect()
+				{
+					while (!stop_.load())
+					{
+						drain();
+						std::this_thread::sleep_for(std::chrono::milliseconds(20));
+					}
+				}
+
+				void drain()
+				{
+					Sample sample;
+					std::vector<MyStd1::CmdNum_t> calls{};
+
+					while (shared().ring.pop(sample))
+					{
+						++samples_;
+						++self_[sample.cmd];
+
+						size_t kept = std::min<size_t>(sample.depth, MAX_FRAMES);
+
+						calls.clear();
+						if (sample.depth > MAX_FRAMES) calls.push_back(TRUNCATED);
+						for (size_t frame = kept; frame != 0; --frame) calls.push_back(sample.frames[frame - 1]);
+						calls.push_back(sample.cmd);
+
+						++stacks_[calls];
+					}
+				}
+
+				static std::string functionOf(const MyStd1::_debug::DebugInfo& debug, MyStd1::CmdNum_t cmd)
+				{
+					const MyStd1::_debug::Function* function = debug.functionOf(cmd);
+					return (function == nullptr)? "@" + std::to_string(cmd) : debug.function(function->name);
+				}
+
+				static std::string lineOf(const MyStd1::_debug::DebugInfo& debug, MyStd1::CmdNum_t cmd)
+				{
+					const MyStd1::_debug::Row* row = debug.rowOf(cmd);
+					return (row == nullptr)? "?" : debug.file(row->file) + ":" + std::to_string(row->line);
+				}
+
+				static std::vector<std::pair<std::string, uint64_t>> byCount(const std::map<std::string, uint64_t>& counts)
+				{
+					std::vector<std::pair<std::string, uint64_t>> sorted(counts.begin(), counts.end());
+
+					std::stable_sort(sorted.begin(), sorted.end(), [](const auto& left, const auto& right)
+					{
+						return left.second > right.second;
+					});
+
+					return sorted;
+				}
+		};
+
+		// Stops the sampler and writes its report to stderr after the output of the programme
+		void finish(Sampler& sampler, const char* filename, MyStd1::_command::CPU& cpu)
+		{
+			sampler.stop();
+			cpu.out.flush();
+
+			MyStd1::_debug::DebugInfo debug{};
+			try
+			{
+				debug = MyStd1::_debug::read(filename);
+			}
+			catch (std::exception&)
+			{
+				// Reported without positions
+			}
+
+			sampler.report(stderr, debug);
+		}
+
+		// Calls run under a sampler when rate is not 0, the report is written when the run is over or stopped by an error
+		template <class Run>
+		void runSampled(unsigned rate, const char* filename, MyStd1::_command::CPU& cpu, Run run)
+		{
+			if (rate == 0)
+			{
+				run();
+				return;
+			}
+
+			Sampler sampler{rate, cpu};
+
+			try
+			{
+				run();
+			}
+			catch (...)
+			{
+				finish(sampler, filename, cpu);
+				throw;
+			}
+
+			finish(sampler, filename, cpu);
+		}
+
+	} // namespace _sampler
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_SAMPLER_HPP_INCLUDED*/
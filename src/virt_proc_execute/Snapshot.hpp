@@ -0,0 +1,298 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_SNAPSHOT_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_SNAPSHOT_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <string>
+#include <vector>
+
+#include "../assembler_std/Standard2.hpp"
+#include "../libs/FileWork_Old.hpp"
+
+// Defines:
+
+#define FILENAME "std1/Snapshot.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// State of a stack machine run in a file: registers, both stacks, the arrays of NEWARR, the next command
+// and the position in the input. The run is resumed from it by any engine. Snapshots are taken every N commands and
+// on SIGUSR1, the engines look at both at most every POLL_INTERVAL commands.
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _snapshot
+	{
+		using MyStd1::Val_t;
+		using MyStd1::CmdNum_t;
+
+		// valang_execute --snapshot=FILE [--snapshot-every=N] [--resume=FILE]
+		struct Options
+		{
+		public:
+			// Variables:
+				const char* filename = nullptr;
+				size_t      every    = 0; // Commands, 0 is on the signal only
+				const char* resume   = nullptr;
+
+			// Functions:
+				bool any() const
+				{
+					return filename != nullptr || resume != nullptr;
+				}
+		};
+
+		const size_t POLL_INTERVAL = 1 << 16;
+
+		const uint32_t MAGIC   = 0x504E5356; // "VSNP"
+		const uint16_t VERSION = 2; // 2: arrays
+
+		// The stacks follow it: filled part of the value stack, then of the call stack,
+		// then every live array as ArrayRecord and its elements
+		struct Header
+		{
+		public:
+			// Variables:
+				uint32_t magic;
+				uint16_t version;
+				uint16_t headerSize;
+				uint64_t checksum;      // Of the programme as it was loaded
+				uint32_t commandCount;
+				uint32_t curCmd;        // Next command to run
+				uint64_t valSize;
+				uint64_t callSize;
+				uint64_t inputPosition; // Values taken by IN
+				uint64_t arrayCount;    // Live arrays
+				Val_t    regs[MyStd1::_registers::REGISTER_COUNT];
+		};
+
+		struct ArrayRecord
+		{
+		public:
+			// Variables:
+				uint64_t index; // Handle - 1
+				uint64_t owner; // Slot of the handle
+				uint64_t size;
+		};
+
+		// Snapshots belong to one programme
+		struct Identity
+		{
+		public:
+			// Variables:
+				uint64_t checksum;
+				uint32_t commandCount;
+		};
+
+		// FNV-1a of the instructions, taken before fusion changes them
+		Identity identify(const MyStd1::Instruction* code, size_t count)
+		{
+			uint64_t hash = 0xCBF29CE484222325;
+
+			const unsigned char* byte = reinterpret_cast<const unsigned char*>(code);
+			const unsigned char* end  = byte + count * sizeof(MyStd1::Instruction);
+
+			for (; byte != end; ++byte) hash = (hash ^ *byte) * 0x100000001B3;
+
+			return {hash, static_cast<uint32_t>(count)};
+		}
+
+		volatile std::sig_atomic_t& requested()
+		{
+			static volatile std::sig_atomic_t flag = 0;
+			return flag;
+		}
+
+		void onSignal(int)
+		{
+			requested() = 1;
+		}
+
+		// The complete CPU, the engine puts its cached state back before the call.
+		// Written next to the file and renamed, so a crash while writing leaves the previous snapshot.
+		void write(const char* filename, MyStd1::_command::CPU& cpu, Identity identity)
+		{
+			cpu.out.flush();
+
+			Header header{};
+			header.magic         = MAGIC;
+			header.version       = VERSION;
+			header.headerSize    = sizeof(Header);
+			header.checksum      = identity.checksum;
+			header.commandCount  = identity.commandCount;
+			header.curCmd        = cpu.curCmd;
+			header.valSize       = cpu.valSt.filledSize();
+			header.callSize      = cpu.callSt.filledSize();
+			header.inputPosition = cpu.in.position();
+			header.arrayCount    = cpu.arrays.liveArrays().size();
+			std::memcpy(header.regs, cpu.regs.data(), sizeof(header.regs));
+
+			std::string temporary = std::string(filename) + ".tmp";
+
+			std::FILE* file = std::fopen(temporary.c_str(), "wb");
+			if (file == nullptr) throw Exception("Unable to create snapshot", filename, "-", 0);
+
+			bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+			               std::fwrite(cpu.valSt.data(),  sizeof(Val_t),    header.valSize,  file) == header.valSize &&
+			               std::fwrite(cpu.callSt.data(), sizeof(CmdNum_t), header.callSize, file) == header.callSize;
+
+			for (size_t index : cpu.arrays.liveArrays())
+			{
+				const MyStd1::_arrays::View& array = cpu.arrays.views()[index];
+				ArrayRecord record{index, cpu.arrays.owner(index), array.size};
+
+				written = written && std::fwrite(&record, sizeof(record), 1, file) == 1 &&
+				          std::fwrite(array.data, sizeof(Val_t), array.size, file) == array.size;
+			}
+
+			if (std::fclose(file) != 0 || !written || std::rename(temporary.c_str(), filename) != 0)
+			{
+				std::remove(temporary.c_str());
+				throw Exception("Unable to write snapshot", filename, "-", 0);
+			}
+		}
+
+		// The stacks must be able to hold what the snapshot has
+		void restore(const char* filename, MyStd1::_command::CPU& cpu, Identity identity)
+		{
+			FileWork::MappedBinaryFile file{filename};
+
+			Header header{};
+			if (file.size() < sizeof(header)) throw Exception("Broken snapshot", filename, "-", 0);
+
+			std::memcpy(&header, file.data(), sizeof(header));
+
+			if (header.magic != MAGIC || header.version != VERSION || header.headerSize != sizeof(Header))
+			{
+				throw Exception("Unknown snapshot format", filename, "-", 0);
+			}
+
+			if (header.checksum != identity.checksum || header.commandCount != identity.commandCount)
+			{
+				throw Exception("Snapshot is of another programme", filename, "-", 0);
+			}
+
+			if (header.valSize > cpu.valSt.maxSize() || header.callSize > cpu.callSt.maxSize())
+			{
+				throw Exception("Snapshot doesn't fit into the stacks, raise --max-stack-size", filename, "-", 0);
+			}
+
+			size_t stacksEnd = sizeof(Header) + header.valSize * sizeof(Val_t) + header.callSize * sizeof(CmdNum_t);
+
+			if (file.size() < stacksEnd || header.curCmd > header.commandCount)
+			{
+				throw Exception("Broken snapshot", filename, "-", 0);
+			}
+
+			// Pages of the stacks are committed as they are written
+			const unsigned char* stacks = file.data() + sizeof(Header);
+			std::memcpy(cpu.valSt.data(), stacks, header.valSize * sizeof(Val_t));
+			std::memcpy(cpu.callSt.data(), stacks + header.valSize * sizeof(Val_t), header.callSize * sizeof(CmdNum_t));
+
+			// RET jumps right after the command of the entry
+			const CmdNum_t* calls = cpu.callSt.data();
+			for (uint64_t i = 0; i < header.callSize; ++i)
+			{
+				if (calls[i] >= header.commandCount) throw Exception("Broken snapshot", filename, "-", 0);
+			}
+
+			cpu.valSt.setFilledSize(header.valSize);
+			cpu.callSt.setFilledSize(header.callSize);
+
+			size_t position = stacksEnd;
+			for (uint64_t i = 0; i < header.arrayCount; ++i)
+			{
+				ArrayRecord record{};
+				if (file.size() - position < sizeof(record)) throw Exception("Broken snapshot", filename, "-", 0);
+
+				std::memcpy(&record, file.data() + position, sizeof(record));
+				position += sizeof(record);
+
+				if (record.size > MyStd1::_arrays::MAX_ARRAY_SIZE || record.index >= MyStd1::_arrays::MAX_ARRAY_SIZE ||
+				    (file.size() - position) / sizeof(Val_t) < record.size)
+				{
+					throw Exception("Broken snapshot", filename, "-", 0);
+				}
+
+				// Elements may be unaligned in the mapping
+				std::vector<Val_t> values(record.size);
+				std::memcpy(values.data(), file.data() + position, record.size * sizeof(Val_t));
+				position += record.size * sizeof(Val_t);
+
+				if (!cpu.arrays.restore(record.index, record.owner, values.data(), values.size()))
+				{
+					throw Exception("Not enough memory for the array", filename, "-", 0);
+				}
+			}
+
+			if (position != file.size()) throw Exception("Broken snapshot", filename, "-", 0);
+
+			std::memcpy(cpu.regs.data(), header.regs, sizeof(header.regs));
+			cpu.curCmd = header.curCmd;
+
+			cpu.in.skip(header.inputPosition);
+		}
+
+		// When the engines stop to look at the signal and the count, made for --snapshot only
+		class Schedule
+		{
+		public:
+			// Ctor:
+				Schedule(const Options& options, Identity identity) :
+					options_  (options),
+					identity_ (identity),
+					left_     (options.every),
+					budget_   (0)
+				{
+					struct sigaction action{};
+					action.sa_handler = onSignal;
+					sigemptyset(&action.sa_mask);
+
+					sigaction(SIGUSR1, &action, nullptr);
+				}
+
+			// Functions:
+				// Commands to run before the next poll
+				size_t budget()
+				{
+					budget_ = (left_ != 0 && left_ < POLL_INTERVAL)? left_ : POLL_INTERVAL;
+					return budget_;
+				}
+
+				// The CPU is complete, curCmd is the next command
+				size_t poll(MyStd1::_command::CPU& cpu)
+				{
+					if (options_.every != 0) left_ -= budget_;
+
+					if (left_ == 0 && options_.every != 0) left_ = options_.every;
+					else if (requested() == 0) return budget();
+
+					requested() = 0;
+					write(options_.filename, cpu, identity_);
+
+					return budget();
+				}
+
+		private:
+			// Variables:
+				Options  options_;
+				Identity identity_;
+				size_t   left_;
+				size_t   budget_;
+		};
+
+	} // namespace _snapshot
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_SNAPSHOT_HPP_INCLUDED*/
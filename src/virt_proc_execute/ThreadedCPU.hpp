@@ -0,0 +1,793 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_THREADED_CPU_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_THREADED_CPU_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "CPU.hpp"
+#include "Fusion.hpp"
+#include "Verifier.hpp"
+
+// Defines:
+
+#define FILENAME "std1/ThreadedCPU.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Computed goto is a GNU extension, other compilers get a switch
+#if defined(__GNUC__) || defined(__clang__)
+	#define THREADED_CPU_COMPUTED_GOTO
+#endif
+
+// Code:
+
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+	namespace _threaded
+	{
+		using MyStd1::Val_t;
+		namespace _values = MyStd1::_values;
+
+		// cpu.curCmd before anything is marked, an overflow there has no position
+		const MyStd1::CmdNum_t NO_CMD = std::numeric_limits<MyStd1::CmdNum_t>::max();
+
+		// Runs both plain and fused programmes.
+		// The top of the value stack lives in a local (tos), the values under it are in the storage
+		// of cpu.valSt and the depth is counted locally, so SP is written to the CPU only on the way out.
+		// Nothing compares the depth with the size of the stack: the stacks grow on their own and
+		// an overflow is a write to the guard page (see GrowableStack.hpp). So run may be left with
+		// siglongjmp and keeps no objects with destructors, the handler table is the caller's.
+		// Unchecked mode is for verified programmes (see Verifier.hpp), it has no empty, register
+		// and frame checks. The run starts at cpu.curCmd, with SNAPSHOTS it counts the commands for the schedule.
+		// SAMPLED writes cpu.curCmd for the sampler (see Sampler.hpp) at the start of every basic block only,
+		// a store on every dispatch costs more than the samples are worth. Runtime errors write their own
+		// command, but an overflow is a signal: every run marks CALL and, in checked mode, the pushes, so it
+		// is reported at the last of them, not at the command that hit the guard page.
+		template <bool CHECKED, bool SNAPSHOTS = false, bool SAMPLED = false>
+		void run(const _program::Program& program, MyStd1::_command::CPU& cpu, std::vector<const void*>& handlers,
+		         _snapshot::Schedule* schedule = nullptr)
+		{
+			using namespace MyStd1::_command;
+			using namespace _fusion;
+			using MyStd1::_registers::REGISTER_COUNT;
+			using MyStd1::_registers::BP_REGISTER_I;
+			using MyStd1::_registers::SP_REGISTER_I;
+
+			const _program::Instruction* code = program.code.data();
+			const size_t size = program.code.size();
+
+			_program::checkJumpTargets(program);
+
+			size_t pc = cpu.curCmd;
+			if (!SAMPLED) cpu.curCmd = NO_CMD;
+			size_t budget = SNAPSHOTS? schedule->budget() : 0;
+
+			Val_t* stack = cpu.valSt.data();
+			size_t depth = cpu.valSt.filledSize();
+			Val_t* below = stack + depth; // First free slot under tos
+
+			Val_t tos = (depth != 0)? *--below : 0;
+
+			// Element of the value stack by its address, address < depth
+			auto stackAt = [stack, &depth, &tos](size_t address) -> Val_t&
+			{
+				return (address + 1 == depth)? tos : stack[address];
+			};
+
+			// Puts the cached top back, the CPU is complete after that
+			auto spillTos = [&cpu, &depth, &tos, &below]()
+			{
+				if (depth != 0) *below++ = tos;
+				cpu.valSt.setFilledSize(depth);
+				cpu.updateSp();
+			};
+
+			auto reloadTos = [&depth, &tos, &below]()
+			{
+				if (depth != 0) tos = *--below;
+			};
+
+			#ifdef THREADED_CPU_COMPUTED_GOTO
+
+				// Indexed by CmdCode
+				static const void* const LABELS[] =
+				{
+					&&L_CMD_BEG,   &&L_CMD_END,   &&L_CMD_PUSH,  &&L_CMD_PUSHR, &&L_CMD_POP,
+					&&L_CMD_POPR,  &&L_CMD_ADD,   &&L_CMD_SUB,   &&L_CMD_MUL,   &&L_CMD_DIV,
+					&&L_CMD_SQRT,  &&L_CMD_OUT,   &&L_CMD_IN,    &&L_CMD_JMP,   &&L_CMD_JE,
+					&&L_CMD_JNE,   &&L_CMD_JA,    &&L_CMD_JAE,   &&L_CMD_JB,    &&L_CMD_JBE,
+					&&L_CMD_CALL,  &&L_CMD_RET,   &&L_CMD_DUMP,  &&L_CMD_PRINT, &&L_CMD_IS_L,
+					&&L_CMD_IS_LE, &&L_CMD_IS_M,  &&L_CMD_IS_ME, &&L_CMD_IS_E,  &&L_CMD_IS_NE,
+					&&L_CMD_AND,   &&L_CMD_OR,    &&L_CMD_PUSHM, &&L_CMD_POPM,  &&L_CMD_TAILCALL,
+					&&L_CMD_ALLOCM, &&L_CMD_PUSHMI, &&L_CMD_POPMI, &&L_CMD_NEWARR, &&L_CMD_LOADA, &&L_CMD_STOREA,
+					&&L_CMD_REFM,  &&L_CMD_VADD,  &&L_CMD_VSUB,  &&L_CMD_VMUL,  &&L_CMD_VDIV,
+					&&L_CMD_VFMA,  &&L_CMD_VDOT,  &&L_CMD_VSUM,  &&L_CMD_VMIN,  &&L_CMD_VMAX,
+					&&L_CMD_SIN,   &&L_CMD_COS,   &&L_CMD_EXP,   &&L_CMD_LOG,   &&L_CMD_POW,
+					&&L_CMD_ABS,   &&L_CMD_FLOOR, &&L_CMD_MIN,   &&L_CMD_MAX,
+
+					&&L_FUSED_PUSHM_PUSHM_ADD, &&L_FUSED_PUSHM_PUSHM_SUB, &&L_FUSED_PUSHM_PUSHM_MUL,
+					&&L_FUSED_IF, &&L_FUSED_WHILE, &&L_FUSED_NEW_FRAME, &&L_FUSED_DROP_FRAME
+				};
+
+				static_assert(sizeof(LABELS) / sizeof(*LABELS) == FUSED_COMMAND_COUNT, "Every command needs a label");
+
+				// Direct threading: handler address of every instruction, the last one stops the machine
+				handlers.resize(size + 1);
+				for (size_t i = 0; i < size; ++i) handlers[i] = LABELS[code[i].cmd];
+				handlers[size] = &&halt;
+
+				#define TARGET(cmd) L_##cmd:
+				#define DISPATCH_UNPOLLED() goto *handlers[pc]
+
+			#else
+
+				#define TARGET(cmd) case cmd:
+				#define DISPATCH_UNPOLLED() goto dispatch
+
+			#endif
+
+			#define DISPATCH()                                                     \
+				if (SNAPSHOTS && --budget == 0) goto snapshot;                     \
+				DISPATCH_UNPOLLED()
+
+			#define MARK_BLOCK() if (SAMPLED) cpu.curCmd = static_cast<MyStd1::CmdNum_t>(pc)
+
+			// Where an overflow can start
+			#define MARK_OVERFLOW() cpu.curCmd = static_cast<MyStd1::CmdNum_t>(pc)
+
+			#define NEXT() ++pc; DISPATCH()
+			#define NEXT_BLOCK() ++pc; MARK_BLOCK(); DISPATCH()
+			#define JUMP(toJump) pc = (toJump); MARK_BLOCK(); DISPATCH()
+
+			#define FAIL(message, cmd_name)                                        \
+				{                                                                  \
+					cpu.curCmd = static_cast<MyStd1::CmdNum_t>(pc);                \
+					throw Exception(message, "", cmd_name, 0);                     \
+				}
+
+			// Compiled out in unchecked mode
+			#define CHECK(condition, message, cmd_name)                            \
+				if constexpr (CHECKED)                                             \
+				{                                                                  \
+					if (condition) FAIL(message, cmd_name);                        \
+				}
+
+			#define THROW_IF_EMPTY(cmd_name) CHECK(depth == 0, "Value stack is empty!", cmd_name)
+
+			#define PUSH_OPERAND(value)                                            \
+				{                                                                  \
+					Val_t toPush = (value);                                        \
+					if constexpr (CHECKED) MARK_OVERFLOW();                        \
+					if (depth++ != 0) *below++ = tos;                              \
+					tos = toPush;                                                  \
+				}
+
+			#define POP_OPERAND(var, cmd_name)                                     \
+				THROW_IF_EMPTY(cmd_name);                                          \
+				Val_t var = tos;                                                   \
+				if (--depth != 0) tos = *--below
+
+			// One pop from the stack instead of two pops and a push
+			#define BINARY_OPERATOR(cmd, cmd_name, piece_of_code)                  \
+				TARGET(cmd)                                                        \
+				{                                                                  \
+					CHECK(depth < 2, "Value stack is empty!", cmd_name);           \
+					Val_t r = tos;                                                 \
+					Val_t l = *--below;                                            \
+					--depth;                                                       \
+					tos = (piece_of_code);                                         \
+					NEXT();                                                        \
+				}
+
+			#define UNARY_FUNCTION(cmd, cmd_name, piece_of_code)                   \
+				TARGET(cmd)                                                        \
+				{                                                                  \
+					THROW_IF_EMPTY(cmd_name);                                      \
+					Val_t x = tos;                                                 \
+					tos = (piece_of_code);                                         \
+					NEXT();                                                        \
+				}
+
+			// pushm a / pushm b / op, b may be the value pushed by the first pushm
+			#define PUSHM_PUSHM_OPERATOR(cmd, piece_of_code)                                         \
+				TARGET(cmd)                                                                          \
+				{                                                                                    \
+					size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);              \
+					                                                                                 \
+					size_t lAddress = bp + code[pc].arg.memAdr;                                      \
+					CHECK(lAddress >= depth, "Access out of stack", "PUSHM");                        \
+					Val_t l = stackAt(lAddress);                                                     \
+					                                                                                 \
+					size_t rAddress = bp + code[pc + 1].arg.memAdr;                                  \
+					CHECK(rAddress > depth, "Access out of stack", "PUSHM");                         \
+					Val_t r = (rAddress == depth)? l : stackAt(rAddress);                            \
+					                                                                                 \
+					PUSH_OPERAND(piece_of_code);                                                     \
+					pc += 3;                                                                         \
+					DISPATCH();                                                                      \
+				}
+
+			// The command finds the CPU complete and reports its errors at pc
+			#define VECTOR_COMMAND(cmd, class_name)                                \
+				TARGET(cmd)                                                        \
+				{                                                                  \
+					spillTos();                                                    \
+					                                                               \
+					MyStd1::CmdNum_t marked = cpu.curCmd;                          \
+					cpu.curCmd = static_cast<MyStd1::CmdNum_t>(pc);                \
+					class_name{}.execute(cpu);                                     \
+					cpu.curCmd = marked;                                           \
+					                                                               \
+					depth = cpu.valSt.filledSize();                                \
+					below = stack + depth;                                         \
+					reloadTos();                                                   \
+					NEXT();                                                        \
+				}
+
+			#define COND_JUMP(cmd, cmd_name, jump_condition)                       \
+				TARGET(cmd)                                                        \
+				{                                                                  \
+					CHECK(depth < 2, "Value stack is empty!", cmd_name);           \
+					Val_t r = tos;                                                 \
+					Val_t l = *--below;                                            \
+					depth -= 2;                                                    \
+					if (depth != 0) tos = *--below;                                \
+					if (jump_condition) { JUMP(code[pc].arg.cmdNum); }             \
+					NEXT_BLOCK();                                                  \
+				}
+
+			DISPATCH();
+
+			#ifndef THREADED_CPU_COMPUTED_GOTO
+			dispatch:
+				if (pc >= size) goto halt;
+
+				switch (code[pc].cmd)
+				{
+			#endif
+
+				// Entry and end points of the program:
+
+					TARGET(CMD_BEG)
+					{
+						NEXT();
+					}
+
+					TARGET(CMD_END)
+					{
+						spillTos();
+						CmdEnd{}.execute(cpu);
+						return;
+					}
+
+				// Stack operations:
+
+					TARGET(CMD_PUSH)
+					{
+						PUSH_OPERAND(code[pc].arg.value);
+						NEXT();
+					}
+
+					TARGET(CMD_PUSHR)
+					{
+						MyStd1::RegAdr_t regAdr = code[pc].arg.regAdr;
+						CHECK(regAdr >= REGISTER_COUNT, "Unable to find the register!", "PUSHR");
+
+						// SP is only materialised here
+						PUSH_OPERAND((regAdr == SP_REGISTER_I)? static_cast<Val_t>(depth) : cpu.regs[regAdr]);
+						NEXT();
+					}
+
+					TARGET(CMD_POP)
+					{
+						POP_OPERAND(popped, "POP");
+						(void) popped;
+
+						NEXT();
+					}
+
+					TARGET(CMD_POPR)
+					{
+						THROW_IF_EMPTY("POPR");
+
+						MyStd1::RegAdr_t regAdr = code[pc].arg.regAdr;
+						CHECK(regAdr >= REGISTER_COUNT, "Unable to find the register!", "POPR");
+
+						POP_OPERAND(popped, "POPR");
+						cpu.regs[regAdr] = popped;
+						NEXT();
+					}
+
+				// Arithmetics:
+
+					BINARY_OPERATOR(CMD_ADD, "ADD", _values::add(l, r))
+					BINARY_OPERATOR(CMD_SUB, "SUB", _values::sub(l, r))
+					BINARY_OPERATOR(CMD_MUL, "MUL", _values::mul(l, r))
+
+					TARGET(CMD_DIV)
+					{
+						THROW_IF_EMPTY("DIV");
+
+						if (_values::isZero(tos))
+						{
+							FAIL("Unable to divide by 0!", "DIV");
+						}
+
+						CHECK(depth < 2, "Value stack is empty!", "DIV");
+
+						Val_t divisor = tos;
+						--depth;
+						tos = _values::div(*--below, divisor);
+						NEXT();
+					}
+
+					TARGET(CMD_SQRT)
+					{
+						THROW_IF_EMPTY("SQRT");
+
+						if (tos < 0) FAIL("Root of negative number doesn't exist", "SQRT");
+
+						tos = _values::fromReal(std::sqrt(tos));
+						NEXT();
+					}
+
+					UNARY_FUNCTION(CMD_SIN,   "SIN",   _values::fromReal(std::sin(x)))
+					UNARY_FUNCTION(CMD_COS,   "COS",   _values::fromReal(std::cos(x)))
+					UNARY_FUNCTION(CMD_EXP,   "EXP",   _values::fromReal(std::exp(x)))
+					UNARY_FUNCTION(CMD_ABS,   "ABS",   _values::abs(x))
+					UNARY_FUNCTION(CMD_FLOOR, "FLOOR", _values::fromReal(std::floor(x)))
+
+					BINARY_OPERATOR(CMD_MIN, "MIN", _values::min(l, r))
+					BINARY_OPERATOR(CMD_MAX, "MAX", _values::max(l, r))
+
+					TARGET(CMD_LOG)
+					{
+						THROW_IF_EMPTY("LOG");
+
+						if (!(tos > 0)) FAIL("Logarithm of non-positive number doesn't exist", "LOG");
+
+						tos = _values::fromReal(std::log(tos));
+						NEXT();
+					}
+
+					TARGET(CMD_POW)
+					{
+						CHECK(depth < 2, "Value stack is empty!", "POW");
+
+						Val_t power = 0;
+						if (!_values::pow(below[-1], tos, power)) FAIL("Power is not a real number", "POW");
+
+						--below;
+						--depth;
+						tos = power;
+						NEXT();
+					}
+
+				// IO:
+
+					TARGET(CMD_OUT)
+					{
+						POP_OPERAND(popped, "OUT");
+
+						cpu.out.value(popped);
+						NEXT();
+					}
+
+					TARGET(CMD_IN)
+					{
+						if (cpu.in.interactive()) cpu.out.flush();
+
+						Val_t toRead = cpu.in.next();
+
+						PUSH_OPERAND(toRead);
+						NEXT();
+					}
+
+				// Jumps:
+
+					TARGET(CMD_JMP)
+					{
+						JUMP(code[pc].arg.cmdNum);
+					}
+
+					COND_JUMP(CMD_JE,  "JE",   _values::equal(l, r))
+					COND_JUMP(CMD_JNE, "JNE", !_values::equal(l, r))
+					COND_JUMP(CMD_JA,  "JA",  l >  r)
+					COND_JUMP(CMD_JAE, "JAE", l >= r)
+					COND_JUMP(CMD_JB,  "JB",  l <  r)
+					COND_JUMP(CMD_JBE, "JBE", l <= r)
+
+				// Function support:
+
+					TARGET(CMD_CALL)
+					{
+						MARK_OVERFLOW();
+						cpu.callSt.push(static_cast<MyStd1::CmdNum_t>(pc));
+						JUMP(code[pc].arg.cmdNum);
+					}
+
+					TARGET(CMD_RET)
+					{
+						CHECK(cpu.callSt.empty(), "RET: Call stack is empty", "");
+
+						pc = cpu.callSt.pop();
+						NEXT_BLOCK();
+					}
+
+				// Dump:
+
+					TARGET(CMD_DUMP)
+					{
+						spillTos();
+						CmdDump{}.execute(cpu);
+						reloadTos();
+						NEXT();
+					}
+
+					TARGET(CMD_PRINT)
+					{
+						POP_OPERAND(popped, "PRINT");
+
+						cpu.out.value(popped);
+						NEXT();
+					}
+
+				// Comparison:
+
+					BINARY_OPERATOR(CMD_IS_L,  "IS_L",  (l <  r)? 1 : -1)
+					BINARY_OPERATOR(CMD_IS_LE, "IS_LE", (l <= r)? 1 : -1)
+					BINARY_OPERATOR(CMD_IS_M,  "IS_M",  (l >  r)? 1 : -1)
+					BINARY_OPERATOR(CMD_IS_ME, "IS_ME", (l >= r)? 1 : -1)
+					BINARY_OPERATOR(CMD_IS_E,  "IS_E",  (l == r)? 1 : -1)
+					BINARY_OPERATOR(CMD_IS_NE, "IS_NE", (l != r)? 1 : -1)
+					BINARY_OPERATOR(CMD_AND,   "AND",   (l > 0 && r > 0)? 1 : -1)
+					BINARY_OPERATOR(CMD_OR,    "OR",    (l > 0 || r > 0)? 1 : -1)
+
+				// Memory operations:
+
+					TARGET(CMD_PUSHM)
+					{
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "PUSHM");
+
+						PUSH_OPERAND(stackAt(address));
+						NEXT();
+					}
+
+					TARGET(CMD_POPM)
+					{
+						THROW_IF_EMPTY("POPM");
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "POPM");
+
+						// Storing to the top of the stack leaves the value where it is
+						if (address + 1 < depth)
+						{
+							POP_OPERAND(popped, "POPM");
+							stackAt(address) = popped;
+						}
+
+						NEXT();
+					}
+
+					TARGET(CMD_TAILCALL)
+					{
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t argCount = code[pc].arg.memAdr;
+						CHECK(bp + argCount > depth, "Access out of stack", "TAILCALL");
+
+						if (depth != 0) *below = tos;
+						for (size_t i = 0; i < argCount; ++i) stack[bp + i] = stack[depth - argCount + i];
+
+						depth = bp + argCount;
+						below = stack + depth;
+						reloadTos();
+						NEXT();
+					}
+
+				// Arrays, the indices and the sizes are checked in every mode:
+
+					TARGET(CMD_ALLOCM)
+					{
+						POP_OPERAND(size, "ALLOCM");
+
+						size_t length = 0;
+						if (!MyStd1::_arrays::toLength(size, length)) FAIL("Bad array size", "ALLOCM");
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address > depth, "Access out of stack", "ALLOCM");
+
+						if (address + 1 + length > cpu.valSt.maxSize()) FAIL("Value stack is full!", "ALLOCM");
+
+						if (depth != 0) *below = tos;
+						stack[address] = static_cast<Val_t>(length);
+						std::fill(stack + address + 1, stack + address + 1 + length, 0);
+
+						depth = std::max(depth, address + 1 + length);
+						below = stack + depth;
+						reloadTos();
+						NEXT();
+					}
+
+					TARGET(CMD_PUSHMI)
+					{
+						THROW_IF_EMPTY("PUSHMI");
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address + 1 >= depth, "Access out of stack", "PUSHMI");
+
+						size_t index = 0;
+						if (!MyStd1::_arrays::toIndex(tos, stack[address], index)) FAIL("Index out of array", "PUSHMI");
+
+						CHECK(address + 2 + index >= depth, "Access out of stack", "PUSHMI");
+
+						tos = stack[address + 1 + index];
+						NEXT();
+					}
+
+					TARGET(CMD_POPMI)
+					{
+						CHECK(depth < 2, "Value stack is empty!", "POPMI");
+
+						Val_t value = tos;
+						Val_t indexValue = *--below;
+						depth -= 2;
+						reloadTos();
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "POPMI");
+
+						size_t index = 0;
+						if (!MyStd1::_arrays::toIndex(indexValue, stackAt(address), index)) FAIL("Index out of array", "POPMI");
+
+						CHECK(address + 1 + index >= depth, "Access out of stack", "POPMI");
+
+						stackAt(address + 1 + index) = value;
+						NEXT();
+					}
+
+					TARGET(CMD_NEWARR)
+					{
+						POP_OPERAND(size, "NEWARR");
+
+						size_t length = 0;
+						if (!MyStd1::_arrays::toLength(size, length)) FAIL("Bad array size", "NEWARR");
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address > depth, "Access out of stack", "NEWARR");
+
+						Val_t handle = cpu.arrays.allocate(length, address);
+						if (handle == 0) FAIL("Not enough memory for the array", "NEWARR");
+
+						if (address == depth) PUSH_OPERAND(handle)
+						else                  stackAt(address) = handle;
+
+						NEXT();
+					}
+
+					TARGET(CMD_LOADA)
+					{
+						THROW_IF_EMPTY("LOADA");
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "LOADA");
+
+						const MyStd1::_arrays::View* array = cpu.arrays.find(stackAt(address));
+						if (array == nullptr) FAIL("Not an array", "LOADA");
+
+						size_t index = 0;
+						if (!MyStd1::_arrays::toIndex(tos, static_cast<Val_t>(array->size), index)) FAIL("Index out of array", "LOADA");
+
+						tos = array->data[index];
+						NEXT();
+					}
+
+					TARGET(CMD_STOREA)
+					{
+						CHECK(depth < 2, "Value stack is empty!", "STOREA");
+
+						Val_t value = tos;
+						Val_t indexValue = *--below;
+						depth -= 2;
+						reloadTos();
+
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "STOREA");
+
+						const MyStd1::_arrays::View* array = cpu.arrays.find(stackAt(address));
+						if (array == nullptr) FAIL("Not an array", "STOREA");
+
+						size_t index = 0;
+						if (!MyStd1::_arrays::toIndex(indexValue, static_cast<Val_t>(array->size), index)) FAIL("Index out of array", "STOREA");
+
+						array->data[index] = value;
+						NEXT();
+					}
+
+				// Vector commands loop over whole arrays, they run the commands of the classic engine:
+
+					TARGET(CMD_REFM)
+					{
+						size_t bp = static_cast<MyStd1::MemAdr_t>(cpu.regs[BP_REGISTER_I]);
+						size_t address = bp + code[pc].arg.memAdr;
+						CHECK(address >= depth, "Access out of stack", "REFM");
+
+						PUSH_OPERAND(MyStd1::_arrays::frameReference(address));
+						NEXT();
+					}
+
+					VECTOR_COMMAND(CMD_VADD, CmdVAdd)
+					VECTOR_COMMAND(CMD_VSUB, CmdVSub)
+					VECTOR_COMMAND(CMD_VMUL, CmdVMul)
+					VECTOR_COMMAND(CMD_VDIV, CmdVDiv)
+					VECTOR_COMMAND(CMD_VFMA, CmdVFma)
+					VECTOR_COMMAND(CMD_VDOT, CmdVDot)
+					VECTOR_COMMAND(CMD_VSUM, CmdVSum)
+					VECTOR_COMMAND(CMD_VMIN, CmdVMin)
+					VECTOR_COMMAND(CMD_VMAX, CmdVMax)
+
+				// Superinstructions (see Fusion.hpp):
+
+					PUSHM_PUSHM_OPERATOR(FUSED_PUSHM_PUSHM_ADD, _values::add(l, r))
+					PUSHM_PUSHM_OPERATOR(FUSED_PUSHM_PUSHM_SUB, _values::sub(l, r))
+					PUSHM_PUSHM_OPERATOR(FUSED_PUSHM_PUSHM_MUL, _values::mul(l, r))
+
+					TARGET(FUSED_IF)
+					{
+						POP_OPERAND(condition, "JA");
+
+						JUMP((condition > 0)? code[pc + 1].arg.cmdNum : code[pc + 2].arg.cmdNum);
+					}
+
+					TARGET(FUSED_WHILE)
+					{
+						POP_OPERAND(condition, "JB");
+
+						if (condition < 0) { JUMP(code[pc + 1].arg.cmdNum); }
+
+						pc += 2;
+						MARK_BLOCK();
+						DISPATCH();
+					}
+
+					TARGET(FUSED_NEW_FRAME)
+					{
+						cpu.regs[BP_REGISTER_I] = static_cast<Val_t>(depth) - code[pc + 1].arg.value;
+
+						pc += 4;
+						DISPATCH();
+					}
+
+					TARGET(FUSED_DROP_FRAME)
+					{
+						while (true)
+						{
+							if (static_cast<Val_t>(depth) <= cpu.regs[BP_REGISTER_I])
+							{
+								JUMP(code[pc + 2].arg.cmdNum);
+							}
+
+							POP_OPERAND(popped, "POP");
+							(void) popped;
+						}
+					}
+
+			#ifndef THREADED_CPU_COMPUTED_GOTO
+					default: throw Exception("Unknown command number", PROGRAM_POS);
+				}
+			#endif
+
+			// The CPU is made complete for the snapshot
+			snapshot:
+				{
+					MyStd1::CmdNum_t marked = cpu.curCmd;
+					cpu.curCmd = static_cast<MyStd1::CmdNum_t>(pc);
+					spillTos();
+					budget = schedule->poll(cpu);
+					cpu.curCmd = marked;
+					reloadTos();
+					DISPATCH_UNPOLLED();
+				}
+
+			halt:
+				spillTos();
+				return;
+
+			#undef CHECK
+			#undef FAIL
+			#undef TARGET
+			#undef DISPATCH
+			#undef DISPATCH_UNPOLLED
+			#undef MARK_BLOCK
+			#undef MARK_OVERFLOW
+			#undef NEXT
+			#undef NEXT_BLOCK
+			#undef JUMP
+			#undef THROW_IF_EMPTY
+			#undef PUSH_OPERAND
+			#undef POP_OPERAND
+			#undef BINARY_OPERATOR
+			#undef COND_JUMP
+			#undef PUSHM_PUSHM_OPERATOR
+			#undef VECTOR_COMMAND
+			#undef UNARY_FUNCTION
+		}
+
+		// Picks the instantiation of run for the schedule and the sampler
+		template <bool CHECKED>
+		void runWith(const _program::Program& program, MyStd1::_command::CPU& cpu, std::vector<const void*>& handlers,
+		             _snapshot::Schedule* schedule, bool sampled)
+		{
+			if (schedule != nullptr)
+			{
+				if (sampled) run<CHECKED, true, true>(program, cpu, handlers, schedule);
+				else         run<CHECKED, true>      (program, cpu, handlers, schedule);
+			}
+			else if (sampled) run<CHECKED, false, true>(program, cpu, handlers);
+			else              run<CHECKED>             (program, cpu, handlers);
+		}
+
+	} // namespace _threaded
+
+	void executeThreaded(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	                     MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, MyStd1::_input::Source input = {},
+	                     _snapshot::Options snapshots = {}, unsigned sampleRate = 0)
+	{
+		_program::Program program{_program::load(filename)};
+
+		_snapshot::Identity identity{};
+		if (snapshots.any()) identity = _snapshot::identify(program.code.data(), program.code.size());
+
+		// Fusion keeps the stack effect of every sequence, so the proof holds for the fused programme.
+		// It is made for runs from the entry point, a resumed one is checked.
+		_verifier::Report report{_verifier::verify(program)};
+		bool unchecked = report.verified && snapshots.resume == nullptr;
+
+		_fusion::fuse(program);
+
+		MyStd1::_command::CPU cpu{sizes, format, input};
+		_command::start(program, cpu, snapshots, identity);
+
+		std::unique_ptr<_snapshot::Schedule> schedule;
+		if (snapshots.filename != nullptr) schedule = std::make_unique<_snapshot::Schedule>(snapshots, identity);
+
+		std::vector<const void*> handlers;
+
+		try
+		{
+			_sampler::runSampled(sampleRate, filename, cpu, [&]()
+			{
+				runCatchingOverflow([&]()
+				{
+					if (unchecked) _threaded::runWith<false>(program, cpu, handlers, schedule.get(), sampleRate != 0);
+					else           _threaded::runWith<true> (program, cpu, handlers, schedule.get(), sampleRate != 0);
+				});
+			});
+		}
+		catch (Exception& exc)
+		{
+			rethrowRuntimeError(filename, program, cpu, exc);
+		}
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_THREADED_CPU_HPP_INCLUDED*/
@@ -0,0 +1,394 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_TRACE_JIT_CPU_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_TRACE_JIT_CPU_HPP_INCLUDED
+
+// Includes:
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <limits>
+
+#include "CPU.hpp"
+#include "JitCPU.hpp"
+
+// Defines:
+
+#define FILENAME "std1/TraceJitCPU.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+// --jit=trace: the classic interpreter counts the backward jumps to every command. When a loop head
+// gets HOT_LOOP of them, the next pass of the loop is recorded command by command and compiled to
+// native code with the path it took: jumps disappear, calls only push their return addresses and
+// every conditional jump becomes a guard that leaves the trace to the interpreter at the command of
+// the other path. The trace runs on the stacks of the CPU, so leaving it costs the registers only.
+// A pass that leaves the loop is recorded again later, MAX_ATTEMPTS times at most. Loops with inner
+// loops, too long passes or commands the JIT leaves to the interpreter end up in the interpreter.
+namespace EmulatedProcessorStd1
+{
+	using namespace MyExceptionCharStringRepresentation;
+
+#ifdef JIT_CPU_X86_64
+
+	namespace _trace
+	{
+		using MyStd1::CmdNum_t;
+		using _jit::JitState;
+		using _jit::ExitCode;
+
+		const uint32_t HOT_LOOP     = 64;   // Backward jumps to a loop head before its pass is recorded
+		const uint8_t  MAX_ATTEMPTS = 4;    // Recorded passes that didn't come back to the head
+		const size_t   MAX_TRACE    = 1024; // Commands of a trace
+		const uint32_t BLACKLISTED  = std::numeric_limits<uint32_t>::max();
+
+		// Command of the recorded pass and the one run after it
+		struct Step
+		{
+		public:
+			// Variables:
+				CmdNum_t pc;
+				CmdNum_t next;
+		};
+
+		bool isJump(MyStd1::Cmd_t cmd)
+		{
+			using namespace MyStd1::_command;
+
+			return cmd == CMD_JMP || cmd == CMD_JE || cmd == CMD_JNE || cmd == CMD_JA ||
+			       cmd == CMD_JAE || cmd == CMD_JB || cmd == CMD_JBE;
+		}
+
+		//-----------------------------------------------------------------------------
+
+		class TraceCompiler : private _jit::CodeGen
+		{
+		public:
+			// Ctor:
+				explicit TraceCompiler(const _program::Program& program) :
+					CodeGen     (program),
+					exitFixups_ ()
+				{}
+
+			// Functions:
+				// Empty code when the pass has a command the JIT leaves to the interpreter,
+				// the loop starts at loopOff
+				std::vector<unsigned char> compile(const std::vector<Step>& steps, size_t& loopOff)
+				{
+					using namespace MyStd1::_command;
+
+					emitPrologue();
+					loopOff = e_.size();
+
+					for (const Step& step : steps)
+					{
+						const _program::Instruction& instr = program_.code[step.pc];
+
+						switch (instr.cmd)
+						{
+							case CMD_JMP: break;
+
+							case CMD_JE:
+							case CMD_JNE:
+							case CMD_JA:
+							case CMD_JAE:
+							case CMD_JB:
+							case CMD_JBE:
+							{
+								E::Cond taken = emitJumpCondition(step.pc);
+
+								if (instr.arg.cmdNum == step.pc + 1) break; // Both paths are the same
+
+								if (step.next == instr.arg.cmdNum) exitIf(inverse(taken), step.pc + 1);
+								else                               exitIf(taken, instr.arg.cmdNum);
+								break;
+							}
+
+							case CMD_CALL:
+							{
+								e_.cmpRegMem(CALL_TOP, STATE, offsetof(JitState, callLimit));
+								errorIf(E::CC_AE, step.pc, _jit::ERR_CALL_OVERFLOW);
+
+								e_.mov32MemImm(CALL_TOP, 0, step.pc);
+								e_.addRegImm(CALL_TOP, sizeof(uint32_t));
+								break;
+							}
+
+							// The recorder keeps the RETs of the CALLs of the trace only
+							case CMD_RET: e_.subRegImm(CALL_TOP, sizeof(uint32_t)); break;
+
+							default:
+							{
+								if (!emitOperation(step.pc)) return {};
+								break;
+							}
+						}
+					}
+
+					e_.patchRel32(e_.jmpRel32(), loopOff);
+
+					epilogue_ = e_.size();
+					emitEpilogue();
+					emitErrorExits();
+
+					for (const auto& fixup : exitFixups_)
+					{
+						e_.patchRel32(fixup.at, e_.size());
+						emitExit(_jit::EXIT_INTERPRET, fixup.pc);
+					}
+
+					return e_.bytes;
+				}
+
+		private:
+			// Types:
+				struct ExitFixup { size_t at; uint32_t pc; };
+
+			// Variables:
+				std::vector<ExitFixup> exitFixups_;
+
+			// Functions:
+				// x86 conditions come in pairs that differ in the lowest bit
+				static E::Cond inverse(E::Cond cc)
+				{
+					return static_cast<E::Cond>(cc ^ 1);
+				}
+
+				void exitIf(E::Cond cc, uint32_t pc)
+				{
+					exitFixups_.push_back({e_.jccRel32(cc), pc});
+				}
+		};
+
+		class Trace
+		{
+		public:
+			// Ctor:
+				Trace(const std::vector<unsigned char>& code, size_t loopOff) :
+					buffer_ (code),
+					loop_   (buffer_.data() + loopOff)
+				{}
+
+			// Functions:
+				ExitCode run(JitState& state) const
+				{
+					using EntryFunc = uint32_t (*)(JitState*, const void*);
+
+					EntryFunc entry = reinterpret_cast<EntryFunc>(const_cast<unsigned char*>(buffer_.data()));
+
+					return static_cast<ExitCode>(entry(&state, loop_));
+				}
+
+		private:
+			// Variables:
+				_jit::ExecutableBuffer buffer_;
+				const void* loop_;
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// Counts the loops, records their passes and keeps the traces
+		class Recorder
+		{
+		public:
+			// Ctor:
+				explicit Recorder(const _program::Program& program) :
+					program_  (program),
+					counters_ (program.code.size(), 0),
+					attempts_ (program.code.size(), 0),
+					traces_   (program.code.size()),
+					steps_    (),
+					head_     (0),
+					calls_    (0),
+					active_   (false)
+				{}
+
+			// Functions:
+				// After the command pc, next is the one to run. Returns the trace to run from next
+				const Trace* step(CmdNum_t pc, CmdNum_t next)
+				{
+					bool backward = next <= pc && isJump(program_.code[pc].cmd);
+
+					if (active_)
+					{
+						record(pc, next, backward);
+						if (active_ || next != head_) return nullptr;
+					}
+					else if (backward && counters_[next] != BLACKLISTED && ++counters_[next] == HOT_LOOP)
+					{
+						if (traces_[next] == nullptr) start(next);
+						return nullptr;
+					}
+					else if (!backward) return nullptr;
+
+					return traces_[next].get();
+				}
+
+		private:
+			// Variables:
+				const _program::Program& program_;
+				std::vector<uint32_t> counters_; // Backward jumps to every command
+				std::vector<uint8_t>  attempts_;
+				std::vector<std::unique_ptr<Trace>> traces_; // By loop heads
+
+				std::vector<Step> steps_;
+				CmdNum_t head_;
+				size_t   calls_;  // CALLs of the pass without their RETs yet
+				bool     active_;
+
+			// Functions:
+				void start(CmdNum_t head)
+				{
+					steps_.clear();
+					head_   = head;
+					calls_  = 0;
+					active_ = true;
+				}
+
+				void finish()
+				{
+					active_ = false;
+
+					size_t loopOff = 0;
+					std::vector<unsigned char> code{TraceCompiler{program_}.compile(steps_, loopOff)};
+
+					if (code.empty()) counters_[head_] = BLACKLISTED;
+					else              traces_[head_] = std::make_unique<Trace>(code, loopOff);
+				}
+
+				// The loop may come back on a later pass
+				void abandon()
+				{
+					active_ = false;
+
+					counters_[head_] = (++attempts_[head_] == MAX_ATTEMPTS)? BLACKLISTED : 0;
+				}
+
+				void record(CmdNum_t pc, CmdNum_t next, bool backward)
+				{
+					using namespace MyStd1::_command;
+
+					MyStd1::Cmd_t cmd = program_.code[pc].cmd;
+
+					if (cmd == CMD_CALL) ++calls_;
+					if (cmd == CMD_RET)
+					{
+						// The loop is left by a return
+						if (calls_ == 0) return abandon();
+						--calls_;
+					}
+
+					// An inner loop or a path that doesn't come back
+					if ((backward && next != head_) || steps_.size() == MAX_TRACE) return abandon();
+
+					steps_.push_back({pc, next});
+
+					if (next != head_) return;
+
+					if (calls_ == 0) finish();
+					else             abandon();
+				}
+		};
+
+		//-----------------------------------------------------------------------------
+
+		// The trace works on the stacks of the CPU, its limits are the maximal sizes
+		void runTrace(const Trace& trace, const _program::Program& program, MyStd1::_command::CPU& cpu)
+		{
+			JitState state{};
+			state.valBase   = cpu.valSt.data();
+			state.valTop    = state.valBase + cpu.valSt.filledSize();
+			state.valLimit  = state.valBase + cpu.valSt.maxSize();
+			state.callBase  = cpu.callSt.data();
+			state.callTop   = state.callBase + cpu.callSt.filledSize();
+			state.callLimit = state.callBase + cpu.callSt.maxSize();
+			state.arrays     = cpu.arrays.views();
+			state.arrayCount = cpu.arrays.tableSize();
+
+			for (size_t i = 0; i < MyStd1::_registers::REGISTER_COUNT; ++i) state.regs[i] = cpu.regs[i];
+
+			ExitCode exitCode = trace.run(state);
+
+			cpu.valSt .setFilledSize(state.valTop  - state.valBase);
+			cpu.callSt.setFilledSize(state.callTop - state.callBase);
+
+			for (size_t i = 0; i < MyStd1::_registers::REGISTER_COUNT; ++i) cpu.regs[i] = state.regs[i];
+			cpu.updateSp();
+
+			cpu.curCmd = static_cast<CmdNum_t>(state.pc);
+
+			if (exitCode == _jit::EXIT_ERROR) _jit::throwRuntimeError(state, program);
+		}
+
+		// Same as _command::run with the loops traced
+		void run(const _program::Program& program, MyStd1::_command::CPU& cpu)
+		{
+			const size_t size = program.commands.size();
+
+			Recorder recorder{program};
+
+			while (!cpu.halted && cpu.curCmd < size)
+			{
+				CmdNum_t pc = cpu.curCmd;
+
+				program.commands[pc].execute(cpu);
+				cpu.curCmd += 1;
+
+				if (cpu.halted || cpu.curCmd >= size) break;
+
+				const Trace* trace = recorder.step(pc, cpu.curCmd);
+				if (trace != nullptr) runTrace(*trace, program, cpu);
+			}
+		}
+
+	} // namespace _trace
+
+#endif // JIT_CPU_X86_64
+
+	// Snapshots and samples need cpu.curCmd of every command, those runs and the ones on other
+	// platforms stay in the classic interpreter
+	void executeTraced(const char* filename, MyStd1::_command::StackSizes sizes = {},
+	                   MyStd1::_output::Format format = MyStd1::_output::Format::TEXT, MyStd1::_input::Source input = {},
+	                   _snapshot::Options snapshots = {}, unsigned sampleRate = 0)
+	{
+	#ifdef JIT_CPU_X86_64
+
+		if (snapshots.filename != nullptr || sampleRate != 0)
+		{
+			execute(filename, sizes, format, input, snapshots, sampleRate);
+			return;
+		}
+
+		_program::Program program{_program::load(filename)};
+
+		_snapshot::Identity identity{};
+		if (snapshots.any()) identity = _snapshot::identify(program.code.data(), program.code.size());
+
+		_command::buildCommands(program);
+
+		MyStd1::_command::CPU cpu{sizes, format, input};
+		_command::start(program, cpu, snapshots, identity);
+
+		try
+		{
+			_trace::run(program, cpu);
+		}
+		catch (Exception& exc)
+		{
+			rethrowRuntimeError(filename, program, cpu, exc);
+		}
+
+	#else
+
+		execute(filename, sizes, format, input, snapshots, sampleRate);
+
+	#endif
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_TRACE_JIT_CPU_HPP_INCLUDED*/
@@ -0,0 +1,721 @@
+// Copyright 2018 Aleinik Vladislav
+#ifndef HEADER_GUARD_MY_COMPILER_VERIFIER_HPP_INCLUDED
+#define HEADER_GUARD_MY_COMPILER_VERIFIER_HPP_INCLUDED
+
+// Includes:
+
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <cmath>
+#include <cstdio>
+
+#include "CPU.hpp"
+
+// Defines:
+
+#define FILENAME "std1/Verifier.hpp"
+#define PROGRAM_POS FILENAME, __FUNCTION__, __LINE__
+
+// Code:
+
+namespace EmulatedProcessorStd1
+{
+	// Load time proof that a programme never takes the empty, full, register and frame checks.
+	// Stack depth is interpreted abstractly over the control flow graph. Every function is
+	// analysed relative to its entry depth, calls use the summary the callee's RETs give.
+	// Values are tracked just enough to follow the frames the translator builds: SP and BP
+	// are known offsets from the entry depth, so the frame drop loop is followed exactly.
+	namespace _verifier
+	{
+		using MyStd1::Val_t;
+
+		const Val_t VALUE_LIMIT = 1 << 30; // Larger constants are not followed
+
+		// Abstract value of a stack slot or of BP
+		struct Value
+		{
+		public:
+			enum Kind : unsigned char
+			{
+				UNKNOWN,
+				CONSTANT, // Integer constant
+				DEPTH,    // Entry depth + num
+				SLOT,     // What was in slot num (below the entry) when the function was entered
+				HANDLE,   // Some array of NEWARR
+				ARRAY     // Reference to the frame array with its length in slot num (REFM)
+			};
+
+			// Variables:
+				Kind kind;
+				long num;
+
+			// Functions:
+				bool operator==(const Value& that) const
+				{
+					return kind == that.kind && (kind == UNKNOWN || num == that.num);
+				}
+
+				bool operator!=(const Value& that) const
+				{
+					return !(*this == that);
+				}
+		};
+
+		const Value UNKNOWN_VALUE = {Value::UNKNOWN, 0};
+
+		Value join(const Value& a, const Value& b)
+		{
+			return (a == b)? a : UNKNOWN_VALUE;
+		}
+
+		struct State
+		{
+		public:
+			// Variables:
+				long depth; // From the entry depth
+				std::map<long, Value> slots; // Slots below the entry are only kept once changed
+				Value bp;
+
+			// Functions:
+				Value read(long index) const
+				{
+					auto found = slots.find(index);
+					if (found != slots.end()) return found->second;
+
+					return (index < 0)? Value{Value::SLOT, index} : UNKNOWN_VALUE;
+				}
+
+				void write(long index, Value value)
+				{
+					if (index < 0 && value == Value{Value::SLOT, index}) slots.erase(index);
+					else slots[index] = value;
+				}
+
+				void push(Value value)
+				{
+					write(depth++, value);
+				}
+
+				Value pop()
+				{
+					Value popped = read(--depth);
+					slots.erase(depth);
+
+					return popped;
+				}
+
+				bool operator==(const State& that) const
+				{
+					return depth == that.depth && bp == that.bp && slots == that.slots;
+				}
+		};
+
+		// Both have the same depth
+		State join(const State& a, const State& b)
+		{
+			State joined{a.depth, {}, join(a.bp, b.bp)};
+
+			for (auto& slot : a.slots) joined.write(slot.first, join(slot.second, b.read(slot.first)));
+			for (auto& slot : b.slots) joined.write(slot.first, join(a.read(slot.first), slot.second));
+
+			return joined;
+		}
+
+		//-----------------------------------------------------------------------------
+
+		struct Function
+		{
+		public:
+			// Variables:
+				bool called;
+				Value entryBp;
+
+				bool returns;
+				long retDepth;
+				Value retBp;
+
+				long lowest;  // Lowest slot popped or written
+				long highest; // Highest depth reached by the function itself
+				long lowestBp;
+
+				std::set<std::pair<size_t, long>> callSites; // CALL or tail jump command and depth there
+		};
+
+		struct Report
+		{
+		public:
+			// Variables:
+				bool verified;
+				const char* reason;
+				size_t failedCmd;
+
+				// For the verified programmes:
+				std::map<size_t, Function> functions; // By the first command
+				std::map<size_t, long> lowestEntryDepth;
+				size_t reachable;
+		};
+
+		namespace _additional
+		{
+			Value fromValue(Val_t value)
+			{
+				if (!(value >= -VALUE_LIMIT && value <= VALUE_LIMIT) || value != std::floor(value)) return UNKNOWN_VALUE;
+
+				return {Value::CONSTANT, static_cast<long>(value)};
+			}
+
+			Value add(Value l, Value r)
+			{
+				if (l.kind == Value::CONSTANT && r.kind == Value::CONSTANT) return {Value::CONSTANT, l.num + r.num};
+				if (l.kind == Value::DEPTH    && r.kind == Value::CONSTANT) return {Value::DEPTH,    l.num + r.num};
+				if (l.kind == Value::CONSTANT && r.kind == Value::DEPTH)    return {Value::DEPTH,    l.num + r.num};
+
+				return UNKNOWN_VALUE;
+			}
+
+			Value sub(Value l, Value r)
+			{
+				if (l.kind == Value::CONSTANT && r.kind == Value::CONSTANT) return {Value::CONSTANT, l.num - r.num};
+				if (l.kind == Value::DEPTH    && r.kind == Value::CONSTANT) return {Value::DEPTH,    l.num - r.num};
+				if (l.kind == Value::DEPTH    && r.kind == Value::DEPTH)    return {Value::CONSTANT, l.num - r.num};
+
+				return UNKNOWN_VALUE;
+			}
+
+			// -1 if unknown
+			int compare(MyStd1::Cmd_t cmd, Value l, Value r)
+			{
+				using namespace MyStd1::_command;
+
+				if (l.kind != r.kind || (l.kind != Value::CONSTANT && l.kind != Value::DEPTH)) return -1;
+
+				switch (cmd)
+				{
+					case CMD_JE:  return l.num == r.num;
+					case CMD_JNE: return l.num != r.num;
+					case CMD_JA:  return l.num >  r.num;
+					case CMD_JAE: return l.num >= r.num;
+					case CMD_JB:  return l.num <  r.num;
+					case CMD_JBE: return l.num <= r.num;
+					default: throw Exception("Not a conditional jump", PROGRAM_POS);
+				}
+			}
+
+		} // namespace _additional
+
+		class Verifier
+		{
+		private:
+			// Variables:
+				const _program::Code& code_;
+				size_t start_;
+
+				std::vector<std::map<long, State>> states_; // By command, then by depth
+				std::vector<size_t> owner_;                 // First command of the function
+				std::map<size_t, Function> functions_;
+
+				std::deque<std::pair<size_t, long>> toVisit_;
+
+			// Functions:
+				void fail(const char* reason, size_t cmd)
+				{
+					throw Failure{reason, cmd};
+				}
+
+				Function& newFunction(size_t first)
+				{
+					Function& function = functions_[first];
+					function = {false, UNKNOWN_VALUE, false, 0, UNKNOWN_VALUE, 0, 0, 0, {}};
+
+					owner_[first] = first;
+
+					return function;
+				}
+
+				void visit(size_t cmd, const State& state, size_t function, size_t from)
+				{
+					if (cmd == code_.size()) return; // Falls off the end and halts
+					if (cmd >  code_.size()) fail("Jump target is out of the program", from);
+
+					// The stacks grow at run time, the bound only keeps the analysis finite:
+					// a function that needs more than that relative to its entry runs checked
+					if (state.depth > static_cast<long>(MyStd1::_command::VALUE_STACK_SIZE)) fail("Value stack may overflow", from);
+					if (state.depth < -static_cast<long>(MyStd1::_command::VALUE_STACK_SIZE)) fail("Value stack may underflow", from);
+
+					if (owner_[cmd] == NO_OWNER) owner_[cmd] = function;
+					if (owner_[cmd] != function) fail("Command is shared by two functions", cmd);
+
+					auto found = states_[cmd].find(state.depth);
+					if (found == states_[cmd].end())
+					{
+						states_[cmd].emplace(state.depth, state);
+					}
+					else
+					{
+						State joined = join(found->second, state);
+						if (joined == found->second) return;
+
+						found->second = joined;
+					}
+
+					toVisit_.emplace_back(cmd, state.depth);
+				}
+
+				// Slot a PUSHM or POPM reaches, ALLOCM and NEWARR may also write right at the top
+				long memorySlot(Function& function, const State& state, size_t cmd, bool mayBeTop = false)
+				{
+					if (state.bp.kind != Value::DEPTH) fail("Frame of the memory access is unknown", cmd);
+
+					if (state.bp.num < function.lowestBp) function.lowestBp = state.bp.num;
+
+					long slot = state.bp.num + code_[cmd].arg.memAdr;
+					if (slot > state.depth || (slot == state.depth && !mayBeTop)) fail("Memory access may be out of stack", cmd);
+
+					return slot;
+				}
+
+				// A tail call is a call the caller returns right after, with the frame it leaves
+				void call(size_t cmd, size_t first, const State& state, size_t caller, bool tail = false)
+				{
+					if (first >= code_.size()) fail("Call out of the programme", cmd);
+					if (first == start_) fail("Call to the entry point", cmd);
+
+					if (owner_[first] != first)
+					{
+						if (owner_[first] != NO_OWNER) fail("Call into the middle of a function", cmd);
+						newFunction(first);
+					}
+
+					Function& callee = functions_[first];
+					callee.callSites.emplace(cmd, state.depth);
+
+					Value entryBp = (state.bp.kind == Value::DEPTH)? Value{Value::DEPTH, state.bp.num - state.depth} : state.bp;
+					if (!callee.called || callee.entryBp != entryBp)
+					{
+						callee.entryBp = callee.called? join(callee.entryBp, entryBp) : entryBp;
+						callee.called = true;
+
+						visit(first, State{0, {}, callee.entryBp}, first, cmd);
+					}
+
+					if (!callee.returns) return; // Comes back when the callee gets a RET
+
+					// The callee leaves its result slots and may change anything down to its lowest slot
+					State after{state};
+
+					for (long slot = state.depth + callee.lowest; slot < state.depth + callee.retDepth; ++slot)
+					{
+						after.write(slot, UNKNOWN_VALUE);
+					}
+
+					while (after.depth > state.depth + callee.retDepth) after.pop();
+					after.depth = state.depth + callee.retDepth;
+
+					switch (callee.retBp.kind)
+					{
+						case Value::DEPTH: after.bp = {Value::DEPTH, state.depth + callee.retBp.num}; break;
+						case Value::SLOT:  after.bp = state.read(state.depth + callee.retBp.num);     break;
+						default:           after.bp = callee.retBp;
+					}
+
+					Function& function = functions_[caller];
+					if (state.depth + callee.lowest < function.lowest) function.lowest = state.depth + callee.lowest;
+
+					if (tail) ret(cmd, after, caller);
+					else      visit(cmd + 1, after, caller, cmd);
+				}
+
+				void ret(size_t cmd, const State& state, size_t function)
+				{
+					if (function == start_) fail("RET outside of a function", cmd);
+
+					Function& callee = functions_[function];
+
+					if (callee.returns && callee.retDepth != state.depth) fail("Function returns with different stack depths", cmd);
+
+					callee.retBp = callee.returns? join(callee.retBp, state.bp) : state.bp;
+					callee.retDepth = state.depth;
+					callee.returns = true;
+				}
+
+				void step(size_t cmd, State state)
+				{
+					using namespace MyStd1::_command;
+					using namespace MyStd1::_registers;
+					using _additional::add;
+					using _additional::sub;
+
+					size_t    functionI = owner_[cmd];
+					Function& function  = functions_[functionI];
+
+					const _program::Instruction& instr = code_[cmd];
+
+					auto pop = [&state, &function]()
+					{
+						Value value = state.pop();
+						if (state.depth < function.lowest) function.lowest = state.depth;
+						return value;
+					};
+
+					auto push = [&state, &function](Value value)
+					{
+						state.push(value);
+						if (state.depth > function.highest) function.highest = state.depth;
+					};
+
+					switch (instr.cmd)
+					{
+						case CMD_BEG:
+						case CMD_DUMP: break;
+
+						case CMD_END: return;
+
+						case CMD_PUSH: push(_additional::fromValue(instr.arg.value)); break;
+
+						case CMD_PUSHR:
+						{
+							if (instr.arg.regAdr >= REGISTER_COUNT) fail("Unable to find the register!", cmd);
+
+							if      (instr.arg.regAdr == SP_REGISTER_I) push({Value::DEPTH, state.depth});
+							else if (instr.arg.regAdr == BP_REGISTER_I) push(state.bp);
+							else                                        push(UNKNOWN_VALUE);
+							break;
+						}
+
+						case CMD_POP:
+						case CMD_OUT:
+						case CMD_PRINT: pop(); break;
+
+						case CMD_POPR:
+						{
+							if (instr.arg.regAdr >= REGISTER_COUNT) fail("Unable to find the register!", cmd);
+
+							Value value = pop();
+							if (instr.arg.regAdr == BP_REGISTER_I) state.bp = value;
+							break;
+						}
+
+						case CMD_ADD: { Value r = pop(); Value l = pop(); push(add(l, r)); break; }
+						case CMD_SUB: { Value r = pop(); Value l = pop(); push(sub(l, r)); break; }
+
+						case CMD_MUL:   case CMD_DIV:
+						case CMD_IS_L:  case CMD_IS_LE: case CMD_IS_M: case CMD_IS_ME:
+						case CMD_IS_E:  case CMD_IS_NE: case CMD_AND:  case CMD_OR:
+						case CMD_POW:   case CMD_MIN:   case CMD_MAX:
+						{
+							pop();
+							pop();
+							push(UNKNOWN_VALUE);
+							break;
+						}
+
+						case CMD_SQRT: case CMD_SIN: case CMD_COS: case CMD_EXP:
+						case CMD_LOG:  case CMD_ABS: case CMD_FLOOR: pop(); push(UNKNOWN_VALUE); break;
+						case CMD_IN:          push(UNKNOWN_VALUE); break;
+
+						case CMD_JMP:
+						{
+							// The jump after TAILCALL enters the next function, see AsmTranslation.hpp
+							if (cmd != 0 && code_[cmd - 1].cmd == CMD_TAILCALL) call(cmd, instr.arg.cmdNum, state, functionI, true);
+							else                                                visit(instr.arg.cmdNum, state, functionI, cmd);
+							return;
+						}
+
+						case CMD_JE: case CMD_JNE: case CMD_JA: case CMD_JAE: case CMD_JB: case CMD_JBE:
+						{
+							Value r = pop();
+							Value l = pop();
+
+							int condition = _additional::compare(instr.cmd, l, r);
+
+							if (condition != 0) visit(instr.arg.cmdNum, state, functionI, cmd);
+							if (condition == 1) return;
+							break;
+						}
+
+						case CMD_CALL: call(cmd, instr.arg.cmdNum, state, functionI); return;
+						case CMD_RET:  ret (cmd, state, functionI); return;
+
+						case CMD_PUSHM:
+						{
+							long slot = memorySlot(function, state, cmd);
+							push(state.read(slot));
+							break;
+						}
+
+						case CMD_POPM:
+						{
+							long slot = memorySlot(function, state, cmd);
+							if (slot < state.depth - 1)
+							{
+								state.write(slot, pop());
+								if (slot < function.lowest) function.lowest = slot;
+							}
+							break;
+						}
+
+						case CMD_TAILCALL:
+						{
+							if (state.bp.kind != Value::DEPTH) fail("Frame of the memory access is unknown", cmd);
+
+							long bp = state.bp.num;
+							long argCount = instr.arg.memAdr;
+							if (bp + argCount > state.depth) fail("Memory access may be out of stack", cmd);
+
+							if (bp < function.lowestBp) function.lowestBp = bp;
+							if (bp < function.lowest)   function.lowest   = bp;
+
+							for (long i = 0; i < argCount; ++i) state.write(bp + i, state.read(state.depth - argCount + i));
+							while (state.depth > bp + argCount) state.pop();
+							break;
+						}
+
+						// Frame arrays are followed by their lengths, the indices are checked at run time anyway
+
+						case CMD_ALLOCM:
+						{
+							Value length = pop();
+							if (length.kind != Value::CONSTANT || length.num < 0) fail("Array size is unknown", cmd);
+
+							long slot = memorySlot(function, state, cmd, true);
+							if (slot < function.lowest) function.lowest = slot;
+
+							state.write(slot, length);
+							for (long i = 1; i <= length.num; ++i) state.write(slot + i, UNKNOWN_VALUE);
+
+							state.depth = std::max(state.depth, slot + 1 + length.num);
+							if (state.depth > function.highest) function.highest = state.depth;
+							break;
+						}
+
+						case CMD_PUSHMI:
+						case CMD_POPMI:
+						{
+							if (instr.cmd == CMD_PUSHMI) pop();
+							else { pop(); pop(); }
+
+							long slot = memorySlot(function, state, cmd);
+
+							Value length = state.read(slot);
+							if (length.kind != Value::CONSTANT) fail("Array size is unknown", cmd);
+							if (slot + length.num >= state.depth) fail("Memory access may be out of stack", cmd);
+
+							if (instr.cmd == CMD_PUSHMI) push(UNKNOWN_VALUE);
+							else for (long i = 1; i <= length.num; ++i) state.write(slot + i, UNKNOWN_VALUE);
+							break;
+						}
+
+						case CMD_NEWARR:
+						{
+							pop();
+
+							long slot = memorySlot(function, state, cmd, true);
+							if (slot == state.depth) push({Value::HANDLE, 0});
+							else
+							{
+								state.write(slot, {Value::HANDLE, 0});
+								if (slot < function.lowest) function.lowest = slot;
+							}
+							break;
+						}
+
+						case CMD_LOADA:  memorySlot(function, state, cmd); pop(); push(UNKNOWN_VALUE); break;
+						case CMD_STOREA: pop(); pop(); memorySlot(function, state, cmd); break;
+
+						// The arrays are checked at run time, but a vector command writing to the frame
+						// must write to a frame array the analysis knows
+
+						case CMD_REFM: push({Value::ARRAY, memorySlot(function, state, cmd)}); break;
+
+						case CMD_VADD: case CMD_VSUB: case CMD_VMUL: case CMD_VDIV: case CMD_VFMA:
+						{
+							for (int i = (instr.cmd == CMD_VFMA)? 3 : 2; i > 0; --i) pop();
+							Value destination = pop();
+
+							if (destination.kind == Value::HANDLE) break;
+							if (destination.kind != Value::ARRAY) fail("Array the vector command writes is unknown", cmd);
+
+							long slot = destination.num;
+							Value length = state.read(slot);
+							if (length.kind != Value::CONSTANT) fail("Array size is unknown", cmd);
+							if (slot + length.num >= state.depth) fail("Memory access may be out of stack", cmd);
+
+							for (long i = 1; i <= length.num; ++i) state.write(slot + i, UNKNOWN_VALUE);
+							if (slot + 1 < function.lowest && length.num != 0) function.lowest = slot + 1;
+							break;
+						}
+
+						case CMD_VDOT: pop(); pop(); push(UNKNOWN_VALUE); break;
+
+						case CMD_VSUM:
+						case CMD_VMIN:
+						case CMD_VMAX: pop(); push(UNKNOWN_VALUE); break;
+
+						default: throw Exception("Unknown command number", PROGRAM_POS);
+					}
+
+					visit(cmd + 1, state, functionI, cmd);
+				}
+
+		public:
+			// Variables:
+				static constexpr size_t NO_OWNER = static_cast<size_t>(-1);
+
+				struct Failure
+				{
+				public:
+					// Variables:
+						const char* reason;
+						size_t cmd;
+				};
+
+			// Ctor:
+				explicit Verifier(const _program::Program& program) :
+					code_    (program.code),
+					start_   (program.entry),
+					states_  (program.code.size()),
+					owner_   (program.code.size(), NO_OWNER),
+					functions_(),
+					toVisit_ ()
+				{}
+
+			// Functions:
+				Report verify()
+				{
+					Report report{false, nullptr, 0, {}, {}, 0};
+
+					try
+					{
+						if (code_.empty()) return {true, nullptr, 0, {}, {}, 0};
+
+						// Registers are zero at start, so BP points at the bottom of the stack
+						newFunction(start_).called = true;
+						visit(start_, State{0, {}, {Value::DEPTH, 0}}, start_, start_);
+
+						while (!toVisit_.empty())
+						{
+							std::pair<size_t, long> next = toVisit_.front();
+							toVisit_.pop_front();
+
+							size_t functionI = owner_[next.first];
+							Function before = functions_[functionI];
+
+							step(next.first, states_[next.first].at(next.second));
+
+							// Callers see the new summary
+							const Function& after = functions_[functionI];
+							if (after.returns && (!before.returns || before.retDepth != after.retDepth ||
+							                      before.retBp != after.retBp || before.lowest != after.lowest))
+							{
+								for (auto& site : after.callSites) toVisit_.emplace_back(site.first, site.second);
+							}
+						}
+
+						checkEntryDepths(report);
+					}
+					catch (Failure& failure)
+					{
+						report.reason    = failure.reason;
+						report.failedCmd = failure.cmd;
+						return report;
+					}
+
+					report.verified = true;
+
+					for (auto& states : states_) report.reachable += !states.empty();
+
+					report.functions = functions_;
+
+					return report;
+				}
+
+		private:
+			// Functions:
+				// Lowest stack depth every function may be entered with, callers' depths summed up
+				void checkEntryDepths(Report& report)
+				{
+					std::map<size_t, long>& entryDepth = report.lowestEntryDepth;
+					entryDepth[start_] = 0;
+
+					for (bool changed = true; changed;)
+					{
+						changed = false;
+
+						for (auto& function : functions_)
+						{
+							for (auto& site : function.second.callSites)
+							{
+								auto callerDepth = entryDepth.find(owner_[site.first]);
+								if (callerDepth == entryDepth.end()) continue;
+
+								long depth = std::max(0l, callerDepth->second + site.second);
+
+								auto found = entryDepth.find(function.first);
+								if (found == entryDepth.end() || depth < found->second)
+								{
+									entryDepth[function.first] = depth;
+									changed = true;
+								}
+							}
+						}
+					}
+
+					for (auto& depth : entryDepth)
+					{
+						const Function& function = functions_[depth.first];
+
+						if (depth.second + function.lowest   < 0) fail("Value stack may be empty in the function", depth.first);
+						if (depth.second + function.lowestBp < 0) fail("BP may be below the stack in the function", depth.first);
+					}
+				}
+
+		};
+
+		Report verify(const _program::Program& program)
+		{
+			return Verifier{program}.verify();
+		}
+
+		void printReport(const Report& report, const _program::Program& program)
+		{
+			using MyStd1::_command::COMMANDS;
+
+			if (!report.verified)
+			{
+				std::printf("Not verified: %s (command %zu, %s), checked execution\n",
+				            report.reason, report.failedCmd, COMMANDS[program.code[report.failedCmd].cmd].name.word);
+				return;
+			}
+
+			std::printf("Verified: %zu of %zu commands reachable, unchecked execution\n", report.reachable, program.code.size());
+
+			for (auto& function : report.functions)
+			{
+				auto entryDepth = report.lowestEntryDepth.find(function.first);
+
+				std::printf("function at %zu: ", function.first);
+
+				if (entryDepth == report.lowestEntryDepth.end()) std::printf("never called\n");
+				else std::printf("entry depth >= %ld, slots %ld..%ld from the entry\n",
+				                 entryDepth->second, function.second.lowest, function.second.highest);
+			}
+		}
+
+	} // namespace _verifier
+
+	// valang_execute --verify
+	void reportVerification(const char* filename)
+	{
+		_program::Program program{_program::load(filename)};
+
+		_verifier::printReport(_verifier::verify(program), program);
+	}
+
+} // namespace EmulatedProcessorStd1
+
+#undef FILENAME
+#undef PROGRAM_POS
+
+#endif /*HEADER_GUARD_MY_COMPILER_VERIFIER_HPP_INCLUDED*/
@@ -1,9 +1,14 @@
 #!/bin/sh
 # VlMathPg compiler call:
-# vl_math_pg_compile <file.vmpg> <res_folder>
+# vl_math_pg_compile <file.vmpg> <res_folder> [stack|reg]
 
 BIN_FOLDER="/Users/vladislav_aleinik/Dropbox/Programming/2017-2018/Vl-Math-PG/bin"
 FILE_NAME=`basename $1 .vmpg`
 
-echo `${BIN_FOLDER}/valang_translate.out $1 $2/${FILE_NAME}.valang`
-echo `${BIN_FOLDER}/valang_assemble.out $2/${FILE_NAME}.valang --std=1 $2/${FILE_NAME}.vacode`
\ No newline at end of file
+if [ "$3" = "reg" ]; then
+	echo `${BIN_FOLDER}/valang_translate.out $1 $2/${FILE_NAME}.valang --target=reg`
+	echo `${BIN_FOLDER}/valang_assemble.out $2/${FILE_NAME}.valang --std=reg $2/${FILE_NAME}.vacode`
+else
+	echo `${BIN_FOLDER}/valang_translate.out $1 $2/${FILE_NAME}.valang`
+	echo `${BIN_FOLDER}/valang_assemble.out $2/${FILE_NAME}.valang --std=3 $2/${FILE_NAME}.vacode`
+fi
\ No newline at end of file
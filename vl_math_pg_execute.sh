@@ -1,7 +1,7 @@
 #!/bin/sh
 # VlMathPg executor call:
-# vl_math_pg_execute <file.vmpg>
+# vl_math_pg_execute <file.vmpg> [options]
 
 BIN_FOLDER="/Users/vladislav_aleinik/Dropbox/Programming/2017-2018/Vl-Math-PG/bin"
 
-echo `${BIN_FOLDER}/valang_execute.out $1`
\ No newline at end of file
+echo `${BIN_FOLDER}/valang_execute.out $@`
\ No newline at end of file